@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- นับ heap allocation ของ task ที่สนใจ ----------
+// เปิดด้วย env:alloc_trace (-DALLOC_TRACE + -Wl,--wrap=malloc/calloc/realloc)
+// wrapper อยู่ใน src/alloc_trace.cpp; build ปกติ AllocScope ไม่ทำอะไรเลย
+#ifdef ALLOC_TRACE
+extern "C" {
+    extern volatile uint32_t gwAllocCount;      // นับเฉพาะตอน armed และมาจาก task ที่ตั้งไว้
+    extern volatile void*    gwAllocTask;
+}
+#endif
+
+struct AllocStats {
+    uint32_t lastTick  = 0;    // allocation ใน update() ล่าสุด
+    uint32_t maxTick   = 0;
+    uint32_t dirtyTicks = 0;   // จำนวน tick ที่มี allocation > 0
+    uint32_t ticks     = 0;
+};
+
+class AllocScope {
+private:
+    AllocStats &st;
+#ifdef ALLOC_TRACE
+    uint32_t start;
+#endif
+
+public:
+    explicit AllocScope(AllocStats &s) : st(s) {
+#ifdef ALLOC_TRACE
+        gwAllocTask = xTaskGetCurrentTaskHandle();
+        start = gwAllocCount;
+#endif
+    }
+
+    ~AllocScope() {
+#ifdef ALLOC_TRACE
+        uint32_t n = gwAllocCount - start;
+        gwAllocTask = nullptr;
+        st.lastTick = n;
+        if (n > st.maxTick) st.maxTick = n;
+        if (n) st.dirtyTicks++;
+#endif
+        st.ticks++;
+    }
+};
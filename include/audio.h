@@ -4,21 +4,289 @@
 #include <WebSocketsClient.h>
 #include <driver/i2s.h>
 #include "constant.h"
+#include "spsc_ring.h"
+#include "latency_stat.h"
+#include "audio/codec.h"
+#include "audio/vad.h"
+#include "audio/pcm_convert.h"
 
 #define I2S_SAMPLE_RATE   16000
-#define I2S_READ_LEN      512 
+
+// ---------- pipeline: I2S DMA → capture task → ring → sender (AudioTask) → WS ----------
+// capture block ละ AUDIO_BLOCK_MS (= 1 DMA buffer) ส่งทีละ frame (หลาย block ต่อ 1 WS message)
+#ifndef AUDIO_BLOCK_MS
+#define AUDIO_BLOCK_MS    10
+#endif
+
+#define AUDIO_BLOCK_SAMPLES (I2S_SAMPLE_RATE / 1000 * AUDIO_BLOCK_MS)
+
+#ifndef AUDIO_DMA_BUF_COUNT
+#define AUDIO_DMA_BUF_COUNT 8             // 8 x 10ms = ทน sender/Wi-Fi สะดุดได้ 80ms ใน DMA
+#endif
+
+#ifndef AUDIO_RING_BLOCKS
+#define AUDIO_RING_BLOCKS 32              // +310ms ใน ring (กำลังสอง)
+#endif
+
+#ifndef AUDIO_FRAME_MS
+#define AUDIO_FRAME_MS    40              // 20 / 40 / 100 ms ต่อ WS message
+#endif
+
+#define AUDIO_MAX_FRAME_MS 100
+#define AUDIO_MAX_FRAME_SAMPLES (AUDIO_MAX_FRAME_MS / AUDIO_BLOCK_MS * AUDIO_BLOCK_SAMPLES)
+
+// 1 = มี log-mel front end (~8KB RAM) ส่ง feature 40 byte / 10ms แทนเสียง (~1/8 ของ PCM16)
+#ifndef AUDIO_LOGMEL
+#define AUDIO_LOGMEL 0
+#endif
+
+// codec เริ่มต้น (เปลี่ยนตอน runtime ได้ด้วย setCodec)
+#ifndef AUDIO_CODEC
+#if AUDIO_LOGMEL
+#define AUDIO_CODEC AUDIO_CODEC_LOGMEL
+#else
+#define AUDIO_CODEC AUDIO_CODEC_PCM16
+#endif
+#endif
+
+// 1 = PCM16 ก็ใส่ AudioHeader ด้วย, 0 = PCM16 ส่ง raw เหมือนเดิม (server เก่า) เฉพาะตอน VAD ปิด
+// codec อื่น / VAD เปิด ใส่ header เสมอ (ช่วงเงียบถูกตัด → ต้องมี offset ให้ server วางเวลาใหม่)
+#ifndef AUDIO_WS_HEADER
+#define AUDIO_WS_HEADER 0
+#endif
+
+// ส่งเฉพาะช่วงที่มีเสียงพูด (+ pre-roll ก่อนเริ่ม) — เปลี่ยนตอน runtime ได้ด้วย setVad
+// เปิดแล้ว PCM16 ก็มี AudioHeader (v2) นำหน้า: server ที่รับ raw ต้องอ่าน header / ใช้ AUDIO_VAD=0
+#ifndef AUDIO_VAD
+#define AUDIO_VAD 1
+#endif
+
+#ifndef AUDIO_VAD_PREROLL_MS
+#define AUDIO_VAD_PREROLL_MS 200
+#endif
+
+#define AUDIO_PREROLL_BLOCKS (AUDIO_VAD_PREROLL_MS / AUDIO_BLOCK_MS)
+static_assert(AUDIO_PREROLL_BLOCKS >= 1 && AUDIO_PREROLL_BLOCKS <= 255, "AUDIO_VAD_PREROLL_MS out of range");
+
+// I2S slot → PCM16: ไมค์อยู่ slot ไหน / เลื่อนกี่ bit / gain Q8
+#ifndef AUDIO_PCM_CHANNEL
+#define AUDIO_PCM_CHANNEL 0
+#endif
+
+#ifndef AUDIO_PCM_SHIFT
+#define AUDIO_PCM_SHIFT 14
+#endif
+
+#ifndef AUDIO_PCM_GAIN
+#define AUDIO_PCM_GAIN PCM_GAIN_UNITY
+#endif
+
+#ifndef AUDIO_SEND_STALL_MS
+#define AUDIO_SEND_STALL_MS 20            // sendBIN นานกว่านี้ = TCP ติด
+#endif
+
+#ifndef AUDIO_CAPTURE_PRIO
+#define AUDIO_CAPTURE_PRIO 4              // สูงกว่า sender/cloud: DMA ต้องไม่ล้น
+#endif
+
+#ifndef AUDIO_CAPTURE_CORE
+#define AUDIO_CAPTURE_CORE 0
+#endif
+
+#if AUDIO_LOGMEL
+static_assert(AUDIO_BLOCK_SAMPLES == LOGMEL_HOP && I2S_SAMPLE_RATE == LOGMEL_RATE,
+              "log-mel hop must be one capture block");
+#endif
+
+struct AudioBlock {
+    uint32_t capUs;                       // micros() ตอน DMA buffer นี้เต็ม
+    uint32_t index;                       // ลำดับ block ที่ capture ได้ (รวมที่ทิ้งไป) → AudioHeader.offset
+    int16_t  pcm[AUDIO_BLOCK_SAMPLES];
+};
 
 class AudioService {
 public:
     WebSocketsClient ws;
-    int32_t i2s_buffer[I2S_READ_LEN]; 
-    int16_t pcm16[I2S_READ_LEN / 2];
 
+private:
+    int32_t i2s_buffer[AUDIO_BLOCK_SAMPLES * 2];                       // L/R 32-bit
+    int16_t frame[AUDIO_MAX_FRAME_SAMPLES];
+    uint8_t msg[AUDIO_HDR_LEN + AUDIO_MAX_FRAME_SAMPLES * 2];          // header + payload
+
+    PcmConvertCfg pcmCfg;
+    SpscRing<AudioBlock, AUDIO_RING_BLOCKS> ring;
+    QueueHandle_t i2sEvents   = nullptr;
+    TaskHandle_t  captureTask = nullptr;
+    TaskHandle_t  senderTask  = nullptr;
+
+    uint8_t  frameBlocks = AUDIO_FRAME_MS / AUDIO_BLOCK_MS;
+    uint8_t  filled      = 0;             // block ที่อยู่ใน frame แล้ว
+    uint32_t frameCapUs  = 0;             // capUs ของ block แรกใน frame
+    uint32_t frameIndex  = 0;             // index ของ block แรกใน frame
+
+    AudioCodec codec = AUDIO_CODEC;
+    AdpcmState adpcm;                     // ต่อเนื่องข้าม message (ค่าเริ่มอยู่ใน header)
+    uint32_t   seq   = 0;
+
+#if AUDIO_LOGMEL
+    LogMel     logmel;
+    uint8_t    nFeat = 0;                 // feature frame ใน message ปัจจุบัน
+#endif
+
+    // ---------- VAD + pre-roll (block ล่าสุดตอนเงียบ, เขียนทับตัวเก่าสุด) ----------
+    Vad        vad;
+    bool       vadOn = AUDIO_VAD;
+    AudioBlock preroll[AUDIO_PREROLL_BLOCKS];
+    uint8_t    preHead  = 0;
+    uint8_t    preCount = 0;
+
+    // ---------- stats ----------
+    volatile uint32_t dmaOverruns  = 0;   // I2S_EVENT_RX_Q_OVF: DMA เขียนทับก่อน capture อ่าน
+    volatile uint32_t ringOverruns = 0;   // ring เต็ม (sender ตามไม่ทัน) → ทิ้ง block
+    uint32_t sendStalls = 0;
+    uint32_t sendFails  = 0;
+    uint32_t framesSent = 0;
+    uint32_t dropped    = 0;              // block ที่ทิ้งตอน WS ไม่ได้ต่อ
+    uint32_t bytesSent  = 0;
+    uint32_t pcmBytes   = 0;              // ขนาดถ้าส่ง PCM16 → ดูอัตราบีบอัด
+    uint32_t blocksIn   = 0;              // block ที่ sender ได้รับตอน WS ต่ออยู่
+    uint32_t blocksOut  = 0;              // block ที่ถูกส่ง (duty cycle = out / in)
+    uint32_t bytesSaved = 0;              // payload ที่ VAD ไม่ต้องส่ง (ตาม codec ปัจจุบัน)
+    LatencyStat latency;                  // sample แรกของ frame → ส่งเสร็จ
+
+    static void captureEntry(void* arg) {
+        static_cast<AudioService*>(arg)->captureLoop();
+    }
+
+    // block อยู่บน DMA (ไม่ polling) → แปลง → ring → ปลุก sender เมื่อครบ frame
+    void captureLoop() {
+        AudioBlock blk;
+        uint32_t sinceWake = 0;
+        uint32_t captured  = 0;
+        while (true) {
+            size_t bytes = 0;
+            esp_err_t err = i2s_read(I2S_NUM_0, (void*)i2s_buffer, sizeof(i2s_buffer), &bytes, portMAX_DELAY);
+
+            i2s_event_t ev;
+            while (i2sEvents && xQueueReceive(i2sEvents, &ev, 0) == pdTRUE) {
+                if (ev.type == I2S_EVENT_RX_Q_OVF) dmaOverruns = dmaOverruns + 1;
+            }
+            if (err != ESP_OK || bytes != sizeof(i2s_buffer)) continue;
+
+            blk.capUs = micros();
+            blk.index = captured++;
+            pcmConvert(i2s_buffer, blk.pcm, AUDIO_BLOCK_SAMPLES, pcmCfg);
+
+            if (!ring.push(blk)) {
+                ringOverruns = ringOverruns + 1;
+                continue;
+            }
+            if (++sinceWake >= frameBlocks && senderTask) {
+                sinceWake = 0;
+                xTaskNotifyGive(senderTask);
+            }
+        }
+    }
+
+    void appendBlock(const AudioBlock &blk) {
+        if (filled && blk.index != frameIndex + filled) sendFrame();   // block หาย (ring ล้น) → offset ต้องไม่คลาด
+        if (filled == 0) {
+            frameCapUs = blk.capUs;
+            frameIndex = blk.index;
+        }
+#if AUDIO_LOGMEL
+        if (codec == AUDIO_CODEC_LOGMEL) {
+            int16_t lm[LOGMEL_BANDS];
+            if (logmel.push(blk.pcm, lm)) {
+                uint8_t* f = &msg[AUDIO_HDR_LEN + nFeat * LOGMEL_BANDS];
+                for (int b = 0; b < LOGMEL_BANDS; b++) f[b] = logmelQuantize(lm[b]);
+                nFeat++;
+            }
+        } else
+#endif
+        memcpy(&frame[filled * AUDIO_BLOCK_SAMPLES], blk.pcm, sizeof(blk.pcm));
+        blocksOut++;
+        if (++filled >= frameBlocks) sendFrame();
+    }
+
+    // เงียบ: เก็บไว้เป็น lead-in, ตัวที่ถูกเขียนทับคือส่วนที่ประหยัดได้จริง
+    void holdBlock(const AudioBlock &blk) {
+        if (preCount == AUDIO_PREROLL_BLOCKS) {
+            bytesSaved += audioCodecBytes(codec, AUDIO_BLOCK_SAMPLES);
+        } else {
+            preCount++;
+        }
+        preroll[preHead] = blk;
+        preHead = (uint8_t)((preHead + 1) % AUDIO_PREROLL_BLOCKS);
+    }
+
+    void flushPreroll() {
+        uint8_t start = (uint8_t)((preHead + AUDIO_PREROLL_BLOCKS - preCount) % AUDIO_PREROLL_BLOCKS);
+        for (uint8_t i = 0; i < preCount; i++) appendBlock(preroll[(start + i) % AUDIO_PREROLL_BLOCKS]);
+        preCount = 0;
+    }
+
+    void sendFrame() {
+        size_t n = filled * AUDIO_BLOCK_SAMPLES;
+        const uint8_t* payload;
+        size_t len;
+#if AUDIO_LOGMEL
+        if (codec == AUDIO_CODEC_LOGMEL) {
+            if (nFeat == 0) {                 // ต้นช่วงพูด: window ยังไม่เต็ม
+                filled = 0;
+                return;
+            }
+            AudioHeader h;
+            h.codec   = AUDIO_CODEC_LOGMEL;
+            h.flags   = LOGMEL_BANDS;
+            h.rate    = I2S_SAMPLE_RATE;
+            h.samples = nFeat;
+            h.seq     = seq;
+            h.offset  = frameIndex * AUDIO_BLOCK_SAMPLES;
+            audioHeaderWrite(msg, h);
+            payload = msg;
+            len     = AUDIO_HDR_LEN + nFeat * LOGMEL_BANDS;
+            nFeat   = 0;
+        } else
+#endif
+        if (codec == AUDIO_CODEC_PCM16 && !AUDIO_WS_HEADER && !vadOn) {
+            payload = (const uint8_t*)frame;
+            len     = n * sizeof(int16_t);
+        } else {
+            payload = msg;
+            len     = audioEncodeMessage(codec, adpcm, seq, frameIndex * AUDIO_BLOCK_SAMPLES,
+                                         I2S_SAMPLE_RATE, frame, n, msg);
+        }
+        seq++;
+
+        uint32_t t0 = micros();
+        bool ok = ws.sendBIN(payload, len);
+        uint32_t t1 = micros();
+
+        if (!ok) sendFails++;
+        if (t1 - t0 > AUDIO_SEND_STALL_MS * 1000u) sendStalls++;
+        if (ok) {
+            framesSent++;
+            bytesSent += len;
+            pcmBytes  += n * sizeof(int16_t);
+            latency.add(t1 - frameCapUs + AUDIO_BLOCK_MS * 1000u);
+        }
+        filled = 0;
+    }
+
+public:
     void begin() {
         if (!ENABLE_AUDIO_STREAM) return;
-        
-        Serial.println("[Audio] Init I2S & WebSocket...");
-        
+
+        Serial.printf("[Audio] Init I2S & WebSocket... (pcm=%s)\n", pcmConvertVariant());
+
+        pcmCfg.channel = AUDIO_PCM_CHANNEL;
+        pcmCfg.shift   = AUDIO_PCM_SHIFT;
+        pcmCfg.gain    = AUDIO_PCM_GAIN;
+#if AUDIO_LOGMEL
+        logmel.begin();
+#endif
+
         i2s_config_t cfg = {
             .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
             .sample_rate = I2S_SAMPLE_RATE,
@@ -26,8 +294,8 @@ public:
             .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
             .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB),
             .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-            .dma_buf_count = 8,
-            .dma_buf_len = 64,
+            .dma_buf_count = AUDIO_DMA_BUF_COUNT,
+            .dma_buf_len = AUDIO_BLOCK_SAMPLES,
             .use_apll = false,
             .tx_desc_auto_clear = false,
             .fixed_mclk = 0
@@ -41,38 +309,110 @@ public:
         };
         pin.mck_io_num = I2S_PIN_NO_CHANGE;
 
-        esp_err_t err = i2s_driver_install(I2S_NUM_0, &cfg, 0, NULL);
+        esp_err_t err = i2s_driver_install(I2S_NUM_0, &cfg, AUDIO_DMA_BUF_COUNT, &i2sEvents);
         if (err != ESP_OK) Serial.println("[Audio] Failed to install driver");
-        
+
         i2s_set_pin(I2S_NUM_0, &pin);
         i2s_zero_dma_buffer(I2S_NUM_0);
         i2s_start(I2S_NUM_0);
 
         connectWS();
+
+        xTaskCreatePinnedToCore(
+            captureEntry, "AudioCapture", 4096,
+            this, AUDIO_CAPTURE_PRIO, &captureTask, AUDIO_CAPTURE_CORE
+        );
+    }
+
+    // task ที่เรียก loop() (ถูกปลุกเมื่อมี frame ครบ)
+    void setSenderTask(TaskHandle_t t) { senderTask = t; }
+
+    // 20 / 40 / 100 ms (ปัดเป็นจำนวน block)
+    void setFrameMs(uint16_t ms) {
+        if (ms < AUDIO_BLOCK_MS)     ms = AUDIO_BLOCK_MS;
+        if (ms > AUDIO_MAX_FRAME_MS) ms = AUDIO_MAX_FRAME_MS;
+        frameBlocks = ms / AUDIO_BLOCK_MS;
+    }
+
+    // เปลี่ยน codec มีผลที่ message ถัดไป (ADPCM เริ่ม state ใหม่) — เรียกจาก task เดียวกับ loop()
+    void setCodec(AudioCodec c) {
+        if (c == codec) return;
+        if (c == AUDIO_CODEC_LOGMEL && !AUDIO_LOGMEL) {
+            Serial.println("[Audio] logmel not built (AUDIO_LOGMEL=0)");
+            return;
+        }
+        filled = 0;
+#if AUDIO_LOGMEL
+        nFeat = 0;
+        logmel.reset();
+#endif
+        codec = c;
+        adpcm = AdpcmState();
+        Serial.printf("[Audio] codec=%s\n", audioCodecText(c));
     }
 
+    AudioCodec currentCodec() const { return codec; }
+
+    void setVad(bool on) {
+        vadOn = on;
+        vad.reset();
+    }
+
+    // sender: รอ frame ครบ (หรือ timeout เพื่อ service WS) → แพ็ก block → ส่ง 1 message
     void loop() {
         if (!ENABLE_AUDIO_STREAM) return;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AUDIO_BLOCK_MS * 2));
         ws.loop();
 
-        if (!ws.isConnected()) return;
-
-        size_t bytes_read = 0;
-        esp_err_t err = i2s_read(I2S_NUM_0, (void*)i2s_buffer, sizeof(i2s_buffer), &bytes_read, 0);
-        if (err != ESP_OK || bytes_read == 0) return;
-
-        int samples = bytes_read / 4;
-        int frames = samples / 2;
+        AudioBlock blk;
+        if (!ws.isConnected()) {
+            // ไม่มีคนฟัง → ทิ้ง (ต่อใหม่แล้วเริ่มจากเสียงปัจจุบัน ไม่ใช่ของค้าง)
+            while (ring.pop(blk)) dropped++;
+            filled   = 0;
+            preCount = 0;
+            return;
+        }
 
-        for (int i = 0; i < frames; i++) {
-            int32_t val = i2s_buffer[i * 2];
-            val = val >> 14; 
-            if (val > 32767)  val = 32767;
-            if (val < -32768) val = -32768;
-            pcm16[i] = (int16_t)val;
+        while (ring.pop(blk)) {
+            blocksIn++;
+            if (vadOn && !vad.process(blk.pcm, AUDIO_BLOCK_SAMPLES)) {
+                if (filled) sendFrame();      // จบช่วงพูด → ส่ง frame ที่ค้างไม่ต้องรอเต็ม
+                holdBlock(blk);
+                continue;
+            }
+            if (preCount) {                   // เพิ่งเริ่มพูด → lead-in ก่อน
+#if AUDIO_LOGMEL
+                logmel.reset();               // ไม่เอา window ค้างจากช่วงก่อน
+#endif
+                flushPreroll();
+            }
+            appendBlock(blk);
         }
+    }
 
-        ws.sendBIN((uint8_t*)pcm16, frames * 2);
+    void printStats() const {
+        if (!ENABLE_AUDIO_STREAM) return;
+        Serial.printf("[Audio] frames=%lu (%ums) dmaOvf=%lu ringOvf=%lu stalls=%lu fails=%lu dropped=%lu\n",
+                      (unsigned long)framesSent,
+                      (unsigned)(frameBlocks * AUDIO_BLOCK_MS),
+                      (unsigned long)dmaOverruns,
+                      (unsigned long)ringOverruns,
+                      (unsigned long)sendStalls,
+                      (unsigned long)sendFails,
+                      (unsigned long)dropped);
+        Serial.printf("[Audio] codec=%s bytes=%lu (pcm %lu) latency avg=%luus max=%luus\n",
+                      audioCodecText(codec),
+                      (unsigned long)bytesSent,
+                      (unsigned long)pcmBytes,
+                      (unsigned long)latency.avgUs(),
+                      (unsigned long)latency.maxUs);
+        if (vadOn) {
+            uint32_t duty = blocksIn ? (uint32_t)((uint64_t)blocksOut * 1000u / blocksIn) : 0;
+            Serial.printf("[Audio] vad duty=%lu.%lu%% saved=%lu bytes noise=%lu\n",
+                          (unsigned long)(duty / 10), (unsigned long)(duty % 10),
+                          (unsigned long)bytesSaved,
+                          (unsigned long)vad.noiseFloor());
+        }
     }
 
 private:
@@ -0,0 +1,228 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "audio/logmel.h"
+
+// ---------- codec ของ audio stream (fixed-point ล้วน, ไม่มี dependency กับ Arduino) ----------
+// PCM16 256 kbit/s → µ-law 128 kbit/s (2:1) → IMA-ADPCM 64 kbit/s (4:1)
+// ทุก WS message ขึ้นต้นด้วย AudioHeader (little-endian) ให้ฝั่ง ws/ รู้ว่าต้อง decode แบบไหน
+
+enum AudioCodec : uint8_t {
+    AUDIO_CODEC_PCM16 = 0,
+    AUDIO_CODEC_ULAW  = 1,
+    AUDIO_CODEC_ADPCM = 2,      // IMA, 4 bit/sample, nibble ล่างคือ sample แรก
+    AUDIO_CODEC_LOGMEL = 3,     // ไม่ใช่เสียง: log-mel frame ละ LOGMEL_BANDS byte ต่อ LOGMEL_HOP sample
+};
+
+inline const char* audioCodecText(AudioCodec c) {
+    switch (c) {
+        case AUDIO_CODEC_ULAW:  return "ulaw";
+        case AUDIO_CODEC_ADPCM: return "adpcm";
+        case AUDIO_CODEC_LOGMEL: return "logmel";
+        default:                return "pcm16";
+    }
+}
+
+// bytes ที่ต้องใช้สำหรับ n sample
+inline size_t audioCodecBytes(AudioCodec c, size_t n) {
+    switch (c) {
+        case AUDIO_CODEC_ULAW:  return n;
+        case AUDIO_CODEC_ADPCM: return (n + 1) / 2;
+        case AUDIO_CODEC_LOGMEL: return n / LOGMEL_HOP * LOGMEL_BANDS;
+        default:                return n * 2;
+    }
+}
+
+// ---------- header ในแต่ละ message ----------
+//  0  u8  magic (0xA5)
+//  1  u8  version
+//  2  u8  codec (AudioCodec)
+//  3  u8  flags (LOGMEL: จำนวน band)
+//  4  u16 sample rate
+//  6  u16 samples ใน message นี้ (LOGMEL: จำนวน frame, byte = logmelQuantize)
+//  8  u32 seq (นับ message, ใช้ตรวจว่ามีหาย)
+// 12  i16 ADPCM predictor ตอนเริ่ม message
+// 14  u8  ADPCM step index ตอนเริ่ม message
+// 15  u8  สำรอง
+// 16  u32 offset: sample แรกของ message นับจากเริ่ม capture (v2, วนรอบ ~74 ชม. ที่ 16 kHz)
+//         VAD ตัดช่วงเงียบ / block หาย → offset กระโดด, seq ยังต่อเนื่อง → server วางเสียงบนแกนเวลาได้
+// (ADPCM ส่ง state ไปด้วย → decode แต่ละ message ได้อิสระ ถึงมี message หาย)
+#define AUDIO_HDR_MAGIC   0xA5
+#define AUDIO_HDR_VERSION 2
+#define AUDIO_HDR_LEN     20
+
+struct AudioHeader {
+    uint8_t  codec     = AUDIO_CODEC_PCM16;
+    uint8_t  flags     = 0;
+    uint16_t rate      = 16000;
+    uint16_t samples   = 0;
+    uint32_t seq       = 0;
+    int16_t  predictor = 0;
+    uint8_t  index     = 0;
+    uint32_t offset    = 0;
+};
+
+inline void audioHeaderWrite(uint8_t* p, const AudioHeader &h) {
+    p[0]  = AUDIO_HDR_MAGIC;
+    p[1]  = AUDIO_HDR_VERSION;
+    p[2]  = h.codec;
+    p[3]  = h.flags;
+    p[4]  = (uint8_t)h.rate;          p[5]  = (uint8_t)(h.rate >> 8);
+    p[6]  = (uint8_t)h.samples;       p[7]  = (uint8_t)(h.samples >> 8);
+    p[8]  = (uint8_t)h.seq;           p[9]  = (uint8_t)(h.seq >> 8);
+    p[10] = (uint8_t)(h.seq >> 16);   p[11] = (uint8_t)(h.seq >> 24);
+    p[12] = (uint8_t)h.predictor;     p[13] = (uint8_t)((uint16_t)h.predictor >> 8);
+    p[14] = h.index;
+    p[15] = 0;
+    p[16] = (uint8_t)h.offset;        p[17] = (uint8_t)(h.offset >> 8);
+    p[18] = (uint8_t)(h.offset >> 16); p[19] = (uint8_t)(h.offset >> 24);
+}
+
+inline bool audioHeaderRead(const uint8_t* p, size_t len, AudioHeader &h) {
+    if (len < AUDIO_HDR_LEN || p[0] != AUDIO_HDR_MAGIC || p[1] != AUDIO_HDR_VERSION) return false;
+    h.codec     = p[2];
+    h.flags     = p[3];
+    h.rate      = (uint16_t)(p[4] | (p[5] << 8));
+    h.samples   = (uint16_t)(p[6] | (p[7] << 8));
+    h.seq       = (uint32_t)p[8] | ((uint32_t)p[9] << 8) | ((uint32_t)p[10] << 16) | ((uint32_t)p[11] << 24);
+    h.predictor = (int16_t)(p[12] | (p[13] << 8));
+    h.index     = p[14];
+    h.offset    = (uint32_t)p[16] | ((uint32_t)p[17] << 8) | ((uint32_t)p[18] << 16) | ((uint32_t)p[19] << 24);
+    return h.codec <= AUDIO_CODEC_LOGMEL && h.index <= 88;
+}
+
+// ---------- µ-law (G.711) ----------
+#define ULAW_BIAS 0x84
+#define ULAW_CLIP 32635
+
+inline uint8_t ulawEncode(int16_t pcm) {
+    int32_t x = pcm;
+    uint8_t sign = 0;
+    if (x < 0) { x = -x; sign = 0x80; }
+    if (x > ULAW_CLIP) x = ULAW_CLIP;
+    x += ULAW_BIAS;                                   // 0x84 .. 0x7FFF
+
+    // segment = ตำแหน่ง bit สูงสุด - 7 (หาแบบ clz ไม่ต้องวน)
+    int seg = (31 - __builtin_clz((uint32_t)x)) - 7;
+    uint8_t mant = (uint8_t)((x >> (seg + 3)) & 0x0F);
+    return (uint8_t)~(sign | (seg << 4) | mant);
+}
+
+inline int16_t ulawDecode(uint8_t u) {
+    u = (uint8_t)~u;
+    int32_t x = ((((int32_t)u & 0x0F) << 3) + ULAW_BIAS) << ((u >> 4) & 0x07);
+    return (int16_t)((u & 0x80) ? ULAW_BIAS - x : x - ULAW_BIAS);
+}
+
+inline size_t ulawEncodeBlock(const int16_t* in, size_t n, uint8_t* out) {
+    for (size_t i = 0; i < n; i++) out[i] = ulawEncode(in[i]);
+    return n;
+}
+
+// ---------- IMA-ADPCM ----------
+struct AdpcmState {
+    int16_t predictor = 0;
+    uint8_t index     = 0;
+};
+
+inline const int16_t* adpcmStepTable() {
+    static const int16_t t[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+        253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+        1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+        11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+        32767
+    };
+    return t;
+}
+
+inline int8_t adpcmIndexAdjust(uint8_t code) {
+    static const int8_t t[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+    return t[code & 7];
+}
+
+// predictor/index อัปเดตด้วย code ที่ได้ (ใช้ร่วมกันทั้ง encode/decode → ไม่ drift)
+inline void adpcmStep(AdpcmState &s, uint8_t code) {
+    int32_t step = adpcmStepTable()[s.index];
+    int32_t diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+
+    int32_t p = s.predictor + ((code & 8) ? -diff : diff);
+    if (p > 32767)  p = 32767;
+    if (p < -32768) p = -32768;
+    s.predictor = (int16_t)p;
+
+    int idx = s.index + adpcmIndexAdjust(code);
+    if (idx < 0)  idx = 0;
+    if (idx > 88) idx = 88;
+    s.index = (uint8_t)idx;
+}
+
+inline uint8_t adpcmEncodeSample(AdpcmState &s, int16_t pcm) {
+    int32_t step = adpcmStepTable()[s.index];
+    int32_t diff = (int32_t)pcm - s.predictor;
+    uint8_t code = 0;
+    if (diff < 0) { code = 8; diff = -diff; }
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 1; }
+
+    adpcmStep(s, code);
+    return code;
+}
+
+inline size_t adpcmEncodeBlock(AdpcmState &s, const int16_t* in, size_t n, uint8_t* out) {
+    size_t o = 0;
+    for (size_t i = 0; i + 1 < n; i += 2) {
+        uint8_t lo = adpcmEncodeSample(s, in[i]);
+        uint8_t hi = adpcmEncodeSample(s, in[i + 1]);
+        out[o++] = (uint8_t)(lo | (hi << 4));
+    }
+    if (n & 1) out[o++] = adpcmEncodeSample(s, in[n - 1]);
+    return o;
+}
+
+inline size_t adpcmDecodeBlock(AdpcmState &s, const uint8_t* in, size_t n, int16_t* out) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t code = (i & 1) ? (in[i / 2] >> 4) : (in[i / 2] & 0x0F);
+        adpcmStep(s, code);
+        out[i] = s.predictor;
+    }
+    return n;
+}
+
+// ---------- encode 1 message: header + payload → คืนความยาวรวม ----------
+// out ต้องยาวอย่างน้อย AUDIO_HDR_LEN + audioCodecBytes(codec, n)
+inline size_t audioEncodeMessage(AudioCodec codec, AdpcmState &adpcm, uint32_t seq, uint32_t offset,
+                                 uint16_t rate, const int16_t* pcm, size_t n, uint8_t* out) {
+    AudioHeader h;
+    h.codec     = codec;
+    h.rate      = rate;
+    h.samples   = (uint16_t)n;
+    h.seq       = seq;
+    h.offset    = offset;
+    h.predictor = adpcm.predictor;
+    h.index     = adpcm.index;
+    audioHeaderWrite(out, h);
+
+    uint8_t* p = out + AUDIO_HDR_LEN;
+    size_t len;
+    switch (codec) {
+        case AUDIO_CODEC_ULAW:  len = ulawEncodeBlock(pcm, n, p);         break;
+        case AUDIO_CODEC_ADPCM: len = adpcmEncodeBlock(adpcm, pcm, n, p); break;
+        default:
+            for (size_t i = 0; i < n; i++) {
+                p[2 * i]     = (uint8_t)pcm[i];
+                p[2 * i + 1] = (uint8_t)((uint16_t)pcm[i] >> 8);
+            }
+            len = n * 2;
+            break;
+    }
+    return AUDIO_HDR_LEN + len;
+}
@@ -0,0 +1,271 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// ---------- log-mel front end: 25ms window / 10ms hop / 40 band @16kHz ----------
+// runtime เป็น fixed-point ทั้งหมด (Hann Q15 → block exponent → real FFT 512 จุดผ่าน
+// complex FFT 256 จุด, data int32 / twiddle Q30 / ครึ่งค่าทุก stage → power → mel Q15 → log2 Q8)
+// ใช้ float เฉพาะตอน begin() สร้างตาราง
+// output ต่อ frame = log2(mel energy) Q8 ของสัญญาณที่ full scale = 1.0
+// ไม่มี dependency กับ Arduino → เทียบกับ float reference บน host ได้ (LOGMEL_FLOAT_REF)
+
+#define LOGMEL_RATE    16000
+#define LOGMEL_WIN     400            // 25ms
+#define LOGMEL_HOP     160            // 10ms
+#define LOGMEL_NFFT    512
+#define LOGMEL_BINS    (LOGMEL_NFFT / 2 + 1)
+#define LOGMEL_BANDS   40
+
+#ifndef LOGMEL_FMIN
+#define LOGMEL_FMIN    20.0f
+#endif
+
+#ifndef LOGMEL_FMAX
+#define LOGMEL_FMAX    8000.0f
+#endif
+
+#define LOGMEL_FLOOR_Q8 (-64 * 256)   // band ที่ไม่มี energy เลย
+
+// ส่งขึ้น WS เป็น byte ละ band: 1/4 octave (~0.75dB) ต่อ step, 0 = ต่ำสุด
+#ifndef LOGMEL_Q_OFFSET
+#define LOGMEL_Q_OFFSET 200           // byte 200 = log2 0 → ครอบคลุม -50 .. +13.75 octave
+#endif
+
+inline uint8_t logmelQuantize(int16_t q8) {
+    int32_t v = (q8 >> 6) + LOGMEL_Q_OFFSET;
+    if (v < 0)   v = 0;
+    if (v > 255) v = 255;
+    return (uint8_t)v;
+}
+
+class LogMel {
+private:
+    static const int M = LOGMEL_NFFT / 2;         // complex FFT size
+
+    // ---------- ตาราง (สร้างครั้งเดียวใน begin) ----------
+    int16_t  window[LOGMEL_WIN];                  // Hann Q15
+    int32_t  cosT[M];                             // cos(2πk/N) Q30, k < N/2
+    int32_t  sinT[M];
+    uint8_t  bitrev[M];
+    uint8_t  log2Frac[256];                       // log2(1 + i/256) Q8
+    uint16_t bandStart[LOGMEL_BANDS];             // bin แรกของ band
+    uint16_t bandLen[LOGMEL_BANDS];
+    uint16_t bandOff[LOGMEL_BANDS];               // offset ใน weights
+    int16_t  weights[2 * LOGMEL_BINS];            // Q15 (แต่ละ bin อยู่ใน band ไม่เกิน 2 อัน)
+
+    // ---------- state ----------
+    int16_t  hist[LOGMEL_WIN];                    // sample ล่าสุด LOGMEL_WIN ตัว
+    uint16_t histLen = 0;
+    int32_t  xw[LOGMEL_WIN];
+    int32_t  re[M];
+    int32_t  im[M];
+    uint64_t power[LOGMEL_BINS];
+
+    static float hzToMel(float f) { return 2595.0f * log10f(1.0f + f / 700.0f); }
+    static float melToHz(float m) { return 700.0f * (powf(10.0f, m / 2595.0f) - 1.0f); }
+
+    // log2 ของ integer → Q8
+    int32_t log2Q8(uint64_t v) const {
+        int msb = 63 - __builtin_clzll(v);
+        uint32_t m = (msb >= 8) ? (uint32_t)(v >> (msb - 8)) : (uint32_t)(v << (8 - msb));
+        return msb * 256 + log2Frac[m & 0xFF];
+    }
+
+    // (a * b) >> 30 ปัดเศษ (twiddle Q30)
+    static int32_t mulQ30(int32_t a, int32_t b) {
+        return (int32_t)(((int64_t)a * b + (1 << 29)) >> 30);
+    }
+
+    // radix-2 DIT, in-place, ครึ่งค่าทุก stage (ผลลัพธ์ = DFT / M)
+    // input |z| < 2^20.5 → ขนาดไม่โตเกินนั้นทุก stage
+    void fft() {
+        for (int i = 0; i < M; i++) {
+            int j = bitrev[i];
+            if (j > i) {
+                int32_t t = re[i]; re[i] = re[j]; re[j] = t;
+                t = im[i]; im[i] = im[j]; im[j] = t;
+            }
+        }
+        for (int len = 2; len <= M; len <<= 1) {
+            int half = len >> 1;
+            int step = LOGMEL_NFFT / len;          // W_len^j = W_N^(j*step)
+            for (int i = 0; i < M; i += len) {
+                for (int j = 0; j < half; j++) {
+                    int32_t wr = cosT[j * step];
+                    int32_t wi = -sinT[j * step];
+                    int a = i + j, b = a + half;
+                    int32_t tr = mulQ30(re[b], wr) - mulQ30(im[b], wi);
+                    int32_t ti = mulQ30(re[b], wi) + mulQ30(im[b], wr);
+                    re[b] = (re[a] - tr) >> 1;
+                    im[b] = (im[a] - ti) >> 1;
+                    re[a] = (re[a] + tr) >> 1;
+                    im[a] = (im[a] + ti) >> 1;
+                }
+            }
+        }
+    }
+
+    // Z (complex M จุดของ sample คู่/คี่) → power ของ real FFT N จุด bin 0..M
+    // |X| < 2^21.5 → |X|^2 < 2^43; ผลรวมทั้ง band x w(Q15) ยังไม่ล้น 64-bit (Parseval)
+    // ไม่ตัด bit ล่างมาก → sidelobe ที่ต่ำกว่า peak ~100dB ยังวัดได้
+    static const int POWER_SHIFT = 4;
+
+    static uint64_t mag2(int32_t r, int32_t i) {
+        return (uint64_t)((int64_t)r * r + (int64_t)i * i) >> POWER_SHIFT;
+    }
+
+    void splitPower() {
+        power[0] = mag2(re[0] + im[0], 0);
+        power[M] = mag2(re[0] - im[0], 0);
+        for (int k = 1; k < M; k++) {
+            int32_t ar = re[k],     ai = im[k];
+            int32_t br = re[M - k], bi = im[M - k];
+            int32_t fer = (ar + br) >> 1, fei = (ai - bi) >> 1;
+            int32_t for_ = (ai + bi) >> 1, foi = (br - ar) >> 1;
+            int32_t c = cosT[k], s = sinT[k];
+            int32_t xr = fer + mulQ30(for_, c) + mulQ30(foi, s);
+            int32_t xi = fei + mulQ30(foi, c) - mulQ30(for_, s);
+            power[k] = mag2(xr, xi);
+        }
+    }
+
+public:
+    void begin() {
+        const float PI2 = 6.28318530718f;
+        for (int n = 0; n < LOGMEL_WIN; n++)
+            window[n] = (int16_t)lrintf(32767.0f * 0.5f * (1.0f - cosf(PI2 * n / LOGMEL_WIN)));
+        for (int k = 0; k < M; k++) {
+            cosT[k] = (int32_t)lrint(1073741824.0 * cos(6.283185307179586 * k / LOGMEL_NFFT));
+            sinT[k] = (int32_t)lrint(1073741824.0 * sin(6.283185307179586 * k / LOGMEL_NFFT));
+            int r = 0;
+            for (int b = 0; (1 << b) < M; b++) if (k & (1 << b)) r |= (M >> 1) >> b;
+            bitrev[k] = (uint8_t)r;
+        }
+        for (int i = 0; i < 256; i++) log2Frac[i] = (uint8_t)lrintf(256.0f * log2f(1.0f + i / 256.0f));
+
+        // mel filter สามเหลี่ยม (ขอบ = จุดเท่ากันบนสเกล mel)
+        float edge[LOGMEL_BANDS + 2];
+        float m0 = hzToMel(LOGMEL_FMIN), m1 = hzToMel(LOGMEL_FMAX);
+        for (int i = 0; i < LOGMEL_BANDS + 2; i++)
+            edge[i] = melToHz(m0 + (m1 - m0) * i / (LOGMEL_BANDS + 1));
+
+        uint16_t off = 0;
+        for (int b = 0; b < LOGMEL_BANDS; b++) {
+            bandOff[b]   = off;
+            bandStart[b] = 0;
+            bandLen[b]   = 0;
+            for (int k = 0; k < LOGMEL_BINS; k++) {
+                float w = bandWeight(edge, b, k);
+                if (w <= 0.0f) continue;
+                if (bandLen[b] == 0) bandStart[b] = (uint16_t)k;
+                weights[off++] = (int16_t)lrintf(w * 32767.0f);
+                bandLen[b]++;
+            }
+            if (bandLen[b] == 0) {                 // band แคบกว่า 1 bin → ใช้ bin ที่ใกล้ center
+                bandStart[b] = (uint16_t)lrintf(edge[b + 1] * LOGMEL_NFFT / LOGMEL_RATE);
+                weights[off++] = 32767;
+                bandLen[b] = 1;
+            }
+        }
+        reset();
+    }
+
+    // น้ำหนักของ bin k ใน band b (ใช้ร่วมกับ float reference)
+    static float bandWeight(const float* edge, int b, int k) {
+        float f = (float)k * LOGMEL_RATE / LOGMEL_NFFT;
+        float lo = edge[b], mid = edge[b + 1], hi = edge[b + 2];
+        if (f <= lo || f >= hi) return 0.0f;
+        return (f <= mid) ? (f - lo) / (mid - lo) : (hi - f) / (hi - mid);
+    }
+
+    void reset() { histLen = 0; }
+
+    // ใส่ 1 hop (LOGMEL_HOP sample) → true เมื่อได้ frame ใหม่ใน out[LOGMEL_BANDS]
+    bool push(const int16_t* x, int16_t* out) {
+        memmove(hist, hist + LOGMEL_HOP, (LOGMEL_WIN - LOGMEL_HOP) * sizeof(int16_t));
+        memcpy(hist + LOGMEL_WIN - LOGMEL_HOP, x, LOGMEL_HOP * sizeof(int16_t));
+        if (histLen < LOGMEL_WIN) histLen += LOGMEL_HOP;
+        if (histLen < LOGMEL_WIN) return false;
+        compute(hist, out);
+        return true;
+    }
+
+    // 1 frame (LOGMEL_WIN sample) → log2 mel energy Q8
+    void compute(const int16_t* x, int16_t* out) {
+        // window (เก็บเต็ม Q30 ไม่ปัดทิ้ง) + หา peak สำหรับ block exponent
+        int32_t peak = 0;
+        for (int n = 0; n < LOGMEL_WIN; n++) {
+            xw[n] = (int32_t)x[n] * window[n];
+            int32_t a = xw[n] < 0 ? -xw[n] : xw[n];
+            if (a > peak) peak = a;
+        }
+        if (peak == 0) {
+            for (int b = 0; b < LOGMEL_BANDS; b++) out[b] = LOGMEL_FLOOR_Q8;
+            return;
+        }
+
+        // ขยาย/ลดให้ peak อยู่ที่ 2^19 .. 2^20 (headroom ของ FFT + int64 product)
+        int s = 19 - (31 - __builtin_clz((uint32_t)peak));
+        for (int i = 0; i < M; i++) {
+            int n0 = 2 * i, n1 = 2 * i + 1;
+            int32_t a = n0 < LOGMEL_WIN ? xw[n0] : 0;
+            int32_t b = n1 < LOGMEL_WIN ? xw[n1] : 0;
+            re[i] = s >= 0 ? a * (1 << s) : (a + (1 << (-s - 1))) >> -s;
+            im[i] = s >= 0 ? b * (1 << s) : (b + (1 << (-s - 1))) >> -s;
+        }
+
+        fft();
+        splitPower();
+
+        // X = X_จริง * 2^(30+s) / M, P = |X|^2 >> POWER_SHIFT, acc = Σ P * w(Q15)
+        // → log2(E) = log2(acc) - (60 + 2s - 16 - POWER_SHIFT + 15)
+        const int32_t bias = (59 - POWER_SHIFT + 2 * s) * 256;
+        for (int b = 0; b < LOGMEL_BANDS; b++) {
+            uint64_t acc = 0;
+            const int16_t* w = &weights[bandOff[b]];
+            const uint64_t* p = &power[bandStart[b]];
+            for (int k = 0; k < bandLen[b]; k++) acc += p[k] * (uint16_t)w[k];
+            int32_t v = acc ? log2Q8(acc) - bias : LOGMEL_FLOOR_Q8;
+            if (v < LOGMEL_FLOOR_Q8) v = LOGMEL_FLOOR_Q8;
+            if (v > 32767)           v = 32767;
+            out[b] = (int16_t)v;
+        }
+    }
+
+#ifdef LOGMEL_FLOAT_REF
+    // ---------- float baseline (host เท่านั้น: DFT ตรง ๆ O(N^2)) ----------
+    static void referenceFloat(const int16_t* x, float* out) {
+        const double PI2 = 6.283185307179586;
+        float edge[LOGMEL_BANDS + 2];
+        float m0 = hzToMel(LOGMEL_FMIN), m1 = hzToMel(LOGMEL_FMAX);
+        for (int i = 0; i < LOGMEL_BANDS + 2; i++)
+            edge[i] = melToHz(m0 + (m1 - m0) * i / (LOGMEL_BANDS + 1));
+
+        double xw[LOGMEL_WIN];
+        for (int n = 0; n < LOGMEL_WIN; n++)
+            xw[n] = x[n] / 32768.0 * 0.5 * (1.0 - cos(PI2 * n / LOGMEL_WIN));
+
+        double p[LOGMEL_BINS];
+        for (int k = 0; k < LOGMEL_BINS; k++) {
+            double r = 0, i = 0;
+            for (int n = 0; n < LOGMEL_WIN; n++) {
+                r += xw[n] * cos(PI2 * k * n / LOGMEL_NFFT);
+                i -= xw[n] * sin(PI2 * k * n / LOGMEL_NFFT);
+            }
+            p[k] = r * r + i * i;
+        }
+        for (int b = 0; b < LOGMEL_BANDS; b++) {
+            double e = 0;
+            bool any = false;
+            for (int k = 0; k < LOGMEL_BINS; k++) {
+                float w = bandWeight(edge, b, k);
+                if (w > 0.0f) { e += p[k] * w; any = true; }
+            }
+            if (!any) e = p[(int)lrintf(edge[b + 1] * LOGMEL_NFFT / LOGMEL_RATE)];
+            out[b] = e > 0 ? (float)log2(e) : LOGMEL_FLOOR_Q8 / 256.0f;
+        }
+    }
+#endif
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// ---------- I2S 32-bit (L/R interleave) → PCM16 ----------
+// out[i] = sat16(((in[i*stride + channel] >> shift) * gain) >> 8)
+// gain = Q8 (256 = x1, สูงสุด 4096 = x16) — ทุก variant ให้ผลตรงกันทุก bit
+// pcmConvert() เลือก variant ที่ดีที่สุดตอน compile:
+//   Xtensa (ESP32) → CLAMPS, host x86 → SSE2, host ARM → NEON, อื่น ๆ → portable
+// variant แต่ละตัวเรียกตรงได้ (เทียบ/วัดความเร็วบน host)
+
+#define PCM_GAIN_UNITY 256
+#define PCM_GAIN_MAX   4096
+
+struct PcmConvertCfg {
+    uint8_t  channel = 0;     // 0 = slot แรกของคู่ (เดิม: i2s_buffer[i * 2])
+    uint8_t  stride  = 2;     // จำนวน slot ต่อ frame
+    uint8_t  shift   = 14;    // 32-bit MSB-aligned → 16-bit ของไมค์
+    uint16_t gain    = PCM_GAIN_UNITY;
+};
+
+// ---------- reference: พฤติกรรมเดิมของ AudioService::loop ----------
+inline void pcmConvertRef(const int32_t* in, int16_t* out, size_t n, const PcmConvertCfg &c) {
+    for (size_t i = 0; i < n; i++) {
+        int64_t val = in[i * c.stride + c.channel];
+        val = val >> c.shift;
+        if (c.gain != PCM_GAIN_UNITY) val = (val * c.gain) >> 8;
+        if (val > 32767)  val = 32767;
+        if (val < -32768) val = -32768;
+        out[i] = (int16_t)val;
+    }
+}
+
+// ---------- portable branch-free ----------
+// min/max ด้วย mask จาก sign bit (ไม่มี compare-branch); ต้องการ v อยู่ใน ±2^30 (shift >= 1)
+inline int16_t pcmSat16(int32_t v) {
+    int32_t d = v - 32767;
+    v -= d & ~(d >> 31);              // min(v, 32767)
+    d = v + 32768;
+    v -= d & (d >> 31);               // max(v, -32768)
+    return (int16_t)v;
+}
+
+inline void pcmConvertPortable(const int32_t* in, int16_t* out, size_t n, const PcmConvertCfg &c) {
+    const int32_t* p = in + c.channel;
+    if (c.gain == PCM_GAIN_UNITY && c.shift >= 1) {
+        const uint8_t sh = c.shift;
+        for (size_t i = 0; i < n; i++, p += c.stride) out[i] = pcmSat16(*p >> sh);
+        return;
+    }
+    // gain ≠ 1 หรือ shift 0 (ไม่ใช่ค่าปกติของไมค์): 64-bit + clamp ธรรมดา
+    for (size_t i = 0; i < n; i++, p += c.stride) {
+        int64_t v = (int64_t)(*p >> c.shift) * c.gain >> 8;
+        if (v > 32767)  v = 32767;
+        if (v < -32768) v = -32768;
+        out[i] = (int16_t)v;
+    }
+}
+
+// ---------- Xtensa: CLAMPS (saturate เป็น signed 16-bit ใน 1 คำสั่ง) ----------
+#if defined(__XTENSA__)
+#define PCM_HAVE_XTENSA 1
+
+inline void pcmConvertXtensa(const int32_t* in, int16_t* out, size_t n, const PcmConvertCfg &c) {
+    if (c.gain != PCM_GAIN_UNITY) {
+        pcmConvertPortable(in, out, n, c);
+        return;
+    }
+    const int32_t* p = in + c.channel;
+    const uint32_t sh = c.shift;
+    const uint8_t  st = c.stride;
+    for (size_t i = 0; i < n; i++, p += st) {
+        int32_t v = *p >> sh, r;
+        __asm__ ("clamps %0, %1, 15" : "=a"(r) : "a"(v));
+        out[i] = (int16_t)r;
+    }
+}
+#endif
+
+// ---------- SSE2: 8 sample/รอบ (ดึง slot คู่ + srai + packs = saturate) ----------
+#if defined(__SSE2__)
+#define PCM_HAVE_SSE2 1
+
+inline void pcmConvertSse2(const int32_t* in, int16_t* out, size_t n, const PcmConvertCfg &c) {
+    if (c.gain != PCM_GAIN_UNITY || c.stride != 2) {
+        pcmConvertPortable(in, out, n, c);
+        return;
+    }
+    const int32_t* p = in + c.channel;
+    const __m128i sh = _mm_cvtsi32_si128(c.shift);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        // slot ที่ต้องการอยู่ตำแหน่ง 0,2 ของทุก 4 ตัว (p เลื่อนตาม channel แล้ว)
+        __m128i a = _mm_loadu_si128((const __m128i*)(p + 0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + 4));
+        __m128i d = _mm_loadu_si128((const __m128i*)(p + 8));
+        __m128i e = (i + 8 < n) ? _mm_loadu_si128((const __m128i*)(p + 12))
+                                : _mm_setr_epi32(p[12], 0, p[14], 0);   // ไม่อ่านเกินท้าย buffer
+        a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+        b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+        d = _mm_shuffle_epi32(d, _MM_SHUFFLE(3, 1, 2, 0));
+        e = _mm_shuffle_epi32(e, _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i lo = _mm_sra_epi32(_mm_unpacklo_epi64(a, b), sh);
+        __m128i hi = _mm_sra_epi32(_mm_unpacklo_epi64(d, e), sh);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(lo, hi));
+    }
+    if (i < n) {
+        PcmConvertCfg t = c;
+        t.channel = 0;
+        pcmConvertPortable(p, out + i, n - i, t);
+    }
+}
+#endif
+
+// ---------- NEON: vld2 แยก L/R ให้เลย + vqmovn (saturating narrow) ----------
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_HAVE_NEON 1
+
+inline void pcmConvertNeon(const int32_t* in, int16_t* out, size_t n, const PcmConvertCfg &c) {
+    if (c.gain != PCM_GAIN_UNITY || c.stride != 2) {
+        pcmConvertPortable(in, out, n, c);
+        return;
+    }
+    const int32x4_t sh = vdupq_n_s32(-(int32_t)c.shift);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int32x4x2_t a = vld2q_s32(in + i * 2);
+        int32x4x2_t b = vld2q_s32(in + i * 2 + 8);
+        int32x4_t   x = c.channel ? a.val[1] : a.val[0];
+        int32x4_t   y = c.channel ? b.val[1] : b.val[0];
+        int16x8_t   r = vcombine_s16(vqmovn_s32(vshlq_s32(x, sh)), vqmovn_s32(vshlq_s32(y, sh)));
+        vst1q_s16(out + i, r);
+    }
+    if (i < n) pcmConvertPortable(in + i * 2, out + i, n - i, c);
+}
+#endif
+
+// ---------- dispatch ----------
+inline void pcmConvert(const int32_t* in, int16_t* out, size_t n, const PcmConvertCfg &c) {
+#if defined(PCM_HAVE_XTENSA)
+    pcmConvertXtensa(in, out, n, c);
+#elif defined(PCM_HAVE_NEON)
+    pcmConvertNeon(in, out, n, c);
+#elif defined(PCM_HAVE_SSE2)
+    pcmConvertSse2(in, out, n, c);
+#else
+    pcmConvertPortable(in, out, n, c);
+#endif
+}
+
+inline const char* pcmConvertVariant() {
+#if defined(PCM_HAVE_XTENSA)
+    return "xtensa-clamps";
+#elif defined(PCM_HAVE_NEON)
+    return "neon";
+#elif defined(PCM_HAVE_SSE2)
+    return "sse2";
+#else
+    return "portable";
+#endif
+}
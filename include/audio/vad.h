@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ---------- VAD แบบ fixed-point: energy + zero-crossing rate ต่อ block ----------
+// noise floor ปรับตัวเอง (ลงเร็ว ขึ้นช้า), ต้องเจอเสียงพูดต่อกัน onset block ถึงเริ่ม
+// แล้วค้างไว้อีก hangover block หลังเงียบ (ไม่ตัดท้ายคำ) — pre-roll อยู่ฝั่งผู้ใช้
+// ไม่มี dependency กับ Arduino → รันบน host กับไฟล์ WAV ได้
+struct VadConfig {
+    uint32_t minEnergy  = 64;     // mean square ต่ำกว่านี้ = เงียบเสมอ (rms ~8)
+    uint8_t  snrShift   = 2;      // energy > noise << shift (x4 ≈ 6dB)
+    uint8_t  loudShift  = 4;      // energy > noise << shift (x16) = เสียงพูดแน่ ๆ ไม่ดู ZCR
+    uint16_t zcrMin     = 3;      // crossing ต่อ 160 sample: ต่ำกว่านี้ = hum / DC
+    uint16_t zcrMax     = 100;    // สูงกว่านี้ = hiss / noise กว้าง ๆ
+    uint8_t  onset      = 2;      // block ติดกันก่อนถือว่าเริ่มพูด
+    uint8_t  hangover   = 30;     // block ที่ค้าง active หลังเสียงหาย
+};
+
+class Vad {
+private:
+    VadConfig cfg;
+    uint32_t noise   = 0;
+    uint8_t  run     = 0;         // speech-like ติดกันกี่ block
+    uint8_t  hang    = 0;
+    bool     active  = false;
+
+    uint32_t lastEnergy = 0;
+    uint16_t lastZcr    = 0;
+
+    void trackNoise(uint32_t e, bool speechLike) {
+        if (noise == 0)     { noise = e ? e : 1; return; }
+        if (e < noise)      noise -= (noise - e) >> 2;                  // ลงเร็ว
+        else if (speechLike) noise += ((e - noise) >> 12) + 1;          // ระหว่างพูดแทบไม่ขยับ (~40s)
+        else                noise += ((e - noise) >> 7) + 1;            // เสียงพื้นดังขึ้น (~1.3s)
+    }
+
+public:
+    Vad() {}
+    explicit Vad(const VadConfig &c) : cfg(c) {}
+
+    void reset() {
+        noise  = 0;
+        run    = 0;
+        hang   = 0;
+        active = false;
+    }
+
+    // 1 block (เช่น 10ms) → true = ส่ง block นี้
+    bool process(const int16_t* x, size_t n) {
+        if (n == 0) return active;
+
+        uint64_t acc = 0;
+        uint32_t zc  = 0;
+        int16_t  prev = x[0];
+        for (size_t i = 0; i < n; i++) {
+            int32_t v = x[i];
+            acc += (uint32_t)(v * v);
+            zc  += (uint32_t)((x[i] ^ prev) < 0);     // sign เปลี่ยน (ไม่มี branch)
+            prev = x[i];
+        }
+        uint32_t e   = (uint32_t)(acc / n);
+        uint16_t zcr = (uint16_t)(zc * 160u / n);
+
+        uint64_t nf = noise ? noise : e;
+        bool loud   = (uint64_t)e > (nf << cfg.loudShift);
+        bool voiced = (uint64_t)e > (nf << cfg.snrShift) && zcr >= cfg.zcrMin && zcr <= cfg.zcrMax;
+        bool speechLike = e >= cfg.minEnergy && (loud || voiced);
+
+        trackNoise(e, speechLike);
+        lastEnergy = e;
+        lastZcr    = zcr;
+
+        if (speechLike) {
+            if (run < 255) run++;
+            if (run >= cfg.onset) {
+                active = true;
+                hang   = cfg.hangover;
+            }
+        } else {
+            run = 0;
+            if (active) {
+                if (hang == 0) active = false;
+                else           hang--;
+            }
+        }
+        return active;
+    }
+
+    bool     isActive()    const { return active;     }
+    uint32_t noiseFloor()  const { return noise;      }
+    uint32_t energy()      const { return lastEnergy; }
+    uint16_t zcr()         const { return lastZcr;    }
+};
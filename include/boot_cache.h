@@ -0,0 +1,103 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include <sys/time.h>
+#include "control/config_stream.h"
+
+// ---------- ค่าที่จำข้าม reboot (NVS) เพื่อให้ boot สั่งงานได้ก่อน cloud พร้อม ----------
+// config ล่าสุด / refresh token ของ anonymous user / Wi-Fi channel+BSSID / เวลาล่าสุด / เลข boot
+// เขียนเฉพาะตอนค่าเปลี่ยน (หรือเวลาทุก BOOT_TIME_SAVE_MS) ถนอม flash
+#ifndef BOOT_CACHE_NS
+#define BOOT_CACHE_NS "gwboot"
+#endif
+
+#ifndef BOOT_TIME_SAVE_MS
+#define BOOT_TIME_SAVE_MS 3600000UL
+#endif
+
+#define BOOT_CACHE_VERSION 1           // เปลี่ยน layout ของ ControlConfig → เพิ่มเลขนี้
+#define BOOT_TOKEN_LEN     512
+
+class BootCache {
+private:
+    Preferences prefs;
+    bool    ok     = false;
+    uint8_t bootNo = 0;
+
+public:
+    void begin() {
+        ok = prefs.begin(BOOT_CACHE_NS, false);
+        if (!ok) {
+            Serial.println("[Boot] NVS open failed, cold boot only");
+            return;
+        }
+        if (prefs.getUChar("ver", 0) != BOOT_CACHE_VERSION) {
+            prefs.clear();
+            prefs.putUChar("ver", BOOT_CACHE_VERSION);
+        }
+        bootNo = (uint8_t)(prefs.getUChar("boot", 0) + 1);
+        prefs.putUChar("boot", bootNo);
+    }
+
+    // เพิ่มทุก boot (วนที่ 256) — แยก key ของ history ที่ ts ซ้ำช่วงก่อน reboot
+    uint8_t bootCount() const { return bootNo; }
+
+    // ---------- config ----------
+    bool loadConfig(ControlConfig &c) {
+        if (!ok || prefs.getBytesLength("cfg") != sizeof(ControlConfig)) return false;
+        return prefs.getBytes("cfg", &c, sizeof(c)) == sizeof(c);
+    }
+
+    void saveConfig(const ControlConfig &c) {
+        if (ok) prefs.putBytes("cfg", &c, sizeof(c));
+    }
+
+    // ---------- refresh token (ใช้ user เดิม ไม่ signUp ใหม่ทุก boot) ----------
+    bool loadToken(char* out, size_t n) {
+        if (!ok) return false;
+        size_t len = prefs.getString("rtok", out, n);
+        return len > 1 && out[0] != '\0';
+    }
+
+    void saveToken(const char* tok) {
+        if (!ok || !tok || !tok[0]) return;
+        char cur[BOOT_TOKEN_LEN];
+        if (loadToken(cur, sizeof(cur)) && strcmp(cur, tok) == 0) return;
+        prefs.putString("rtok", tok);
+    }
+
+    void clearToken() {
+        if (ok) prefs.remove("rtok");
+    }
+
+    // ---------- Wi-Fi (fast connect: ไม่ต้อง scan) ----------
+    bool loadWifi(uint8_t &channel, uint8_t bssid[6]) {
+        if (!ok) return false;
+        channel = prefs.getUChar("ch", 0);
+        return channel != 0 && prefs.getBytes("bssid", bssid, 6) == 6;
+    }
+
+    void saveWifi(uint8_t channel, const uint8_t bssid[6]) {
+        if (!ok) return;
+        uint8_t oldCh, old[6];
+        if (loadWifi(oldCh, old) && oldCh == channel && memcmp(old, bssid, 6) == 0) return;
+        prefs.putUChar("ch", channel);
+        prefs.putBytes("bssid", bssid, 6);
+    }
+
+    // ---------- เวลา: ใช้ไปก่อนจนกว่า NTP จะ sync ----------
+    // ช้ากว่าจริงได้ถึง BOOT_TIME_SAVE_MS + เวลาที่ดับไป → ยังไม่นับว่า sync
+    // (GatewayNetwork::timeSynced) schedule ยังไม่ทำงาน, history ใช้ bootCount() กัน key ซ้ำ
+    bool restoreTime() {
+        if (!ok) return false;
+        uint32_t ts = prefs.getULong("ts", 0);
+        if (ts < 1000000000UL) return false;
+        struct timeval tv = { (time_t)ts, 0 };
+        settimeofday(&tv, nullptr);
+        return true;
+    }
+
+    void saveTime(time_t now) {
+        if (ok && now > 1000000000) prefs.putULong("ts", (uint32_t)now);
+    }
+};
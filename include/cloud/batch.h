@@ -0,0 +1,186 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <Firebase_ESP_Client.h>
+#include "cloud/rtdb_client.h"
+#include "cloud/sink.h"
+
+#ifndef RTDB_BATCH_BUF_SIZE
+#define RTDB_BATCH_BUF_SIZE 768
+#endif
+
+// ---------- รวม RTDB write หลาย path ให้เป็น PATCH เดียว ----------
+// key ของ JSON คือ path เต็ม (ไม่มี '/' นำหน้า) → RTDB multi-path update ที่ root
+// เขียนเฉพาะ leaf ที่ระบุ ไม่ทับ sibling อื่น
+// BUF_SIZE = ขนาด payload สูงสุดต่อ PATCH (เต็มแล้ว flush อัตโนมัติ)
+// เป็น TelemetrySink ตัว default ด้วย (sample ไปรวมใน PATCH เดียวกับ write ของ control)
+template <size_t BUF_SIZE>
+class RtdbBatchBuf : public TelemetrySink {
+private:
+    RtdbClient* fb = nullptr;
+
+    char     buf[BUF_SIZE];
+    size_t   len    = 0;
+    uint16_t fields = 0;
+
+    // ---------- stats ----------
+    uint32_t flushCount  = 0;   // จำนวน round trip ที่ยิงจริง
+    uint32_t fieldCount  = 0;   // จำนวน field ที่เขียนสำเร็จ
+    uint32_t failCount   = 0;
+    uint32_t appended    = 0;   // byte ที่เขียนลง payload ทั้งหมด (ดู TelemetrySink)
+
+    bool appendRaw(const char* s, size_t n) {
+        if (len + n + 2 > sizeof(buf)) return false;   // เผื่อ '}' + '\0'
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = '\0';
+        return true;
+    }
+
+    // prefix (ถ้ามี) ต่อหน้า path เช่น "/nodes/a1b2.." + "/sensor/water_pct"
+    bool appendKey(const char* prefix, const char* path) {
+        if (prefix && prefix[0] == '\0') prefix = nullptr;
+        if (prefix && prefix[0] == '/') prefix++;
+        else if (!prefix && path[0] == '/') path++;
+
+        size_t np = prefix ? strlen(prefix) : 0;
+        size_t n  = strlen(path);
+        if (len + np + n + 4 + 2 > sizeof(buf)) return false;   // , " " : + '}' '\0'
+
+        buf[len++] = (fields == 0) ? '{' : ',';
+        buf[len++] = '"';
+        memcpy(buf + len, prefix, np);
+        len += np;
+        memcpy(buf + len, path, n);
+        len += n;
+        buf[len++] = '"';
+        buf[len++] = ':';
+        buf[len]   = '\0';
+        return true;
+    }
+
+    // เตรียมที่ว่างสำหรับ field ใหม่ ถ้าเต็มให้ flush ก่อน
+    template <typename Fn>
+    void addField(const char* prefix, const char* path, Fn writeValue) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            size_t mark = len;
+            uint8_t markFields = fields;
+            if (appendKey(prefix, path) && writeValue()) {
+                fields++;
+                appended += len - mark;
+                return;
+            }
+            // rollback แล้วลองใหม่หลัง flush
+            len = mark;
+            fields = markFields;
+            buf[len] = '\0';
+            if (fields == 0 || !flush()) break;
+        }
+        Serial.printf("[RTDB] batch drop %s%s (buffer too small)\n", prefix ? prefix : "", path);
+    }
+
+protected:
+    uint32_t appendedBytes() const override { return appended; }
+
+public:
+    RtdbBatchBuf() { buf[0] = '\0'; }
+
+    const char* name() const override { return "rtdb"; }
+
+    void attach(RtdbClient* f) { fb = f; }
+
+    void setInt(const char* path, int v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() {
+            char tmp[16];
+            int n = snprintf(tmp, sizeof(tmp), "%d", v);
+            return appendRaw(tmp, n);
+        });
+    }
+
+    void setFloat(const char* path, float v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() {
+            if (isnan(v) || isinf(v)) return appendRaw("null", 4);
+            char tmp[24];
+            int n = snprintf(tmp, sizeof(tmp), "%.2f", v);
+            return appendRaw(tmp, n);
+        });
+    }
+
+    void setBool(const char* path, bool v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() {
+            return v ? appendRaw("true", 4) : appendRaw("false", 5);
+        });
+    }
+
+    void setString(const char* path, const char* v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() {
+            if (!appendRaw("\"", 1)) return false;
+            for (const char* p = v; *p; p++) {
+                char c = *p;
+                if (c == '"' || c == '\\') {
+                    char esc[2] = {'\\', c};
+                    if (!appendRaw(esc, 2)) return false;
+                } else if ((uint8_t)c < 0x20) {
+                    continue;   // ตัด control char ทิ้ง
+                } else if (!appendRaw(&c, 1)) {
+                    return false;
+                }
+            }
+            return appendRaw("\"", 1);
+        });
+    }
+
+    // value เป็น JSON สำเร็จรูป (object/array) — ผู้เรียกรับผิดชอบว่า valid
+    void setRaw(const char* path, const char* json, const char* prefix = nullptr) {
+        addField(prefix, path, [&]() {
+            return appendRaw(json, strlen(json));
+        });
+    }
+
+    bool empty() const { return fields == 0; }
+    uint16_t pending() const { return fields; }
+
+    // ยิง PATCH เดียวสำหรับทุก field ที่ค้างอยู่
+    bool flush() override {
+        if (fields == 0) return true;
+
+        uint16_t n = fields;
+        bool ok = false;
+        if (fb) {
+            buf[len] = '}';
+            buf[len + 1] = '\0';
+
+            FirebaseJson json;
+            json.setJsonData(buf);
+            ok = fb->patch("/", &json);
+        }
+
+        flushCount++;
+        if (ok) {
+            fieldCount += n;
+            if (n > 1) {
+                Serial.printf("[RTDB] batch %u fields -> 1 call (saved %lu total)\n",
+                              n, (unsigned long)roundTripsSaved());
+            }
+        } else {
+            failCount++;
+            Serial.printf("[RTDB] batch update failed (%u fields): %s\n",
+                          n, fb ? fb->errorReason().c_str() : "no client");
+        }
+
+        len = 0;
+        fields = 0;
+        buf[0] = '\0';
+        return ok;
+    }
+
+    uint32_t roundTrips()      const override { return flushCount; }
+    uint32_t fieldsWritten()   const { return fieldCount; }
+    uint32_t failures()        const override { return failCount;  }
+    uint32_t roundTripsSaved() const {
+        uint32_t okCalls = flushCount - failCount;
+        return fieldCount > okCalls ? fieldCount - okCalls : 0;
+    }
+};
+
+typedef RtdbBatchBuf<RTDB_BATCH_BUF_SIZE> RtdbBatch;
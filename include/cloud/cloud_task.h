@@ -0,0 +1,272 @@
+#pragma once
+#include <Arduino.h>
+#include <Firebase_ESP_Client.h>
+#include "constant.h"
+#include "gateway.h"
+#include "node_table.h"
+#include "cloud/rtdb_client.h"
+#include "cloud/batch.h"
+#include "cloud/outbox.h"
+#include "cloud/history.h"
+#if TELEMETRY_SINK == TLM_SINK_MQTT
+#include "cloud/mqtt_sink.h"
+#endif
+#include "control/config_stream.h"
+#ifdef TRACE_RECORD
+#include "trace/recorder.h"
+#endif
+
+#ifndef CLOUD_TASK_CORE
+#define CLOUD_TASK_CORE 0              // อยู่ core เดียวกับ Wi-Fi stack
+#endif
+
+#ifndef CLOUD_TASK_PRIO
+#define CLOUD_TASK_PRIO 2
+#endif
+
+#ifndef CLOUD_TASK_STACK
+#define CLOUD_TASK_STACK 12288
+#endif
+
+#ifndef CLOUD_TASK_IDLE_MS
+#define CLOUD_TASK_IDLE_MS 100         // ตื่นมาเช็ค polling/stream อย่างน้อยทุกเท่านี้
+#endif
+
+#ifndef CLOUD_STATS_MS
+#define CLOUD_STATS_MS 60000
+#endif
+
+#ifndef CLOUD_STREAM_RETRY_MS
+#define CLOUD_STREAM_RETRY_MS 30000
+#endif
+
+// ---------- network task: เจ้าของ RtdbClient ตัวเดียวที่ใช้ยิง RTDB ----------
+// control path คุยผ่าน outbox (write) กับ config cache (read) เท่านั้น
+class CloudTask {
+private:
+    GatewayNetwork* net;
+    NodeTable*      nodes;
+    RtdbClient      rtdb;
+    RtdbBatch       batch;
+#if TELEMETRY_SINK == TLM_SINK_MQTT
+    MqttSink        mqtt;
+    TelemetrySink*  sink = &mqtt;      // sample ไป broker, ที่เหลือ (diag / history / config) ยัง RTDB
+#else
+    TelemetrySink*  sink = &batch;
+#endif
+    RtdbOutbox      out;
+    ConfigStream    cfg;
+    TelemetryStore  hist;
+#ifdef TRACE_RECORD
+    TraceRecorder   tr;
+#endif
+
+    volatile bool   onlineFlag = false;
+    volatile bool   tlmFlag    = false;  // online และ sink พร้อมรับ sample
+    bool            started    = false;
+
+    uint32_t      savedCfgVersion = 0;   // version ของ config ที่เขียนลง NVS แล้ว
+
+    TaskHandle_t  handle        = nullptr;
+    unsigned long lastPoll      = 0;
+    unsigned long lastStreamTry = 0;
+    unsigned long lastStats     = 0;
+
+    static void taskEntry(void* arg) {
+        static_cast<CloudTask*>(arg)->run();
+    }
+
+    void run() {
+        Serial.printf("[Cloud] Task Running on CORE %d\n", CLOUD_TASK_CORE);
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CLOUD_TASK_IDLE_MS));
+            step();
+        }
+    }
+
+    // ดึงทุก record ที่ค้างอยู่ → PATCH เดียว (push แยก เพราะต้องได้ key ใหม่)
+    // sample (W_TELEMETRY) ไปที่ sink → ถ้า sink = RTDB ก็รวมอยู่ใน PATCH เดียวกัน
+    void drain() {
+        RtdbWrite w;
+        while (out.pop(w)) {
+            const char* pre = (w.node == RtdbWrite::NO_NODE || !nodes)
+                              ? nullptr : nodes->pathPrefix(w.node);
+            switch (w.kind) {
+                case RtdbWrite::W_INT:    batch.setInt(w.path, w.i, pre);      break;
+                case RtdbWrite::W_FLOAT:  batch.setFloat(w.path, w.f, pre);    break;
+                case RtdbWrite::W_BOOL:   batch.setBool(w.path, w.b, pre);     break;
+                case RtdbWrite::W_STRING: batch.setString(w.path, w.str, pre); break;
+                case RtdbWrite::W_RECORD: w.emit(batch, w.str, w.mask, pre);   break;
+                case RtdbWrite::W_TELEMETRY:
+                    sink->sampleBegin();
+                    w.emit(*sink, w.str, w.mask, pre);
+                    sink->sampleEnd();
+                    break;
+            }
+        }
+        batch.flush();
+        if (sink != &batch) sink->flush();
+    }
+
+    // คำสั่งจาก LAN apply ที่ gateway แล้ว → เขียนตามขึ้น RTDB (ก่อน poll/stream จะดึงค่าเก่ากลับมา)
+    void syncLocal() {
+        ControlConfig c;
+        uint8_t f = cfg.takeLocal(c);
+        if (!f) return;
+        if (f & ConfigStream::LOCAL_MODE)   batch.setString(PATH_CTRL_MODE, controlModeText(c.mode));
+        if (f & ConfigStream::LOCAL_MANUAL) batch.setBool(PATH_CTRL_MANUAL, c.manual);
+        if (f & ConfigStream::LOCAL_TARGET) batch.setInt(PATH_CTRL_TARGET_HUMID, c.targetHumid);
+        if (!batch.flush()) cfg.requeueLocal(f);
+    }
+
+    // fallback เมื่อ stream ไม่ live: GET ทีละ path ทุก CONFIG_POLL_MS
+    void pollConfig() {
+        if (lastPoll != 0 && millis() - lastPoll < CONFIG_POLL_MS) return;
+        lastPoll = millis();
+
+        ControlConfig c;
+        cfg.snapshot(c);
+
+        String s;
+        if (rtdb.get(PATH_CTRL_MODE, s))
+            c.mode = controlModeFromText(s.c_str());
+        rtdb.get(PATH_CTRL_MANUAL, c.manual);
+        rtdb.get(PATH_CTRL_TARGET_HUMID, c.targetHumid);
+        rtdb.get(PATH_SCHED_ENABLE, c.schedEnable);
+        if (rtdb.get(PATH_SCHED_START, s))
+            c.schedStartMin = configParseHHMM(s.c_str());
+        if (rtdb.get(PATH_SCHED_STOP, s))
+            c.schedStopMin = configParseHHMM(s.c_str());
+        if (rtdb.get(PATH_SCHED_WINDOWS, s))
+            c.schedWindowCount = schedParseWindows(s.c_str(), c.schedWindows, SCHED_MAX_WINDOWS);
+        else if (rtdb.missing())
+            c.schedWindowCount = 0;      // path ถูกลบ → กลับไปใช้ start/stop
+
+        cfg.publish(c);
+    }
+
+    // config เปลี่ยน → จำลง NVS ไว้ใช้ตอน boot ครั้งหน้า
+    void saveConfig() {
+        uint32_t v = cfg.getVersion();
+        if (v == 0 || v == savedCfgVersion) return;
+        ControlConfig c;
+        savedCfgVersion = cfg.snapshot(c);
+        net->bootCache().saveConfig(c);
+    }
+
+    void printStats() {
+        rtdb.printStats();
+        batch.setInt("/heap_min",      (int)rtdb.heapMin(),     PATH_DIAG_RTDB);
+        batch.setInt("/heap_peak_use", (int)rtdb.heapPeakUse(), PATH_DIAG_RTDB);
+        batch.setInt("/heap_sys_min",  (int)ESP.getMinFreeHeap(), PATH_DIAG_RTDB);
+#ifdef TRACE_RECORD
+        tr.printStats();
+#endif
+        Serial.printf("[Sink] %s samples=%lu rate=%.1f/s %.1f B/sample calls=%lu fail=%lu\n",
+                      sink->name(), (unsigned long)sink->sampleCount(), sink->sampleRate(),
+                      sink->bytesPerSample(), (unsigned long)sink->roundTrips(),
+                      (unsigned long)sink->failures());
+#if TELEMETRY_SINK == TLM_SINK_MQTT
+        mqtt.printStats();
+#endif
+        Serial.printf("[Cloud] q=%u/%u hw=%u drop=%lu enq_max=%luus rtdb_calls=%lu saved=%lu\n",
+                      (unsigned)out.depth(), (unsigned)out.capacity(),
+                      out.depthHighWater(),
+                      (unsigned long)out.dropCount(),
+                      (unsigned long)out.maxEnqueueUs(),
+                      (unsigned long)batch.roundTrips(),
+                      (unsigned long)batch.roundTripsSaved());
+        Serial.printf("[History] backlog=%lu (flash %lu) drained=%lu rate=%.1f/s evicted=%lu drop=%lu\n",
+                      (unsigned long)hist.backlog(),
+                      (unsigned long)hist.diskBacklog(),
+                      (unsigned long)hist.drainedCount(),
+                      hist.drainRate(),
+                      (unsigned long)hist.evictedCount(),
+                      (unsigned long)hist.droppedCount());
+    }
+
+public:
+    CloudTask(GatewayNetwork* n, NodeTable* t) : net(n), nodes(t) {}
+
+    void begin() {
+        // warm start: config ล่าสุดจาก NVS → control สั่งงานได้ก่อน cloud พร้อม
+        ControlConfig warm;
+        if (net->bootCache().loadConfig(warm)) {
+            cfg.publish(warm);
+            savedCfgVersion = cfg.getVersion();
+            Serial.println("[Cloud] Config restored from NVS");
+        }
+
+        xTaskCreatePinnedToCore(
+            taskEntry, "CloudTask", CLOUD_TASK_STACK,
+            this, CLOUD_TASK_PRIO, &handle, CLOUD_TASK_CORE
+        );
+        out.setConsumer(handle);
+    }
+
+    // 1 รอบของ task: run() เรียกทุกครั้งที่ตื่น, env:native เรียกตรงตามเวลาจำลอง
+    void step() {
+        if (!started) {
+            started = true;
+            rtdb.begin();
+            batch.attach(&rtdb);
+            hist.begin();
+#ifdef TRACE_RECORD
+            tr.begin();
+#endif
+        }
+#ifdef TRACE_RECORD
+        tr.spill();
+#endif
+
+        net->service();          // Wi-Fi → NTP → Firebase auth (ไม่ block control)
+        onlineFlag = net->ok();
+        sink->service();         // MQTT: connect / keep-alive / PUBACK / batch ที่ครบอายุ
+        tlmFlag = onlineFlag && sink->ready();
+        if (!onlineFlag) {
+            hist.spill();     // offline → ย้าย sample จาก RAM ลง flash
+            return;
+        }
+
+        syncLocal();
+
+        // stream ยังไม่เริ่ม → ลองใหม่เป็นระยะ
+        if (CONFIG_STREAM_ENABLE && !cfg.isStarted() &&
+            (lastStreamTry == 0 || millis() - lastStreamTry > CLOUD_STREAM_RETRY_MS)) {
+            lastStreamTry = millis();
+            cfg.begin(rtdb);
+        }
+
+        drain();
+
+        // live traffic ว่างแล้ว → ค่อยส่ง backlog (จำกัดอัตรา)
+        if (out.depth() == 0) hist.drain(&rtdb);
+
+        if (!cfg.isLive()) pollConfig();
+        saveConfig();
+
+        if (millis() - lastStats > CLOUD_STATS_MS) {
+            lastStats = millis();
+            printStats();
+        }
+    }
+
+    RtdbOutbox&     outbox()  { return out;  }
+    ConfigStream&   config()  { return cfg;  }
+    TelemetryStore& history() { return hist; }
+#ifdef TRACE_RECORD
+    TraceRecorder&  trace()   { return tr;   }
+#endif
+
+    TaskHandle_t    task() const { return handle; }
+
+    // Firebase พร้อมหรือไม่ (ตามรอบล่าสุดของ task) — ไม่พร้อม = เก็บลง history แทน
+    bool online() const { return onlineFlag; }
+
+    // ส่ง sample ได้หรือไม่ (MQTT ต้องต่อ broker อยู่ด้วย) — ไม่ได้ = เก็บลง history แทน
+    bool telemetryOnline() const { return tlmFlag; }
+
+    TelemetrySink&   telemetry()       { return *sink; }
+
+    const RtdbBatch& rtdbBatch() const { return batch; }
+};
@@ -0,0 +1,313 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Firebase_ESP_Client.h>
+#include "constant.h"
+#include "spsc_ring.h"
+#include "cloud/batch.h"
+
+// ---------- store-and-forward ตอน Wi-Fi / Firebase หลุด ----------
+#ifndef PATH_HISTORY
+#define PATH_HISTORY "/history"        // MongoDB trigger ดึงจากตรงนี้
+#endif
+
+#ifndef TLM_RAM_DEPTH
+#define TLM_RAM_DEPTH 64               // ต้องเป็นกำลังสอง
+#endif
+
+#ifndef TLM_SEGMENT_RECORDS
+#define TLM_SEGMENT_RECORDS 512        // record ต่อไฟล์ segment
+#endif
+
+#ifndef TLM_MAX_SEGMENTS
+#define TLM_MAX_SEGMENTS 32            // เกินนี้ลบ segment เก่าสุดทิ้ง
+#endif
+
+#ifndef TLM_DRAIN_PER_SEC
+#define TLM_DRAIN_PER_SEC 40           // จำกัดอัตรา drain ไม่ให้แย่ง live traffic
+#endif
+
+#ifndef TLM_DRAIN_BATCH
+#define TLM_DRAIN_BATCH 32             // record ต่อ PATCH สูงสุด
+#endif
+
+#ifndef TLM_DRAIN_BUF_SIZE
+#define TLM_DRAIN_BUF_SIZE 4096
+#endif
+
+#define TLM_DIR "/tlm"
+
+// ---------- 1 sample (fixed size, เขียนลงไฟล์ตรง ๆ) ----------
+struct __attribute__((packed)) TelemetryRecord {
+    static const uint8_t NODE_ENV = 0xFF;   // sample ของ DHT บน gateway
+
+    uint32_t ts;           // epoch (วินาที)
+    uint16_t ms;           // millis() % 1000 กัน key ชนกันในวินาทีเดียว
+    uint8_t  node;
+    uint8_t  tilt;
+    int16_t  waterPct;
+    int16_t  waterRaw;
+    int16_t  temp10;       // °C x10
+    int16_t  hum10;        // %RH x10
+    uint8_t  ctrl;
+    uint8_t  boot;         // BootCache::bootCount() — ts หลัง reboot อาจซ้ำช่วงที่ส่งไปแล้ว
+};
+
+// ---------- RAM ring → LittleFS segment log → RTDB ----------
+// producer (control task) แค่ record() ลง RAM ring
+// cloud task: spill() ย้ายลงไฟล์ตอน offline, drain() ส่งเป็น batch ตอน online
+class TelemetryStore {
+private:
+    SpscRing<TelemetryRecord, TLM_RAM_DEPTH> ram;
+    RtdbBatchBuf<TLM_DRAIN_BUF_SIZE>         batch;
+
+    bool     fsOk     = false;
+    uint32_t headSeg  = 0;     // segment เก่าสุด (อ่าน)
+    uint32_t tailSeg  = 0;     // segment ที่กำลังเขียน
+    uint32_t headOff  = 0;     // record ที่ drain ไปแล้วใน headSeg
+    uint32_t tailRecs = 0;     // record ใน tailSeg
+    uint32_t diskRecs = 0;     // backlog บน flash (ยังไม่ drain)
+
+    // token bucket สำหรับ drain rate
+    float         tokens     = 0;
+    unsigned long lastRefill = 0;
+
+    // ---------- stats ----------
+    uint32_t recorded   = 0;
+    uint32_t ramDrops   = 0;
+    uint32_t evicted    = 0;   // record ที่หายเพราะ segment เก่าถูกลบ
+    uint32_t drained    = 0;
+    uint32_t winDrained = 0;
+    unsigned long winStart = 0;
+    float    rate       = 0;   // record/s ของหน้าต่างล่าสุด
+
+    static void segPath(char* out, size_t n, uint32_t seg) {
+        snprintf(out, n, TLM_DIR "/%08lu.bin", (unsigned long)seg);
+    }
+
+    static uint32_t fileRecords(uint32_t seg) {
+        char p[32];
+        segPath(p, sizeof(p), seg);
+        File f = LittleFS.open(p, FILE_READ);
+        if (!f) return 0;
+        uint32_t n = f.size() / sizeof(TelemetryRecord);
+        f.close();
+        return n;
+    }
+
+    // หา segment ที่ค้างจากรอบก่อน reboot
+    void scan() {
+        File dir = LittleFS.open(TLM_DIR);
+        if (!dir || !dir.isDirectory()) {
+            LittleFS.mkdir(TLM_DIR);
+            return;
+        }
+
+        bool any = false;
+        uint32_t lo = 0, hi = 0;
+        for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+            const char* name = f.name();
+            const char* slash = strrchr(name, '/');
+            uint32_t seg = (uint32_t)strtoul(slash ? slash + 1 : name, nullptr, 10);
+            f.close();
+            if (!any || seg < lo) lo = seg;
+            if (!any || seg > hi) hi = seg;
+            any = true;
+        }
+        dir.close();
+        if (!any) return;
+
+        headSeg = lo;
+        tailSeg = hi;
+        for (uint32_t s = lo; s <= hi; s++) diskRecs += fileRecords(s);
+        tailRecs = fileRecords(hi);
+    }
+
+    void evictOldest() {
+        if (headSeg == tailSeg) return;
+        char p[32];
+        segPath(p, sizeof(p), headSeg);
+        uint32_t n = fileRecords(headSeg);
+        uint32_t lost = (n > headOff) ? n - headOff : 0;
+        LittleFS.remove(p);
+
+        evicted  += lost;
+        diskRecs -= (lost <= diskRecs) ? lost : diskRecs;
+        headSeg++;
+        headOff = 0;
+    }
+
+    bool appendDisk(const TelemetryRecord &r) {
+        if (tailRecs >= TLM_SEGMENT_RECORDS) {
+            tailSeg++;
+            tailRecs = 0;
+            while (tailSeg - headSeg >= TLM_MAX_SEGMENTS) evictOldest();
+        }
+
+        char p[32];
+        segPath(p, sizeof(p), tailSeg);
+        File f = LittleFS.open(p, FILE_APPEND);
+        if (!f) return false;
+        bool ok = f.write((const uint8_t*)&r, sizeof(r)) == sizeof(r);
+        f.close();
+        if (ok) {
+            tailRecs++;
+            diskRecs++;
+        }
+        return ok;
+    }
+
+    // record → 1 field ของ multi-path update: history/<ts>_<ms>_<node>_<boot> = {...}
+    void addToBatch(const TelemetryRecord &r) {
+        char key[48];
+        snprintf(key, sizeof(key), PATH_HISTORY "/%lu_%03u_%u_%u",
+                 (unsigned long)r.ts, (unsigned)r.ms, (unsigned)r.node, (unsigned)r.boot);
+
+        char val[128];
+        if (r.node == TelemetryRecord::NODE_ENV) {
+            snprintf(val, sizeof(val), "{\"ts\":%lu,\"temp\":%.1f,\"humid\":%.1f}",
+                     (unsigned long)r.ts, r.temp10 / 10.0f, r.hum10 / 10.0f);
+        } else {
+            snprintf(val, sizeof(val),
+                     "{\"ts\":%lu,\"node\":%u,\"water_pct\":%d,\"water_raw\":%d,\"tilt\":%u,\"control\":%s}",
+                     (unsigned long)r.ts, (unsigned)r.node, r.waterPct, r.waterRaw,
+                     (unsigned)r.tilt, r.ctrl ? "true" : "false");
+        }
+        batch.setRaw(key, val);
+    }
+
+    void refill() {
+        unsigned long now = millis();
+        if (lastRefill == 0) lastRefill = now;
+        tokens += (now - lastRefill) * (TLM_DRAIN_PER_SEC / 1000.0f);
+        if (tokens > TLM_DRAIN_BATCH) tokens = TLM_DRAIN_BATCH;
+        lastRefill = now;
+    }
+
+    // อ่าน record ถัดไปจาก disk (ไม่ขยับ offset จนกว่าจะส่งสำเร็จ)
+    uint32_t readDisk(TelemetryRecord* out, uint32_t max) {
+        if (diskRecs == 0) return 0;
+
+        char p[32];
+        segPath(p, sizeof(p), headSeg);
+        File f = LittleFS.open(p, FILE_READ);
+        if (!f) return 0;
+        f.seek(headOff * sizeof(TelemetryRecord));
+        uint32_t n = f.read((uint8_t*)out, max * sizeof(TelemetryRecord)) / sizeof(TelemetryRecord);
+        f.close();
+        return n;
+    }
+
+    void commitDisk(uint32_t n) {
+        headOff  += n;
+        diskRecs -= (n <= diskRecs) ? n : diskRecs;
+
+        // segment นี้หมดแล้ว (และไม่ใช่ตัวที่กำลังเขียน) → ลบทิ้ง
+        if (headSeg != tailSeg && headOff >= fileRecords(headSeg)) {
+            char p[32];
+            segPath(p, sizeof(p), headSeg);
+            LittleFS.remove(p);
+            headSeg++;
+            headOff = 0;
+        } else if (headSeg == tailSeg && headOff >= tailRecs) {
+            char p[32];
+            segPath(p, sizeof(p), headSeg);
+            LittleFS.remove(p);
+            headSeg = ++tailSeg;
+            headOff = 0;
+            tailRecs = 0;
+        }
+    }
+
+public:
+    // cloud task เรียกครั้งเดียวตอนเริ่ม
+    void begin() {
+        fsOk = LittleFS.begin(true);
+        if (!fsOk) {
+            Serial.println("[History] LittleFS mount failed, RAM buffer only");
+            return;
+        }
+        scan();
+        if (diskRecs) {
+            Serial.printf("[History] %lu samples pending from previous run\n",
+                          (unsigned long)diskRecs);
+        }
+    }
+
+    // ---------- producer (control task) ----------
+    void record(const TelemetryRecord &r) {
+        if (ram.push(r)) recorded++;
+        else             ramDrops++;
+    }
+
+    // ---------- consumer (cloud task) ----------
+    // ย้าย RAM → flash (ตอน offline) เพื่อให้ RAM ring ว่างรับต่อ
+    void spill() {
+        if (!fsOk) return;
+        TelemetryRecord r;
+        while (ram.pop(r)) appendDisk(r);
+    }
+
+    // ส่ง backlog เก่าสุดก่อน (flash แล้วค่อย RAM) ไม่เกิน TLM_DRAIN_PER_SEC
+    // คืนจำนวน record ที่ส่งสำเร็จ
+    uint32_t drain(RtdbClient* fb) {
+        refill();
+        uint32_t budget = (uint32_t)tokens;
+        if (budget == 0 || backlog() == 0) return 0;
+        if (budget > TLM_DRAIN_BATCH) budget = TLM_DRAIN_BATCH;
+
+        batch.attach(fb);
+        TelemetryRecord recs[TLM_DRAIN_BATCH];
+        uint32_t fromDisk = fsOk ? readDisk(recs, budget) : 0;
+        uint32_t n = fromDisk;
+        for (uint32_t i = 0; i < n; i++) addToBatch(recs[i]);
+
+        // flash หมดแล้ว → ต่อด้วย RAM (ของใน RAM ใหม่กว่า flash เสมอ)
+        uint32_t fromRam = 0;
+        if (diskRecs == fromDisk) {
+            while (n < budget && ram.pop(recs[n])) {
+                addToBatch(recs[n]);
+                n++;
+                fromRam++;
+            }
+        }
+
+        if (n == 0) return 0;
+        bool ok = batch.flush();
+
+        if (ok) {
+            if (fromDisk) commitDisk(fromDisk);
+        } else if (fromRam && fsOk) {
+            // ส่งไม่ผ่าน → ของจาก RAM ไปรอบน flash (ลำดับยังเก่า→ใหม่)
+            for (uint32_t i = fromDisk; i < n; i++) appendDisk(recs[i]);
+        }
+        if (!ok) return 0;
+
+        tokens     -= n;
+        drained    += n;
+        winDrained += n;
+        return n;
+    }
+
+    // ---------- metrics ----------
+    uint32_t backlog() const { return diskRecs + (uint32_t)ram.size(); }
+
+    // อัปเดต throughput ของหน้าต่างล่าสุด (เรียกตอนพิมพ์ stats)
+    float drainRate() {
+        unsigned long now = millis();
+        if (winStart == 0) winStart = now;
+        unsigned long dt = now - winStart;
+        if (dt >= 1000) {
+            rate       = winDrained * 1000.0f / dt;
+            winDrained = 0;
+            winStart   = now;
+        }
+        return rate;
+    }
+
+    uint32_t recordedCount() const { return recorded; }
+    uint32_t drainedCount()  const { return drained;  }
+    uint32_t droppedCount()  const { return ramDrops; }
+    uint32_t evictedCount()  const { return evicted;  }
+    uint32_t diskBacklog()   const { return diskRecs; }
+};
@@ -0,0 +1,502 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <math.h>
+#include <stdarg.h>
+#include <time.h>
+#include "cloud/sink.h"
+
+// ---------- telemetry → MQTT 3.1.1 (TELEMETRY_SINK=TLM_SINK_MQTT) ----------
+// client ขนาดเล็กเขียนเอง: CONNECT (persistent session) / PUBLISH QoS 0,1 / PUBACK / PINGREQ
+// หลาย sample รวมเป็น PUBLISH เดียว (เต็ม MQTT_BATCH_BUF หรือครบ MQTT_BATCH_MS)
+//   {"ts":epoch,"r":[{"p":"nodes/<mac>/sensor","dt":ms,"water_pct":80,...},{"p":"sensor","dt":..,"temp":28.1}]}
+//   p = path ของ RTDB ตัด leaf ออก, dt = ms หลัง ts, key = leaf ของ path
+// QoS 1: packet ที่ยังไม่ได้ PUBACK เก็บไว้ทั้งก้อน → ต่อใหม่ (session เดิม) ส่งซ้ำพร้อม DUP
+// ใช้จาก cloud task เท่านั้น (ไม่มี lock)
+#ifndef MQTT_HOST
+#define MQTT_HOST "mqtt.local"
+#endif
+
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+
+#ifndef MQTT_USER
+#define MQTT_USER ""
+#endif
+
+#ifndef MQTT_PASS
+#define MQTT_PASS ""
+#endif
+
+#ifndef MQTT_TOPIC
+#define MQTT_TOPIC "gateway/tlm"
+#endif
+
+#ifndef MQTT_QOS
+#define MQTT_QOS 1                     // 0 หรือ 1
+#endif
+
+#ifndef MQTT_CLEAN_SESSION
+#define MQTT_CLEAN_SESSION 0           // 0 = persistent session (broker จำ session ข้าม reconnect)
+#endif
+
+#ifndef MQTT_KEEPALIVE_S
+#define MQTT_KEEPALIVE_S 30
+#endif
+
+#ifndef MQTT_BATCH_BUF
+#define MQTT_BATCH_BUF 512             // payload สูงสุดต่อ PUBLISH
+#endif
+
+#ifndef MQTT_BATCH_MS
+#define MQTT_BATCH_MS 1000             // sample แรกใน batch รอได้นานสุดเท่านี้
+#endif
+
+#ifndef MQTT_INFLIGHT
+#define MQTT_INFLIGHT 4                // QoS 1 ที่รอ PUBACK พร้อมกันได้
+#endif
+
+#ifndef MQTT_ACK_WAIT_MS
+#define MQTT_ACK_WAIT_MS 200           // inflight เต็ม → รอ PUBACK ได้นานสุดเท่านี้
+#endif
+
+#ifndef MQTT_RETRY_MS
+#define MQTT_RETRY_MS 5000
+#endif
+
+#ifndef MQTT_CONNECT_TIMEOUT_MS
+#define MQTT_CONNECT_TIMEOUT_MS 3000   // TCP connect → CONNACK
+#endif
+
+#ifndef MQTT_CONNECT_BUF
+#define MQTT_CONNECT_BUF 256           // CONNECT body: header 10 + client id + user + pass
+#endif
+
+#define MQTT_PKT_MAX (MQTT_BATCH_BUF + sizeof(MQTT_TOPIC) + 8)
+
+class MqttSink : public TelemetrySink {
+private:
+    enum State : uint8_t { M_IDLE, M_CONNECTING, M_UP };
+
+    struct Inflight {
+        bool     used = false;
+        uint16_t id   = 0;
+        uint16_t len  = 0;
+        uint8_t  pkt[MQTT_PKT_MAX];
+    };
+
+    WiFiClient  sock;
+    State       st   = M_IDLE;
+    char        clientId[24] = "";
+    const char* host = MQTT_HOST;
+    uint16_t    port = MQTT_PORT;
+
+    // ---------- batch ที่กำลังสะสม ----------
+    char          buf[MQTT_BATCH_BUF];
+    size_t        len      = 0;
+    uint16_t      recs     = 0;        // object ใน "r"
+    char          dir[48]  = "";       // "p" ของ object ที่เปิดอยู่
+    bool          fresh    = true;     // sample ใหม่ → field ถัดไปเปิด object ใหม่
+    unsigned long batchMs  = 0;        // millis() ตอน sample แรกของ batch
+    uint32_t      appended = 0;
+
+    // ---------- QoS 1 ----------
+    Inflight inflight[MQTT_QOS ? MQTT_INFLIGHT : 1];
+    uint16_t nextId = 1;
+
+    // ---------- rx (รับแค่ CONNACK / PUBACK / PINGRESP ที่ยาวไม่เกิน 4 byte) ----------
+    uint8_t  rxHdr   = 0;
+    uint32_t rxRem   = 0;
+    uint32_t rxMul   = 1;
+    uint8_t  rxStage = 0;              // 0 header, 1 remaining length, 2 body
+    uint8_t  rxBody[4];
+    uint32_t rxGot   = 0;
+
+    unsigned long lastTry  = 0;
+    unsigned long connMs   = 0;
+    unsigned long lastTx   = 0;
+    unsigned long pingMs   = 0;        // 0 = ไม่มี PINGREQ ค้าง
+
+    // ---------- stats ----------
+    uint32_t publishes  = 0;
+    uint32_t acks       = 0;
+    uint32_t resent     = 0;
+    uint32_t failCount  = 0;
+    uint32_t dropped    = 0;           // field ที่ไม่มีที่ลง
+    uint32_t reconnects = 0;
+    uint32_t wireBytes  = 0;           // PUBLISH ทั้ง packet (header + topic + payload)
+    bool     resumed    = false;       // CONNACK ล่าสุดบอกว่า broker มี session เดิม
+
+    // ---------- encode ----------
+    static size_t putLen(uint8_t* p, uint32_t n) {
+        size_t i = 0;
+        do {
+            uint8_t b = n & 0x7F;
+            n >>= 7;
+            p[i++] = n ? (uint8_t)(b | 0x80) : b;
+        } while (n);
+        return i;
+    }
+
+    static size_t putStr(uint8_t* p, const char* s) {
+        size_t n = strlen(s);
+        p[0] = (uint8_t)(n >> 8);
+        p[1] = (uint8_t)n;
+        memcpy(p + 2, s, n);
+        return n + 2;
+    }
+
+    bool send(const uint8_t* p, size_t n) {
+        if (sock.write(p, n) != n) {
+            failCount++;
+            drop("write failed");
+            return false;
+        }
+        lastTx = millis();
+        return true;
+    }
+
+    void drop(const char* why) {
+        if (st != M_IDLE) Serial.printf("[MQTT] disconnected (%s)\n", why);
+        sock.stop();
+        st      = M_IDLE;
+        pingMs  = 0;
+        rxStage = 0;
+    }
+
+    void connect() {
+        lastTry = millis();
+        if (!clientId[0]) {
+            uint8_t mac[6];
+            WiFi.macAddress(mac);
+            snprintf(clientId, sizeof(clientId), "gw-%02x%02x%02x%02x%02x%02x",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        }
+        const char* user = MQTT_USER;
+        const char* pass = MQTT_PASS;
+        size_t need = 10 + 2 + strlen(clientId)
+                    + (user[0] ? 2 + strlen(user) : 0)
+                    + (pass[0] ? 2 + strlen(pass) : 0);
+        uint8_t body[MQTT_CONNECT_BUF];
+        if (need > sizeof(body)) {
+            failCount++;
+            Serial.printf("[MQTT] CONNECT needs %u B > MQTT_CONNECT_BUF %u (user/pass too long)\n",
+                          (unsigned)need, (unsigned)sizeof(body));
+            return;
+        }
+
+        if (!sock.connect(host, port)) {
+            failCount++;
+            return;
+        }
+
+        size_t  n = putStr(body, "MQTT");
+        body[n++] = 4;                                     // protocol level 3.1.1
+        body[n++] = (uint8_t)((MQTT_CLEAN_SESSION ? 0x02 : 0) |
+                              (user[0] ? 0x80 : 0) | (pass[0] ? 0x40 : 0));
+        body[n++] = (uint8_t)(MQTT_KEEPALIVE_S >> 8);
+        body[n++] = (uint8_t)MQTT_KEEPALIVE_S;
+        n += putStr(body + n, clientId);
+        if (user[0]) n += putStr(body + n, user);
+        if (pass[0]) n += putStr(body + n, pass);
+
+        uint8_t hdr[5];
+        hdr[0] = 0x10;
+        size_t h = 1 + putLen(hdr + 1, (uint32_t)n);
+        st     = M_CONNECTING;
+        connMs = millis();
+        if (send(hdr, h)) send(body, n);
+    }
+
+    // broker ตอบรับแล้ว → ส่ง QoS 1 ที่ค้างซ้ำ (DUP)
+    void onConnack(uint8_t flags, uint8_t rc) {
+        if (rc != 0) {
+            Serial.printf("[MQTT] connect refused rc=%u\n", rc);
+            failCount++;
+            drop("refused");
+            return;
+        }
+        st      = M_UP;
+        resumed = flags & 1;
+        reconnects++;
+        Serial.printf("[MQTT] connected %s:%u as %s (session %s)\n", host, (unsigned)port,
+                      clientId, resumed ? "resumed" : "new");
+        for (Inflight &f : inflight) {
+            if (!f.used || !MQTT_QOS) continue;
+            f.pkt[0] |= 0x08;
+            if (!send(f.pkt, f.len)) return;
+            resent++;
+            wireBytes += f.len;
+        }
+    }
+
+    void onPacket() {
+        uint8_t type = rxHdr >> 4;
+        if (type == 2 && rxGot >= 2) {                      // CONNACK
+            onConnack(rxBody[0], rxBody[1]);
+        } else if (type == 4 && rxGot >= 2) {               // PUBACK
+            uint16_t id = (uint16_t)((rxBody[0] << 8) | rxBody[1]);
+            for (Inflight &f : inflight) {
+                if (f.used && f.id == id) {
+                    f.used = false;
+                    acks++;
+                }
+            }
+        } else if (type == 13) {                            // PINGRESP
+            pingMs = 0;
+        }
+    }
+
+    // อ่านทุก byte ที่มา (ไม่ block)
+    void poll() {
+        while (st != M_IDLE && sock.available() > 0) {
+            int c = sock.read();
+            if (c < 0) break;
+            uint8_t b = (uint8_t)c;
+            switch (rxStage) {
+                case 0:
+                    rxHdr = b; rxRem = 0; rxMul = 1; rxGot = 0; rxStage = 1;
+                    break;
+                case 1:
+                    rxRem += (b & 0x7F) * rxMul;
+                    rxMul <<= 7;
+                    if (b & 0x80) break;
+                    rxStage = 2;
+                    if (rxRem == 0) { onPacket(); rxStage = 0; }
+                    break;
+                default:
+                    if (rxGot < sizeof(rxBody)) rxBody[rxGot] = b;
+                    if (++rxGot == rxRem) { onPacket(); rxStage = 0; }
+                    break;
+            }
+        }
+        if (st != M_IDLE && !sock.connected()) drop("closed by broker");
+    }
+
+    Inflight* freeSlot() {
+        for (Inflight &f : inflight) if (!f.used) return &f;
+        return nullptr;
+    }
+
+    // ---------- batch ----------
+    bool appendRaw(const char* s, size_t n) {
+        if (len + n + 4 > sizeof(buf)) return false;       // เผื่อ "}]}" + '\0'
+        memcpy(buf + len, s, n);
+        len += n;
+        return true;
+    }
+
+    bool appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char tmp[64];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+        va_end(ap);
+        return n > 0 && (size_t)n < sizeof(tmp) && appendRaw(tmp, n);
+    }
+
+    // path เต็มแบบเดียวกับ RtdbBatch → object ต่อ dir + key = leaf
+    bool appendKey(const char* prefix, const char* path) {
+        char full[96];
+        if (prefix && prefix[0] == '/') prefix++;
+        if (!prefix || !prefix[0]) {
+            prefix = "";
+            if (path[0] == '/') path++;
+        }
+        int n = snprintf(full, sizeof(full), "%s%s", prefix, path);
+        if (n <= 0 || (size_t)n >= sizeof(full)) return false;
+        char* leaf = strrchr(full, '/');
+        const char* d = "";
+        if (leaf) { *leaf++ = '\0'; d = full; }
+        else      { leaf = full; }
+
+        if (len == 0) {
+            batchMs = millis();
+            if (!appendf("{\"ts\":%lu,\"r\":[", (unsigned long)time(nullptr))) return false;
+        }
+        if (recs == 0 || fresh || strcmp(d, dir) != 0) {
+            if (recs && !appendRaw("},", 2)) return false;
+            if (!appendf("{\"p\":\"%s\",\"dt\":%lu", d, (unsigned long)(millis() - batchMs))) return false;
+            strncpy(dir, d, sizeof(dir) - 1);
+            dir[sizeof(dir) - 1] = '\0';
+            fresh = false;
+            recs++;
+        }
+        return appendf(",\"%s\":", leaf);
+    }
+
+    template <typename Fn>
+    void addField(const char* prefix, const char* path, Fn writeValue) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            size_t   mark     = len;
+            uint16_t markRecs = recs;
+            bool     markNew  = fresh;
+            char     markDir[sizeof(dir)];
+            memcpy(markDir, dir, sizeof(dir));
+            if (appendKey(prefix, path) && writeValue()) {
+                appended += len - mark;
+                return;
+            }
+            len  = mark;
+            recs  = markRecs;
+            fresh = markNew;
+            memcpy(dir, markDir, sizeof(dir));
+            if (len == 0 || !publish()) break;
+            fresh = true;
+        }
+        dropped++;
+    }
+
+    // batch ปัจจุบัน → PUBLISH 1 packet
+    bool publish() {
+        if (len == 0) return true;
+        if (st != M_UP) return false;
+
+        Inflight* slot = &inflight[0];
+        if (MQTT_QOS) {
+            slot = freeSlot();
+            unsigned long t0 = millis();
+            while (!slot && st == M_UP && millis() - t0 < MQTT_ACK_WAIT_MS) {
+                delay(1);
+                poll();
+                slot = freeSlot();
+            }
+            if (!slot) return false;                        // เก็บ batch ไว้ลองรอบหน้า
+        }
+
+        buf[len] = '\0';
+        size_t   payload = len + 3;                         // + "}]}"
+        size_t   topic   = sizeof(MQTT_TOPIC) - 1;
+        uint32_t rem     = (uint32_t)(2 + topic + (MQTT_QOS ? 2 : 0) + payload);
+
+        uint8_t* p = slot->pkt;
+        size_t   n = 0;
+        p[n++] = (uint8_t)(0x30 | (MQTT_QOS ? 0x02 : 0));
+        n += putLen(p + n, rem);
+        n += putStr(p + n, MQTT_TOPIC);
+        if (MQTT_QOS) {
+            if (nextId == 0) nextId = 1;
+            slot->id = nextId++;
+            p[n++] = (uint8_t)(slot->id >> 8);
+            p[n++] = (uint8_t)slot->id;
+        }
+        memcpy(p + n, buf, len);
+        n += len;
+        memcpy(p + n, "}]}", 3);
+        n += 3;
+        slot->len  = (uint16_t)n;
+        slot->used = MQTT_QOS != 0;                         // ส่งไม่ผ่านก็ยังค้างไว้ส่งซ้ำตอนต่อใหม่
+
+        len  = 0;
+        recs = 0;
+        dir[0] = '\0';
+
+        publishes++;
+        wireBytes += n;
+        return send(p, n) || MQTT_QOS;
+    }
+
+protected:
+    uint32_t appendedBytes() const override { return appended; }
+    void     onSampleBegin() override       { fresh = true; }
+
+public:
+    const char* name() const override { return "mqtt"; }
+
+    // broker อื่นนอกจาก MQTT_HOST:MQTT_PORT (เรียกก่อน service() ครั้งแรก, host ต้องอยู่ตลอด)
+    void setServer(const char* h, uint16_t p) {
+        host = h;
+        port = p;
+    }
+
+    void setInt(const char* path, int v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() { return appendf("%d", v); });
+    }
+
+    void setFloat(const char* path, float v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() {
+            if (isnan(v) || isinf(v)) return appendRaw("null", 4);
+            return appendf("%.2f", v);
+        });
+    }
+
+    void setBool(const char* path, bool v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() { return v ? appendRaw("true", 4) : appendRaw("false", 5); });
+    }
+
+    void setString(const char* path, const char* v, const char* prefix = nullptr) override {
+        addField(prefix, path, [&]() {
+            if (!appendRaw("\"", 1)) return false;
+            for (const char* s = v; *s; s++) {
+                char c = *s;
+                if (c == '"' || c == '\\') {
+                    char esc[2] = {'\\', c};
+                    if (!appendRaw(esc, 2)) return false;
+                } else if ((uint8_t)c >= 0x20 && !appendRaw(&c, 1)) {
+                    return false;
+                }
+            }
+            return appendRaw("\"", 1);
+        });
+    }
+
+    // ส่งเมื่อ batch ใกล้เต็มหรือ sample แรกรอครบ MQTT_BATCH_MS (ที่เหลือรอ service())
+    bool flush() override {
+        if (len == 0) return true;
+        if (len < sizeof(buf) * 3 / 4 && millis() - batchMs < MQTT_BATCH_MS) return true;
+        return publish();
+    }
+
+    void service() override {
+        if (WiFi.status() != WL_CONNECTED) {
+            drop("wifi down");
+            return;
+        }
+        if (st == M_IDLE) {
+            if (lastTry == 0 || millis() - lastTry >= MQTT_RETRY_MS) connect();
+            return;
+        }
+
+        poll();
+        if (st == M_CONNECTING && millis() - connMs > MQTT_CONNECT_TIMEOUT_MS) {
+            failCount++;
+            drop("no CONNACK");
+            return;
+        }
+        if (st != M_UP) return;
+
+        // keep-alive: เงียบครึ่งหนึ่งของ keepalive → PINGREQ, ไม่มี PINGRESP ใน 1 keepalive → ต่อใหม่
+        if (pingMs && millis() - pingMs > MQTT_KEEPALIVE_S * 1000UL) {
+            drop("ping timeout");
+            return;
+        }
+        if (!pingMs && millis() - lastTx >= MQTT_KEEPALIVE_S * 500UL) {
+            static const uint8_t ping[2] = { 0xC0, 0x00 };
+            if (send(ping, sizeof(ping))) pingMs = millis();
+        }
+
+        if (len && millis() - batchMs >= MQTT_BATCH_MS) publish();
+    }
+
+    bool ready() override { return st == M_UP; }
+
+    uint32_t roundTrips() const override { return publishes; }
+    uint32_t failures()   const override { return failCount; }
+    uint32_t acked()      const          { return acks; }
+
+    // byte บนสายต่อ sample (รวม header / topic / packet id ของ MQTT แต่ไม่รวม TCP/IP)
+    float wireBytesPerSample() const {
+        return sampleCount() ? (float)wireBytes / sampleCount() : 0.0f;
+    }
+
+    void printStats() const {
+        uint8_t busy = 0;
+        for (const Inflight &f : inflight) busy += f.used ? 1 : 0;
+        Serial.printf("[MQTT] %s qos=%u pub=%lu ack=%lu resent=%lu inflight=%u wire=%lu B (%.1f B/sample) drop=%lu fail=%lu connects=%lu\n",
+                      st == M_UP ? "up" : (st == M_CONNECTING ? "connecting" : "down"),
+                      (unsigned)MQTT_QOS, (unsigned long)publishes, (unsigned long)acks,
+                      (unsigned long)resent, busy, (unsigned long)wireBytes, wireBytesPerSample(),
+                      (unsigned long)dropped, (unsigned long)failCount, (unsigned long)reconnects);
+    }
+};
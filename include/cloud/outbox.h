@@ -0,0 +1,126 @@
+#pragma once
+#include <Arduino.h>
+#include "spsc_ring.h"
+#include "cloud/batch.h"
+
+#ifndef CLOUD_OUTBOX_DEPTH
+#define CLOUD_OUTBOX_DEPTH 128         // ต้องเป็นกำลังสอง (~6 record ต่อ node ต่อ tick)
+#endif
+
+#ifndef RTDB_WRITE_STR_LEN
+#define RTDB_WRITE_STR_LEN 32
+#endif
+
+// ---------- write record 1 รายการ (ไม่มี heap) ----------
+struct RtdbWrite {
+    enum Kind : uint8_t { W_INT, W_FLOAT, W_BOOL, W_STRING, W_RECORD, W_TELEMETRY };
+    static const uint8_t NO_NODE = 0xFF;
+
+    // W_RECORD / W_TELEMETRY: serializer ของ schema (ดู cloud/schema.h) เขียน field ตาม mask
+    // W_RECORD ลง RTDB batch เสมอ, W_TELEMETRY ลง TelemetrySink ที่เลือกไว้ (TELEMETRY_SINK)
+    typedef void (*EmitFn)(TelemetrySink& b, const char* rec, uint32_t mask, const char* prefix);
+
+    Kind        kind;
+    uint8_t     node;                  // index ใน NodeTable (path ต่อท้าย prefix ของ node) หรือ NO_NODE
+    union {
+        const char* path;              // ต้องเป็น string literal (PATH_*) อายุยาวตลอดโปรแกรม
+        EmitFn      emit;              // W_RECORD / W_TELEMETRY
+    };
+    union {
+        int32_t  i;
+        float    f;
+        bool     b;
+        uint32_t mask;                 // W_RECORD / W_TELEMETRY: dirty bits
+    };
+    char str[RTDB_WRITE_STR_LEN];      // W_RECORD / W_TELEMETRY: สำเนา record ทั้งก้อน
+};
+
+// ---------- outbound queue: control path → cloud task ----------
+// ฝั่ง control แค่ push record แล้วไปต่อ ไม่รอ network
+class RtdbOutbox {
+private:
+    SpscRing<RtdbWrite, CLOUD_OUTBOX_DEPTH> ring;
+    TaskHandle_t consumer = nullptr;
+
+    // ---------- stats ----------
+    uint32_t enqueued  = 0;
+    uint32_t dropped   = 0;
+    uint32_t maxEnqUs  = 0;
+    uint16_t highWater = 0;
+
+    void enqueue(RtdbWrite &w) {
+        unsigned long t0 = micros();
+        bool ok = ring.push(w);
+        uint32_t dt = (uint32_t)(micros() - t0);
+
+        if (dt > maxEnqUs) maxEnqUs = dt;
+        if (!ok) {
+            dropped++;
+            return;
+        }
+        enqueued++;
+        uint16_t d = (uint16_t)ring.size();
+        if (d > highWater) highWater = d;
+    }
+
+    static void copyStr(RtdbWrite &w, const char* s) {
+        strncpy(w.str, s ? s : "", sizeof(w.str) - 1);
+        w.str[sizeof(w.str) - 1] = '\0';
+    }
+
+public:
+    void setConsumer(TaskHandle_t t) { consumer = t; }
+
+    void setInt(const char* path, int v, uint8_t node = RtdbWrite::NO_NODE) {
+        RtdbWrite w; w.kind = RtdbWrite::W_INT; w.node = node; w.path = path; w.i = v; w.str[0] = '\0';
+        enqueue(w);
+    }
+
+    void setFloat(const char* path, float v, uint8_t node = RtdbWrite::NO_NODE) {
+        RtdbWrite w; w.kind = RtdbWrite::W_FLOAT; w.node = node; w.path = path; w.f = v; w.str[0] = '\0';
+        enqueue(w);
+    }
+
+    void setBool(const char* path, bool v, uint8_t node = RtdbWrite::NO_NODE) {
+        RtdbWrite w; w.kind = RtdbWrite::W_BOOL; w.node = node; w.path = path; w.b = v; w.str[0] = '\0';
+        enqueue(w);
+    }
+
+    void setString(const char* path, const char* v, uint8_t node = RtdbWrite::NO_NODE) {
+        RtdbWrite w; w.kind = RtdbWrite::W_STRING; w.node = node; w.path = path; w.i = 0; copyStr(w, v);
+        enqueue(w);
+    }
+
+    // ทั้ง record เป็น 1 slot (แทน 1 slot ต่อ field) → cloud task serialize ตาม mask
+    template <typename Rec>
+    void setRecord(RtdbWrite::EmitFn emit, const Rec& r, uint32_t mask, uint8_t node = RtdbWrite::NO_NODE) {
+        static_assert(sizeof(Rec) <= RTDB_WRITE_STR_LEN, "record does not fit in RtdbWrite::str");
+        RtdbWrite w; w.kind = RtdbWrite::W_RECORD; w.node = node; w.emit = emit; w.mask = mask;
+        memcpy(w.str, &r, sizeof(Rec));
+        enqueue(w);
+    }
+
+    // sample ของ sensor / env → TelemetrySink (RTDB หรือ MQTT ตาม build)
+    template <typename Rec>
+    void setTelemetry(RtdbWrite::EmitFn emit, const Rec& r, uint32_t mask, uint8_t node = RtdbWrite::NO_NODE) {
+        static_assert(sizeof(Rec) <= RTDB_WRITE_STR_LEN, "record does not fit in RtdbWrite::str");
+        RtdbWrite w; w.kind = RtdbWrite::W_TELEMETRY; w.node = node; w.emit = emit; w.mask = mask;
+        memcpy(w.str, &r, sizeof(Rec));
+        enqueue(w);
+    }
+
+    // จบ tick → ปลุก cloud task ให้ drain เป็น batch เดียว
+    void commit() {
+        if (consumer && !ring.empty()) xTaskNotifyGive(consumer);
+    }
+
+    // consumer side (cloud task)
+    bool pop(RtdbWrite &w) { return ring.pop(w); }
+
+    size_t   depth()        const { return ring.size();     }
+    size_t   capacity()     const { return ring.capacity(); }
+    uint16_t depthHighWater() const { return highWater;     }
+    uint32_t enqueueCount() const { return enqueued;        }
+    uint32_t dropCount()    const { return dropped;         }
+    uint32_t maxEnqueueUs() const { return maxEnqUs;        }
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <Arduino.h>
+#include <Firebase_ESP_Client.h>
+
+// ---------- RTDB client ตัวเดียวของทั้งระบบ (เจ้าของ = CloudTask) ----------
+// data = connection keep-alive สำหรับ get/set/push/PATCH (ใช้จาก cloud task เท่านั้น)
+// stream = connection ที่ 2 เฉพาะเมื่อเปิด stream (lib ไม่ให้ใช้ FirebaseData ของ stream ยิงอย่างอื่น)
+// buffer TLS (BearSSL) ของแต่ละ connection กำหนดตอน build → heap ที่ใช้คงที่และวัดได้
+#ifndef RTDB_SSL_RX_BUF
+#define RTDB_SSL_RX_BUF 4096           // 512..16384, ต้องพอกับ response ที่ใหญ่สุด
+#endif
+
+#ifndef RTDB_SSL_TX_BUF
+#define RTDB_SSL_TX_BUF 1024           // PATCH ใหญ่สุด = RTDB_BATCH_BUF_SIZE + header
+#endif
+
+#ifndef RTDB_STREAM_RX_BUF
+#define RTDB_STREAM_RX_BUF 2048        // snapshot แรกของ CONFIG_STREAM_PATH
+#endif
+
+#ifndef RTDB_STREAM_TX_BUF
+#define RTDB_STREAM_TX_BUF 512
+#endif
+
+#ifndef RTDB_RESPONSE_SIZE
+#define RTDB_RESPONSE_SIZE 1024        // payload ที่เก็บใน FirebaseData ต่อ call
+#endif
+
+#ifndef RTDB_KEEPALIVE_S
+#define RTDB_KEEPALIVE_S 5             // TCP keep-alive idle/interval (0 = ปิด)
+#endif
+
+#ifndef PATH_DIAG_RTDB
+#define PATH_DIAG_RTDB "/diagnostics/rtdb"
+#endif
+
+class RtdbClient {
+private:
+    FirebaseData data;
+    FirebaseData stream;
+    bool         configured = false;
+    bool         streamOn   = false;
+
+    // ---------- stats ----------
+    uint32_t callCount = 0;
+    uint32_t failCount = 0;
+    uint32_t heapBase  = 0;            // free heap ก่อนเปิด connection แรก
+    uint32_t heapLow   = UINT32_MAX;   // free heap ต่ำสุดที่เห็นหลัง call (TLS + response buffer)
+    uint32_t blockLow  = UINT32_MAX;   // block ต่อเนื่องใหญ่สุด ต่ำสุดที่เห็น
+
+    static void sizeBuffers(FirebaseData &d, uint16_t rx, uint16_t tx) {
+        d.setBSSLBufferSize(rx, tx);
+        d.setResponseSize(RTDB_RESPONSE_SIZE);
+#if RTDB_KEEPALIVE_S > 0
+        d.keepAlive(RTDB_KEEPALIVE_S, RTDB_KEEPALIVE_S, 1);
+#endif
+    }
+
+    void sampleHeap() {
+        uint32_t f = ESP.getFreeHeap();
+        uint32_t b = ESP.getMaxAllocHeap();
+        if (f < heapLow)  heapLow  = f;
+        if (b < blockLow) blockLow = b;
+    }
+
+    bool done(bool ok) {
+        callCount++;
+        if (!ok) failCount++;
+        sampleHeap();
+        return ok;
+    }
+
+public:
+    // cloud task เรียกก่อนใช้งานครั้งแรก (ก่อน connect → buffer size มีผล)
+    void begin() {
+        if (configured) return;
+        configured = true;
+        heapBase = ESP.getFreeHeap();
+        sizeBuffers(data, RTDB_SSL_RX_BUF, RTDB_SSL_TX_BUF);
+        Serial.printf("[RTDB] client tls=%u/%u resp=%u heap=%lu\n",
+                      (unsigned)RTDB_SSL_RX_BUF, (unsigned)RTDB_SSL_TX_BUF,
+                      (unsigned)RTDB_RESPONSE_SIZE, (unsigned long)heapBase);
+    }
+
+    // ---------- typed read (false = ไม่มีค่า/ผิดพลาด, out ไม่ถูกแตะ) ----------
+    bool get(const char* path, String &out) {
+        if (!done(Firebase.RTDB.getString(&data, path))) return false;
+        out = data.stringData();
+        return true;
+    }
+
+    bool get(const char* path, bool &out) {
+        if (!done(Firebase.RTDB.getBool(&data, path))) return false;
+        out = data.boolData();
+        return true;
+    }
+
+    bool get(const char* path, int &out) {
+        if (!done(Firebase.RTDB.getInt(&data, path))) return false;
+        out = data.intData();
+        return true;
+    }
+
+    bool get(const char* path, float &out) {
+        if (!done(Firebase.RTDB.getFloat(&data, path))) return false;
+        out = data.floatData();
+        return true;
+    }
+
+    // ---------- write ----------
+    bool set(const char* path, int v)         { return done(Firebase.RTDB.setInt(&data, path, v));    }
+    bool set(const char* path, float v)       { return done(Firebase.RTDB.setFloat(&data, path, v));  }
+    bool set(const char* path, bool v)        { return done(Firebase.RTDB.setBool(&data, path, v));   }
+    bool set(const char* path, const char* v) { return done(Firebase.RTDB.setString(&data, path, v)); }
+
+    // multi-path PATCH (RtdbBatch) — ไม่ต้องการ response body
+    bool patch(const char* path, FirebaseJson* json) {
+        return done(Firebase.RTDB.updateNodeSilent(&data, path, json));
+    }
+
+    String errorReason() { return data.errorReason(); }
+
+    // get ล่าสุดล้มเพราะ path ไม่มีค่า (ถูกลบ) ไม่ใช่เพราะ network
+    bool missing() { return data.errorReason() == "path not exist"; }
+
+    // ---------- stream (connection ที่ 2, เปิดครั้งเดียว) ----------
+    bool beginStream(const char* path, void (*onEvent)(FirebaseStream), void (*onTimeout)(bool)) {
+        if (!streamOn) sizeBuffers(stream, RTDB_STREAM_RX_BUF, RTDB_STREAM_TX_BUF);
+        bool ok = Firebase.RTDB.beginStream(&stream, path);
+        sampleHeap();
+        if (!ok) {
+            Serial.printf("[RTDB] stream %s failed: %s\n", path, stream.errorReason().c_str());
+            return false;
+        }
+        Firebase.RTDB.setStreamCallback(&stream, onEvent, onTimeout);
+        streamOn = true;
+        return true;
+    }
+
+    bool streaming() const { return streamOn; }
+
+    // ---------- stats ----------
+    uint32_t calls()    const { return callCount; }
+    uint32_t failures() const { return failCount; }
+    uint32_t heapMin()  const { return heapLow == UINT32_MAX ? 0 : heapLow; }
+
+    // heap ที่ client กินไป ณ จุดต่ำสุด (TLS + response ของทุก connection)
+    uint32_t heapPeakUse() const {
+        return heapLow == UINT32_MAX || heapLow > heapBase ? 0 : heapBase - heapLow;
+    }
+
+    void printStats() {
+        Serial.printf("[RTDB] calls=%lu fail=%lu heap=%lu min=%lu peak_use=%lu sys_min=%lu block_min=%lu conn=%u\n",
+                      (unsigned long)callCount, (unsigned long)failCount,
+                      (unsigned long)ESP.getFreeHeap(), (unsigned long)heapMin(),
+                      (unsigned long)heapPeakUse(), (unsigned long)ESP.getMinFreeHeap(),
+                      (unsigned long)(blockLow == UINT32_MAX ? 0 : blockLow),
+                      streamOn ? 2u : 1u);
+    }
+};
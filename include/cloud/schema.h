@@ -0,0 +1,168 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include "cloud/sink.h"
+
+// ---------- telemetry schema: ประกาศ field ครั้งเดียว ----------
+// จาก descriptor 1 บรรทัดต่อ field ได้ทั้ง
+//   - dirty bit (deadband + rate limit + heartbeat ต่อ field)
+//   - serialization ของทั้ง record ลง TelemetrySink (RTDB PATCH เดียว / MQTT payload)
+// table เป็น constexpr → จำนวน field/ขนาด state รู้ตอน compile ไม่มี heap
+
+enum TlmType : uint8_t {
+    TLM_INT,
+    TLM_FLOAT,
+    TLM_BOOL,
+    TLM_CHAR,      // ค่า 1 ตัวอักษร → string ยาว 1
+    TLM_TEXT,      // string จาก text() (เช่น tilt → "FALL")
+};
+
+enum TlmFlags : uint8_t {
+    TLM_NONE       = 0,
+    TLM_NONZERO    = 1 << 0,   // ไม่ส่งค่า 0 (เช่น keyPress ที่ไม่มีการกด)
+    TLM_NO_REFRESH = 1 << 1,   // ส่งเฉพาะตอนเปลี่ยน ไม่ส่งซ้ำตาม heartbeat
+};
+
+template <typename Rec>
+struct TlmField {
+    const char* path;
+    TlmType     type;
+    uint8_t     flags;
+    float       deadband;     // |ใหม่ - ที่ส่งล่าสุด| >= deadband → dirty (0 = เปลี่ยนเมื่อไหร่ก็ส่ง)
+    uint16_t    minGapMs;     // rate limit: ส่ง field นี้ห่างกันอย่างน้อยเท่านี้
+    float       (*value)(const Rec&);
+    const char* (*text)(const Rec&);
+};
+
+// accessor ต่อ member (สร้างโดย TLM_FIELD) — ค่าเป็น float เพื่อเทียบ deadband แบบเดียวกันทุก type
+// (int ไม่เกิน 2^24 ยังแม่นยำ)
+template <typename Rec, typename T, T Rec::*M>
+float tlmGet(const Rec& r) { return (float)(r.*M); }
+
+#define TLM_FIELD(Rec, member, type, path, deadband, minGapMs, flags) \
+    { path, type, flags, deadband, minGapMs, &tlmGet<Rec, decltype(Rec::member), &Rec::member>, nullptr }
+
+// field ที่เป็นข้อความ: เปลี่ยนตาม member, เขียนค่าจาก textFn(rec)
+#define TLM_TEXT_FIELD(Rec, member, path, textFn) \
+    { path, TLM_TEXT, TLM_NONE, 0.0f, 0, &tlmGet<Rec, decltype(Rec::member), &Rec::member>, textFn }
+
+#define TLM_COUNT(fields) (sizeof(fields) / sizeof((fields)[0]))
+
+// ---------- state ต่อ record ที่ติดตาม (เช่น ต่อ node) ----------
+template <size_t N>
+struct TlmState {
+    float    last[N];         // ค่าที่ส่งล่าสุดต่อ field
+    uint32_t lastMs[N];       // millis() ที่ส่งล่าสุดต่อ field
+    bool     primed = false;  // เคยส่งครบชุดแล้วหรือยัง
+};
+
+template <typename Rec, size_t N>
+class TlmSchema {
+    static_assert(N <= 32, "dirty mask is 32 bits");
+
+private:
+    const TlmField<Rec>* f;
+    uint32_t             refreshMs;   // heartbeat ต่อ field (0 = ไม่มี)
+
+    bool changed(const TlmField<Rec>& fd, float v, float last) const {
+        if (fd.deadband <= 0.0f) return v != last;
+        return fabsf(v - last) >= fd.deadband;
+    }
+
+public:
+    typedef TlmState<N> State;
+    static const size_t FIELDS = N;
+
+    constexpr TlmSchema(const TlmField<Rec> (&fields)[N], uint32_t refresh)
+        : f(fields), refreshMs(refresh) {}
+
+    const TlmField<Rec>& field(size_t i) const { return f[i]; }
+
+    // field ที่ต้องส่งรอบนี้ (bit i = f[i])
+    uint32_t dirty(const State& s, const Rec& r, uint32_t nowMs) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < N; i++) {
+            const TlmField<Rec>& fd = f[i];
+            float v = fd.value(r);
+            if ((fd.flags & TLM_NONZERO) && v == 0.0f) continue;
+
+            if (!s.primed) {
+                if (!(fd.flags & TLM_NO_REFRESH)) mask |= 1u << i;
+                continue;
+            }
+
+            uint32_t el = nowMs - s.lastMs[i];
+            if (changed(fd, v, s.last[i]) && el >= fd.minGapMs) {
+                mask |= 1u << i;
+            } else if (refreshMs && !(fd.flags & TLM_NO_REFRESH) && el >= refreshMs) {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+    }
+
+    // ทุก field ที่ส่งซ้ำได้ (ใช้ตอน resync หลัง offline)
+    uint32_t refreshMask(const Rec& r) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < N; i++) {
+            if (f[i].flags & TLM_NO_REFRESH) continue;
+            if ((f[i].flags & TLM_NONZERO) && f[i].value(r) == 0.0f) continue;
+            mask |= 1u << i;
+        }
+        return mask;
+    }
+
+    // บันทึกว่า field ใน mask ถูกส่ง/เก็บแล้ว
+    // TLM_NONZERO จำค่าปัจจุบันเสมอ (กดปุ่มเดิมซ้ำหลังปล่อย = เปลี่ยน)
+    void commit(State& s, const Rec& r, uint32_t mask, uint32_t nowMs) const {
+        for (size_t i = 0; i < N; i++) {
+            bool sent = !s.primed || (mask & (1u << i));
+            if (sent || (f[i].flags & TLM_NONZERO)) s.last[i] = f[i].value(r);
+            if (sent) s.lastMs[i] = nowMs;
+        }
+        s.primed = true;
+    }
+
+    // เหลืออีกกี่ ms ถึง field ถัดไปจะ dirty เอง (heartbeat หรือค่าที่ติด rate limit)
+    uint32_t msUntilDue(const State& s, const Rec& r, uint32_t nowMs) const {
+        if (!s.primed) return 0;
+        uint32_t best = UINT32_MAX;
+        for (size_t i = 0; i < N; i++) {
+            const TlmField<Rec>& fd = f[i];
+            float v = fd.value(r);
+            if ((fd.flags & TLM_NONZERO) && v == 0.0f) continue;
+
+            uint32_t el = nowMs - s.lastMs[i];
+            uint32_t wait = UINT32_MAX;
+            if (changed(fd, v, s.last[i]))                    wait = fd.minGapMs;
+            if (refreshMs && !(fd.flags & TLM_NO_REFRESH) && refreshMs < wait) wait = refreshMs;
+            if (wait == UINT32_MAX) continue;
+
+            uint32_t left = (el >= wait) ? 0 : wait - el;
+            if (left < best) best = left;
+        }
+        return best;
+    }
+
+    // เขียน field ใน mask ลง sink (prefix = path ของ node หรือ nullptr)
+    void emit(TelemetrySink& b, const Rec& r, uint32_t mask, const char* prefix) const {
+        for (size_t i = 0; i < N; i++) {
+            if (!(mask & (1u << i))) continue;
+            const TlmField<Rec>& fd = f[i];
+            float v = fd.value(r);
+            switch (fd.type) {
+                case TLM_INT:   b.setInt(fd.path, (int)lroundf(v), prefix); break;
+                case TLM_FLOAT: b.setFloat(fd.path, v, prefix);             break;
+                case TLM_BOOL:  b.setBool(fd.path, v != 0.0f, prefix);      break;
+                case TLM_CHAR: {
+                    char s[2] = { (char)(int)v, '\0' };
+                    b.setString(fd.path, s, prefix);
+                    break;
+                }
+                case TLM_TEXT:
+                    b.setString(fd.path, fd.text ? fd.text(r) : "", prefix);
+                    break;
+            }
+        }
+    }
+};
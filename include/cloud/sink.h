@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- ปลายทางของ telemetry (sensor / env sample) ----------
+// schema emit() เขียน field ของ 1 sample ผ่าน interface นี้ → ไม่ผูกกับ RTDB
+// RtdbBatch = PATCH หลาย path (ค่าเดิม), MqttSink = publish payload รวมหลาย sample
+// cloud task เป็นคนเรียกทั้งหมด (ไม่มี lock)
+#define TLM_SINK_RTDB 0
+#define TLM_SINK_MQTT 1
+
+#ifndef TELEMETRY_SINK
+#define TELEMETRY_SINK TLM_SINK_RTDB
+#endif
+
+class TelemetrySink {
+private:
+    uint32_t markBytes = 0;
+
+    // ---------- stats (ต่อ sample / ต่อ round trip) ----------
+    uint32_t samples     = 0;
+    uint32_t sampleBytes = 0;          // payload ที่ sample ใช้ (ไม่รวม framing ของ protocol)
+    uint32_t winSamples  = 0;
+    unsigned long winStart = 0;
+    float    rate        = 0;          // sample/s ของหน้าต่างล่าสุด
+
+protected:
+    // byte ที่เคยเขียนลง payload ทั้งหมด (นับขึ้นอย่างเดียว ไม่รีเซ็ตตอน flush)
+    virtual uint32_t appendedBytes() const = 0;
+
+    // sample ใหม่เริ่ม (MQTT เปิด record ใหม่ใน payload แม้ path ซ้ำกับ sample ก่อน)
+    virtual void onSampleBegin() {}
+
+public:
+    virtual ~TelemetrySink() {}
+
+    virtual const char* name() const = 0;
+
+    // prefix = path ของ node (หรือ nullptr) ต่อหน้า path ของ field
+    virtual void setInt(const char* path, int v, const char* prefix = nullptr) = 0;
+    virtual void setFloat(const char* path, float v, const char* prefix = nullptr) = 0;
+    virtual void setBool(const char* path, bool v, const char* prefix = nullptr) = 0;
+    virtual void setString(const char* path, const char* v, const char* prefix = nullptr) = 0;
+
+    // จบ drain 1 รอบ: RTDB ส่งทันที, MQTT ส่งเมื่อ batch เต็ม/ครบอายุ (false = ส่งไม่ผ่าน)
+    virtual bool flush() = 0;
+
+    // ทุกรอบของ cloud task (connect / keep-alive / ack) — RTDB ไม่ต้องทำอะไร
+    virtual void service() {}
+
+    // พร้อมรับ sample (false → control เก็บลง history แทน)
+    virtual bool ready() { return true; }
+
+    virtual uint32_t roundTrips() const = 0;
+    virtual uint32_t failures()   const = 0;
+
+    // ---------- วัด byte/sample: cloud task ครอบ emit() ของแต่ละ sample ----------
+    void sampleBegin() {
+        onSampleBegin();
+        markBytes = appendedBytes();
+    }
+
+    void sampleEnd() {
+        samples++;
+        winSamples++;
+        sampleBytes += appendedBytes() - markBytes;
+    }
+
+    uint32_t sampleCount() const { return samples; }
+
+    float bytesPerSample() const { return samples ? (float)sampleBytes / samples : 0.0f; }
+
+    // อัปเดต throughput ของหน้าต่างล่าสุด (เรียกตอนพิมพ์ stats)
+    float sampleRate() {
+        unsigned long now = millis();
+        if (winStart == 0) winStart = now;
+        unsigned long dt = now - winStart;
+        if (dt >= 1000) {
+            rate       = winSamples * 1000.0f / dt;
+            winSamples = 0;
+            winStart   = now;
+        }
+        return rate;
+    }
+};
@@ -0,0 +1,199 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- ค่าตั้งต้นของ retransmission ----------
+#ifndef LINK_RTO_INIT_US
+#define LINK_RTO_INIT_US 20000     // ก่อนมี RTT sample
+#endif
+
+#ifndef LINK_RTO_MIN_US
+#define LINK_RTO_MIN_US 2000
+#endif
+
+#ifndef LINK_RTO_MAX_US
+#define LINK_RTO_MAX_US 200000
+#endif
+
+#ifndef LINK_MAX_TRIES
+#define LINK_MAX_TRIES 5           // รวมครั้งแรก
+#endif
+
+#define LINK_FIFO_LEN 4            // frame ที่ยังรอ send callback ได้พร้อมกัน (ต้องเป็นกำลังสอง)
+
+struct LinkStats {
+    uint32_t sent        = 0;      // esp_now_send ทั้งหมด (รวม retransmit)
+    uint32_t acked       = 0;      // send cb = SUCCESS
+    uint32_t failed      = 0;      // send cb = FAIL หรือ send error
+    uint32_t retransmits = 0;
+    uint32_t gaveUp      = 0;      // ครบ LINK_MAX_TRIES แล้วยังไม่ ack
+    uint32_t rttMinUs    = 0;
+    uint32_t rttMaxUs    = 0;
+};
+
+// ---------- สถานะคำสั่งต่อ peer: seq + ack จาก send callback + adaptive RTO ----------
+// ack = MAC-layer ACK ของ ESP-NOW (send cb SUCCESS) → รู้ภายในไม่กี่ ms ว่า node ได้รับแล้ว
+// เรียกได้จากทั้ง control task และ Wi-Fi task (fast path / send cb) → ป้องกันด้วย spinlock
+class CommandLink {
+private:
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    uint16_t nextSeq = 1;
+
+    // frame ที่ส่งไปแล้วรอ callback (เรียงตามลำดับ callback ของ ESP-NOW)
+    uint16_t fifo[LINK_FIFO_LEN];
+    uint8_t  fifoHead = 0;
+    uint8_t  fifoLen  = 0;
+
+    // คำสั่งล่าสุด (ตัวที่ต้องส่งให้ถึง)
+    bool     active   = false;     // ยังไม่ ack
+    bool     retryDue = false;     // ได้ FAIL แล้ว รอครบ RTO เพื่อส่งซ้ำ
+    bool     state    = false;
+    uint16_t seq      = 0;
+    uint8_t  tries    = 0;
+    uint32_t sentUs   = 0;
+    uint32_t backoffUs = LINK_RTO_INIT_US;   // รอบนี้รอเท่าไหร่ (เริ่มที่ rto, x2 ทุกครั้งที่ FAIL / timeout)
+
+    // RTT estimator (Jacobson/Karels)
+    bool     hasRtt  = false;
+    uint32_t srtt    = 0;
+    uint32_t rttvar  = 0;
+    uint32_t rto     = LINK_RTO_INIT_US;
+
+    LinkStats st;
+
+    static uint32_t clampRto(uint32_t v) {
+        if (v < LINK_RTO_MIN_US) return LINK_RTO_MIN_US;
+        if (v > LINK_RTO_MAX_US) return LINK_RTO_MAX_US;
+        return v;
+    }
+
+    void sampleRtt(uint32_t r) {
+        if (!hasRtt) {
+            srtt   = r;
+            rttvar = r / 2;
+            hasRtt = true;
+        } else {
+            uint32_t err = (r > srtt) ? r - srtt : srtt - r;
+            rttvar = (3 * rttvar + err) / 4;
+            srtt   = (7 * srtt + r) / 8;
+        }
+        rto = clampRto(srtt + 4 * rttvar);
+
+        if (st.rttMinUs == 0 || r < st.rttMinUs) st.rttMinUs = r;
+        if (r > st.rttMaxUs) st.rttMaxUs = r;
+    }
+
+    void pushFifo(uint16_t s) {
+        if (fifoLen == LINK_FIFO_LEN) {          // callback หาย → ทิ้งตัวเก่าสุด
+            fifoHead = (fifoHead + 1) & (LINK_FIFO_LEN - 1);
+            fifoLen--;
+        }
+        fifo[(fifoHead + fifoLen) & (LINK_FIFO_LEN - 1)] = s;
+        fifoLen++;
+    }
+
+    bool popFifo(uint16_t &s) {
+        if (fifoLen == 0) return false;
+        s = fifo[fifoHead];
+        fifoHead = (fifoHead + 1) & (LINK_FIFO_LEN - 1);
+        fifoLen--;
+        return true;
+    }
+
+    void markSentLocked(uint32_t nowUs) {
+        tries++;
+        sentUs   = nowUs;
+        retryDue = false;
+        st.sent++;
+        pushFifo(seq);
+    }
+
+public:
+    // คำสั่งใหม่ (แทนตัวเก่าที่ยังไม่ ack) → คืน seq ที่ต้องส่ง
+    uint16_t beginCommand(bool s, uint32_t nowUs) {
+        portENTER_CRITICAL(&mux);
+        seq       = nextSeq++;
+        if (nextSeq == 0) nextSeq = 1;
+        state     = s;
+        active    = true;
+        tries     = 0;
+        backoffUs = rto;
+        markSentLocked(nowUs);
+        uint16_t out = seq;
+        portEXIT_CRITICAL(&mux);
+        return out;
+    }
+
+    // ผลจาก send callback (หรือ esp_now_send error) ของ frame ที่เก่าสุดที่ค้างอยู่
+    void onStatus(bool ok, uint32_t nowUs) {
+        portENTER_CRITICAL(&mux);
+        uint16_t s;
+        bool known = popFifo(s);
+        if (ok) st.acked++; else st.failed++;
+
+        if (known && active && s == seq) {
+            if (ok) {
+                // Karn: วัด RTT เฉพาะ frame ที่ไม่ได้ส่งซ้ำ
+                if (tries == 1) sampleRtt(nowUs - sentUs);
+                active = false;
+                retryDue = false;
+            } else if (tries >= LINK_MAX_TRIES) {
+                active = false;
+                retryDue = false;
+                st.gaveUp++;
+            } else {
+                retryDue  = true;
+                backoffUs = clampRto(backoffUs * 2);
+            }
+        }
+        portEXIT_CRITICAL(&mux);
+    }
+
+    // ถึงเวลาส่งซ้ำหรือยัง (FAIL แล้วครบ backoff / ไม่มี callback เลยภายใน backoff)
+    // ทั้งสองทางรอตาม RTO ที่วัดได้ (ผ่าน backoffUs) — callback ที่มาช้าหลังส่งซ้ำไม่ถูกใช้วัด RTT (Karn)
+    bool retransmitDue(uint32_t nowUs, bool &outState) {
+        portENTER_CRITICAL(&mux);
+        bool due = false;
+        if (active) {
+            if ((uint32_t)(nowUs - sentUs) >= backoffUs) {
+                if (tries >= LINK_MAX_TRIES) {
+                    active = false;
+                    st.gaveUp++;
+                } else {
+                    // timeout (ไม่ใช่ FAIL ที่ x2 ไปแล้วใน onStatus) → x2 ก่อนรอรอบถัดไป
+                    if (!retryDue) backoffUs = clampRto(backoffUs * 2);
+                    due = true;
+                    outState = state;
+                    st.retransmits++;
+                    markSentLocked(nowUs);
+                }
+            }
+        }
+        portEXIT_CRITICAL(&mux);
+        return due;
+    }
+
+    // เหลืออีกกี่ us ถึง retransmit ถัดไป (UINT32_MAX = ไม่มีค้าง)
+    uint32_t usUntilRetransmit(uint32_t nowUs) {
+        portENTER_CRITICAL(&mux);
+        uint32_t left = UINT32_MAX;
+        if (active) {
+            uint32_t el = nowUs - sentUs;
+            left = (el >= backoffUs) ? 0 : backoffUs - el;
+        }
+        portEXIT_CRITICAL(&mux);
+        return left;
+    }
+
+    bool      pending() const { return active;  }
+    uint16_t  lastSeq() const { return seq;     }
+    uint32_t  srttUs()  const { return srtt;    }
+    uint32_t  rtoUs()   const { return rto;     }
+    LinkStats stats()   const { return st;      }
+
+    // loss = FAIL / ทั้งหมดที่ได้ผล (ต่อพัน)
+    uint32_t lossPermille() const {
+        uint32_t total = st.acked + st.failed;
+        return total ? (st.failed * 1000u) / total : 0;
+    }
+};
@@ -0,0 +1,326 @@
+#pragma once
+#include <Arduino.h>
+#include <Firebase_ESP_Client.h>
+#include "constant.h"
+#include "control/schedule.h"
+#include "cloud/rtdb_client.h"
+
+// subtree ที่ subscribe (ต้องครอบทุก PATH_CTRL_* / PATH_SCHED_* ที่เป็น config)
+#ifndef CONFIG_STREAM_PATH
+#define CONFIG_STREAM_PATH "/control"
+#endif
+
+#ifndef CONFIG_STREAM_ENABLE
+#define CONFIG_STREAM_ENABLE 1
+#endif
+
+// ---------- โหมดควบคุม (แปลงจาก string ตอนรับ config ครั้งเดียว) ----------
+enum ControlMode : uint8_t {
+    MODE_MANUAL = 0,
+    MODE_AUTO,
+    MODE_UNKNOWN,     // ค่าอื่นจาก RTDB → ปิดเครื่อง
+};
+
+inline ControlMode controlModeFromText(const char* s) {
+    if (strcmp(s, "manual") == 0) return MODE_MANUAL;
+    if (strcmp(s, "auto") == 0)   return MODE_AUTO;
+    return MODE_UNKNOWN;
+}
+
+inline const char* controlModeText(ControlMode m) {
+    switch (m) {
+        case MODE_MANUAL: return "manual";
+        case MODE_AUTO:   return "auto";
+        default:          return "unknown";
+    }
+}
+
+// ---------- config ที่ ControlLogic ใช้ (copy ได้โดยไม่ต้อง alloc) ----------
+struct ControlConfig {
+    ControlMode mode   = MODE_MANUAL;
+    bool manual        = false;      // manual_state
+    int  targetHumid   = 60;         // %RH
+
+    bool schedEnable   = false;
+    int  schedStartMin = -1;         // นาทีจากเที่ยงคืน
+    int  schedStopMin  = -1;
+
+    // หลายช่วง + วันในสัปดาห์ (ว่าง = ใช้ start/stop เดิมทุกวัน)
+    SchedWindow schedWindows[SCHED_MAX_WINDOWS];
+    uint8_t     schedWindowCount = 0;
+};
+
+// "HH:MM" → นาทีจากเที่ยงคืน (-1 = รูปแบบผิด) ไม่มี allocation
+inline int configParseHHMM(const char* s) {
+    int h = 0, m = 0, digits = 0;
+    while (*s == ' ') s++;
+    for (; *s >= '0' && *s <= '9'; s++, digits++) h = h * 10 + (*s - '0');
+    if (digits == 0 || digits > 2 || *s != ':') return -1;
+    s++;
+    digits = 0;
+    for (; *s >= '0' && *s <= '9'; s++, digits++) m = m * 10 + (*s - '0');
+    if (digits == 0 || digits > 2) return -1;
+    if (h > 23 || m > 59) return -1;
+    return h * 60 + m;
+}
+
+// ---------- RTDB stream → local config cache ----------
+// subscribe ครั้งเดียว แล้ว apply put/patch จาก server ลง ControlConfig
+// callback วิ่งใน stream task ของ Firebase lib → ป้องกันด้วย spinlock + version
+class ConfigStream {
+private:
+    portMUX_TYPE  lock    = portMUX_INITIALIZER_UNLOCKED;
+    ControlConfig cfg;
+    volatile uint32_t version = 0;    // เพิ่มทุกครั้งที่มีค่าเปลี่ยน
+    volatile bool     live    = false;
+    bool              started = false;
+
+    uint32_t eventCount = 0;
+    unsigned long lastEventMs = 0;
+    volatile uint32_t changedUs = 0;  // micros() ตอน version เปลี่ยนล่าสุด
+    uint8_t localDirty = 0;           // field ที่แก้จาก LAN แต่ยังไม่ได้เขียนขึ้น RTDB (LocalField)
+    TaskHandle_t wakeTask = nullptr;  // task ที่ต้องปลุกเมื่อ config เปลี่ยน
+
+    void bumpLocked() {
+        version   = version + 1;
+        changedUs = micros();
+    }
+
+    void wake() {
+        if (wakeTask) xTaskNotifyGive(wakeTask);
+    }
+
+    static ConfigStream*& self() {
+        static ConfigStream* inst = nullptr;
+        return inst;
+    }
+
+    enum FieldKind : uint8_t { F_MODE, F_MANUAL, F_TARGET, F_SCHED_EN, F_SCHED_START, F_SCHED_STOP, F_SCHED_WINDOWS };
+
+    struct Field {
+        const char* path;
+        FieldKind   kind;
+    };
+
+    static const Field* fields(size_t &n) {
+        static const Field table[] = {
+            { PATH_CTRL_MODE,         F_MODE        },
+            { PATH_CTRL_MANUAL,       F_MANUAL      },
+            { PATH_CTRL_TARGET_HUMID, F_TARGET      },
+            { PATH_SCHED_ENABLE,      F_SCHED_EN    },
+            { PATH_SCHED_START,       F_SCHED_START },
+            { PATH_SCHED_STOP,        F_SCHED_STOP  },
+            { PATH_SCHED_WINDOWS,     F_SCHED_WINDOWS },
+        };
+        n = sizeof(table) / sizeof(table[0]);
+        return table;
+    }
+
+    // path ของ field เทียบกับ root ของ stream เช่น "/control/mode" → "/mode"
+    static const char* relPath(const char* full) {
+        size_t n = strlen(CONFIG_STREAM_PATH);
+        if (n == 1 && CONFIG_STREAM_PATH[0] == '/') return full;
+        if (strncmp(full, CONFIG_STREAM_PATH, n) != 0) return nullptr;
+        if (full[n] != '/') return nullptr;
+        return full + n;
+    }
+
+    // ค่าใหม่ (เก็บเป็น string ก่อน แล้วค่อยแปลงตามชนิด field)
+    static void applyValue(ControlConfig &c, FieldKind k, const char* v) {
+        bool truthy = (strcmp(v, "true") == 0 || strcmp(v, "1") == 0);
+        switch (k) {
+            case F_MODE:        c.mode          = controlModeFromText(v); break;
+            case F_MANUAL:      c.manual        = truthy;                 break;
+            case F_TARGET:      c.targetHumid   = atoi(v);                break;
+            case F_SCHED_EN:    c.schedEnable   = truthy;                 break;
+            case F_SCHED_START: c.schedStartMin = configParseHHMM(v);     break;
+            case F_SCHED_STOP:  c.schedStopMin  = configParseHHMM(v);     break;
+            case F_SCHED_WINDOWS:
+                c.schedWindowCount = schedParseWindows(v, c.schedWindows, SCHED_MAX_WINDOWS);
+                break;
+        }
+    }
+
+    // field ถูกลบ (null / ไม่อยู่ใน put ของ node แม่) → true ถ้าค่าเปลี่ยน
+    // windows ว่าง = กลับไปใช้ start/stop เดิม, field อื่นคงค่าล่าสุดไว้
+    static bool clearValue(ControlConfig &c, FieldKind k) {
+        if (k != F_SCHED_WINDOWS || c.schedWindowCount == 0) return false;
+        c.schedWindowCount = 0;
+        return true;
+    }
+
+    void handle(FirebaseStream &data) {
+        String dataPath = data.dataPath();
+        const char* dp  = dataPath.c_str();
+        size_t dpLen    = strlen(dp);
+        bool   isRoot   = (dpLen == 1 && dp[0] == '/');
+        bool   isJson   = (data.dataType() == "json");
+        bool   isNull   = (data.dataType() == "null");
+        bool   isPut    = (data.eventType() == "put");
+
+        ControlConfig next;
+        portENTER_CRITICAL(&lock);
+        next = cfg;
+        portEXIT_CRITICAL(&lock);
+
+        size_t n;
+        const Field* tbl = fields(n);
+        bool touched = false;
+
+        for (size_t i = 0; i < n; i++) {
+            const char* rel = relPath(tbl[i].path);
+            if (!rel) continue;
+
+            bool covers = isRoot || (strncmp(rel, dp, dpLen) == 0 && rel[dpLen] == '/');
+
+            if (strcmp(rel, dp) == 0) {
+                // event ตรง leaf นี้พอดี
+                if (isNull) {
+                    touched |= clearValue(next, tbl[i].kind);
+                    continue;
+                }
+                applyValue(next, tbl[i].kind, data.stringData().c_str());
+                touched = true;
+            } else if (covers && isNull) {
+                // node แม่ถูกลบทั้งก้อน
+                touched |= clearValue(next, tbl[i].kind);
+            } else if (covers && isJson) {
+                // event เป็น object ที่ครอบ leaf นี้ → ดึงค่าจาก JSON
+                const char* sub = isRoot ? rel + 1 : rel + dpLen + 1;
+                FirebaseJson* json = data.jsonObjectPtr();
+                FirebaseJsonData r;
+                if (json && json->get(r, sub) && r.success) {
+                    applyValue(next, tbl[i].kind, r.stringValue.c_str());
+                    touched = true;
+                } else if (isPut) {
+                    // put แทนที่ทั้ง node → leaf ที่ไม่มีใน JSON = ถูกลบ (patch ไม่แตะ)
+                    touched |= clearValue(next, tbl[i].kind);
+                }
+            }
+        }
+
+        eventCount++;
+        lastEventMs = millis();
+        live = true;
+
+        if (!touched) return;
+
+        portENTER_CRITICAL(&lock);
+        cfg = next;
+        bumpLocked();
+        portEXIT_CRITICAL(&lock);
+        wake();
+
+        Serial.printf("[Config] stream %s %s -> v%lu\n",
+                      data.eventType().c_str(), dp, (unsigned long)version);
+    }
+
+    static void onStream(FirebaseStream data) {
+        if (self()) self()->handle(data);
+    }
+
+    static void onTimeout(bool timeout) {
+        if (timeout && self()) {
+            self()->live = false;    // lib จะ resume เอง ระหว่างนี้ให้ fallback ไป polling
+            Serial.println("[Config] stream timeout, resuming...");
+        }
+    }
+
+public:
+    // ต้องเรียกหลัง Firebase.begin() — connection ของ stream อยู่ใน RtdbClient
+    bool begin(RtdbClient &rtdb) {
+        if (!CONFIG_STREAM_ENABLE) return false;
+
+        size_t n;
+        const Field* tbl = fields(n);
+        for (size_t i = 0; i < n; i++) {
+            if (!relPath(tbl[i].path)) {
+                Serial.printf("[Config] %s is outside %s, stream disabled\n",
+                              tbl[i].path, CONFIG_STREAM_PATH);
+                return false;
+            }
+        }
+
+        self() = this;
+        if (!rtdb.beginStream(CONFIG_STREAM_PATH, onStream, onTimeout)) return false;
+        started = true;
+        Serial.printf("[Config] streaming %s\n", CONFIG_STREAM_PATH);
+        return true;
+    }
+
+    bool isStarted() const { return started; }
+
+    // stream ใช้งานได้ (ได้ snapshot แรกแล้วและไม่ timeout)
+    bool isLive() const { return started && live; }
+
+    uint32_t getVersion() const { return version; }
+
+    // copy config ล่าสุดออกไป คืน version ที่ได้
+    uint32_t snapshot(ControlConfig &out) {
+        portENTER_CRITICAL(&lock);
+        out = cfg;
+        uint32_t v = version;
+        portEXIT_CRITICAL(&lock);
+        return v;
+    }
+
+    // ค่าจาก polling (ตอน stream ยังไม่ live) → เข้า cache เดียวกัน
+    void publish(const ControlConfig &c) {
+        portENTER_CRITICAL(&lock);
+        bool changed = (version == 0) ||
+                       c.mode          != cfg.mode ||
+                       c.manual        != cfg.manual ||
+                       c.targetHumid   != cfg.targetHumid ||
+                       c.schedEnable   != cfg.schedEnable ||
+                       c.schedStartMin != cfg.schedStartMin ||
+                       c.schedStopMin  != cfg.schedStopMin ||
+                       !schedSameWindows(c.schedWindows, c.schedWindowCount,
+                                         cfg.schedWindows, cfg.schedWindowCount);
+        if (changed) {
+            cfg = c;
+            bumpLocked();
+        }
+        portEXIT_CRITICAL(&lock);
+        if (changed) wake();
+    }
+
+    // ---------- คำสั่งจาก LAN (LanServer) ----------
+    enum LocalField : uint8_t { LOCAL_MODE = 1, LOCAL_MANUAL = 2, LOCAL_TARGET = 4 };
+
+    // แก้เฉพาะ field ที่สั่งใต้ lock เดียว (ไม่ทับ field อื่นที่ stream เพิ่ง patch) → ปลุก control ทันที
+    void applyLocal(uint8_t fields, ControlMode mode, bool manual, int target) {
+        portENTER_CRITICAL(&lock);
+        bool changed = false;
+        if ((fields & LOCAL_MODE) && cfg.mode != mode)          { cfg.mode = mode;          changed = true; }
+        if ((fields & LOCAL_MANUAL) && cfg.manual != manual)    { cfg.manual = manual;      changed = true; }
+        if ((fields & LOCAL_TARGET) && cfg.targetHumid != target) { cfg.targetHumid = target; changed = true; }
+        localDirty |= fields;
+        if (version == 0) changed = true;        // ยังไม่เคยได้ config จาก cloud → ใช้ default + ค่านี้
+        if (changed) bumpLocked();
+        portEXIT_CRITICAL(&lock);
+        if (changed) wake();
+    }
+
+    // cloud task: field ที่ต้อง sync ขึ้น RTDB + ค่าปัจจุบัน (0 = ไม่มี)
+    uint8_t takeLocal(ControlConfig &out) {
+        portENTER_CRITICAL(&lock);
+        uint8_t f = localDirty;
+        localDirty = 0;
+        out = cfg;
+        portEXIT_CRITICAL(&lock);
+        return f;
+    }
+
+    // เขียนไม่สำเร็จ → ลองใหม่รอบหน้า
+    void requeueLocal(uint8_t fields) {
+        portENTER_CRITICAL(&lock);
+        localDirty |= fields;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    void setWakeTask(TaskHandle_t t) { wakeTask = t; }
+    uint32_t changedMicros() const { return changedUs; }
+
+    uint32_t events()      const { return eventCount;  }
+    unsigned long lastEvent() const { return lastEventMs; }
+};
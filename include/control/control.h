@@ -1,291 +1,358 @@
 #pragma once
 #include <Arduino.h>
 #include <time.h>
+#include <sys/time.h>
 #include <math.h>
+#include <limits.h>
 #include "gateway.h"
 #include "constant.h"
 #include "sensor/sensor.h"    // <- KY-015 (EnvSensorService)
+#include "node_table.h"
+#include "latency_stat.h"
+#include "log.h"
+#include "alloc_trace.h"
+#include "timer_service.h"
+#include "stage_profile.h"
+#include "control/safety.h"
+#include "cloud/cloud_task.h"
+#include "control/config_stream.h"
+#include "control/schedule.h"
+#include "lan/feed.h"
+
+// ack แล้วแต่ feedback ยังไม่ตรง → ตรวจ/ส่งซ้ำทุกเท่านี้
+#ifndef MISMATCH_CHECK_MS
+#define MISMATCH_CHECK_MS 400     // จาก 900 → 400ms
+#endif
+
+// รอบพิมพ์ stats + reportProfile() ของ ControlTask (statsDue())
+#ifndef CONTROL_STATS_MS
+#define CONTROL_STATS_MS 60000
+#endif
+
+// ---------- stage ของ update() (วัดเมื่อ build ด้วย env:profile) ----------
+enum ControlStage : uint8_t {
+    CS_CONFIG,      // 1) config cache
+    CS_ENV,         // 2) DHT
+    CS_RETX,        //    retransmit
+    CS_SENSOR,      // 3) sensor push (ต่อ node)
+    CS_SAFETY,      // 4) safety (ต่อ node)
+    CS_SCHEDULE,    // 5) schedule + countdown
+    CS_DECIDE,      // 6) state จาก config
+    CS_SEND,        // 7) ส่งคำสั่ง (ต่อ node)
+    CS_FEEDBACK,    // 8) feedback sync (ต่อ node)
+    CS_MISMATCH,    // 9) mismatch recovery (ต่อ node)
+    CS_COMMIT,      // 10) outbox commit
+    CS_TOTAL,
+    CS_COUNT
+};
+
+inline const char* controlStageText(uint8_t s) {
+    static const char* const t[CS_COUNT] = {
+        "config", "env", "retx", "sensor", "safety", "schedule",
+        "decide", "send", "feedback", "mismatch", "commit", "total"
+    };
+    return s < CS_COUNT ? t[s] : "?";
+}
+
+#ifndef PATH_DIAG_CONTROL
+#define PATH_DIAG_CONTROL "/diagnostics/control/"
+#endif
+
+// StageSummary → /diagnostics/control/<stage>/{n,min_ns,avg_ns,p99_ns,max_ns}
+inline void stageTlmEmit(TelemetrySink& b, const char* rec, uint32_t, const char*) {
+    StageSummary s;
+    memcpy(&s, rec, sizeof(s));
+    char pre[48];
+    snprintf(pre, sizeof(pre), "%s%s", PATH_DIAG_CONTROL, controlStageText(s.stage));
+    b.setInt("/n",      (int)s.n,     pre);
+    b.setInt("/min_ns", (int)s.minNs, pre);
+    b.setInt("/avg_ns", (int)s.avgNs, pre);
+    b.setInt("/p99_ns", (int)s.p99Ns, pre);
+    b.setInt("/max_ns", (int)s.maxNs, pre);
+}
 
 class ControlLogic {
 private:
     GatewayNetwork*   net;
     EnvSensorService* env;    // ใช้ข้อมูล T/H จากคลาสใหม่
+    CloudTask*        cloud;  // RTDB ทั้งหมดผ่าน task นี้ (ไม่ block control path)
+    RtdbOutbox*       out;
+    NodeTable*        nodes;
+    uint32_t          cfgVersion = 0;   // version ของ config cache ที่ apply ไปแล้ว
 
     // ---------- CONFIG จาก Firebase ----------
-    String mode = "manual";   // "manual" / "auto"
+    ControlMode mode = MODE_MANUAL;
     bool   manual = false;    // manual_state
     int    targetHumid = 60;  // %RH
 
     // schedule
-    bool schedEnable   = false;
-    int  schedStartMin = -1;  // นาทีจากเที่ยงคืน
-    int  schedStopMin  = -1;
+    bool           schedEnable = false;
+    ScheduleEngine sched;
 
     // ตรวจ user override
-    String prevMode   = "manual";
-    bool   prevManual = false;
+    ControlMode prevMode   = MODE_MANUAL;
+    bool        prevManual = false;
+    bool        schedOffPending = false;   // ยกเลิก schedule แล้วแต่ยังไม่ได้เขียน PATH_SCHED_ENABLE (offline)
 
     // ---------- STATE ภายใน ----------
-    bool lastCmd      = false;  // คำสั่งล่าสุดที่ส่งไป Sensor
-    bool lastFb       = false;  // feedback ล่าสุดจาก Sensor (controlState)
-    unsigned long lastCfg    = 0;
-    unsigned long lastSend   = 0;
-    unsigned long lastCheck  = 0;
-    unsigned long lastFbTime = 0;
-
-    uint8_t mismatchCount      = 0;
+    // state ต่อ node (lastCmd / mismatch / lastSensor ...) อยู่ใน NodeTable
     const uint8_t MAX_RECOVERY = 3;
 
-    // countdown schedule
-    unsigned long lastCountdownUpdate = 0;
+    // ---------- deadline ทั้งหมดของ control task ----------
+    TimerService timer;
+    int tEnv       = TimerService::NONE;
+    int tCountdown = TimerService::NONE;
+    int tRetx      = TimerService::NONE;
+    int tStats     = TimerService::NONE;
+    int tHeartbeat[GATEWAY_MAX_NODES];
+    int tCheck[GATEWAY_MAX_NODES];
+    int tPush[GATEWAY_MAX_NODES];
 
-    // safety master switch (compile-time)
-    const bool safetyEnabled = SAFETY_ENABLE_DEFAULT;
+    // event → command latency (packet เข้า / config เปลี่ยน → esp_now_send)
+    uint32_t    cfgEventUs = 0;   // micros() ของ config ที่เพิ่ง apply ใน tick นี้ (0 = ไม่มี)
+    LatencyStat cmdLatency;
 
-    // ---------- Sensor push -> Firebase ----------
-    SensorPacket   lastSensor{};
-    bool           hasLastSensor   = false;
-    unsigned long  lastSensorPush  = 0;
-
-    // ---------- helper: เวลา ----------
-    int parseHHMM(const String& s) {
-        int c = s.indexOf(':');
-        if (c < 0) return -1;
-        int h = s.substring(0, c).toInt();
-        int m = s.substring(c + 1).toInt();
-        if (h < 0 || h > 23 || m < 0 || m > 59) return -1;
-        return h * 60 + m;
-    }
+    LanFeed* lan    = nullptr;   // live feed ให้ LanServer (nullptr = ปิด)
+    uint32_t envSeq = 0;         // EnvSensorService::readings() ที่ส่งต่อไปแล้ว
 
-    void getNowHMS(time_t now, int &h, int &m, int &s) {
-        struct tm t;
-        localtime_r(&now, &t);
-        h = t.tm_hour;
-        m = t.tm_min;
-        s = t.tm_sec;
-    }
+    // heap allocation ต่อ tick (นับจริงเฉพาะ env:alloc_trace) — hot path ต้องเป็น 0
+    AllocStats  allocStats;
 
-    int minutesNow(time_t now) {
-        int h,m,s;
-        getNowHMS(now,h,m,s);
-        return h*60 + m;
-    }
+#ifdef STAGE_PROFILE
+    StageHist prof[CS_COUNT];     // สะสมจนกว่า reportProfile() จะสรุปแล้วล้าง
+#endif
 
+    // safety master switch (compile-time)
+    const bool safetyEnabled = SAFETY_ENABLE_DEFAULT;
+
+    // ---------- schedule (ScheduleEngine compile ตอน config เปลี่ยน) ----------
+    // เวลายังไม่ sync (ใช้ค่าจาก NVS อยู่) → ถือว่าไม่อยู่ใน window จนกว่า NTP จะตอบ
     bool inScheduleWindow(time_t now) {
-        if (!schedEnable) return false;
-        if (schedStartMin < 0 || schedStopMin < 0) return false;
+        if (!schedEnable || sched.empty() || !net->timeSynced()) return false;
+        return sched.evaluate(now);
+    }
 
-        int nowMin = minutesNow(now);
-        if (schedStartMin <= schedStopMin) {
-            // เคสปกติ 12:00 → 17:00
-            return (nowMin >= schedStartMin && nowMin < schedStopMin);
+    // config ใหม่ → ตาราง interval ใหม่ (ไม่มี windows = start/stop เดิม ทุกวัน)
+    void compileSchedule(const ControlConfig &c) {
+        if (c.schedWindowCount) {
+            sched.compile(c.schedWindows, c.schedWindowCount);
         } else {
-            // เคสข้ามเที่ยงคืน
-            return (nowMin >= schedStartMin || nowMin < schedStopMin);
+            SchedWindow w;
+            w.startMin = c.schedStartMin;
+            w.stopMin  = c.schedStopMin;
+            sched.compile(&w, 1);
         }
     }
 
     // ---------- countdown schedule ----------
-    void updateCountdown(time_t now, FirebaseData* fb, bool inWin) {
-        if (!schedEnable || schedStartMin < 0 || schedStopMin < 0 || !fb) return;
-
-        int h,m,s;
-        getNowHMS(now,h,m,s);
-        int nowSec   = h*3600 + m*60 + s;
-        int startSec = schedStartMin * 60;
-        int stopSec  = schedStopMin  * 60;
-
-        int diff = 0;
-
-        if (inWin) {
-            diff = stopSec - nowSec;
-        } else {
-            if (nowSec <= startSec)
-                diff = startSec - nowSec;
-            else
-                diff = 0;
+    // นับถอยหลังถึง transition ถัดไป (เข้า/ออก window) จาก ScheduleEngine ไม่ต้อง localtime_r
+    // > 60s เขียนทุกต้นนาที, ช่วงสุดท้ายทุก 10s → timer ตั้งไว้ที่ต้นวินาทีของครั้งถัดไป
+    void updateCountdown() {
+        if (!schedEnable || sched.empty() || !net->timeSynced()) {
+            timer.cancel(tCountdown);
+            return;
         }
-
-        if (diff < 0) diff = 0;
-
-        bool shouldUpdate = false;
-
-        if (diff > 60) {
-            if (s == 0 && millis() - lastCountdownUpdate > 800) {
-                shouldUpdate = true;
-            }
-        } else {
-            if ((diff % 10) == 0 && millis() - lastCountdownUpdate > 800) {
-                shouldUpdate = true;
-            }
+        if (timer.armed(tCountdown) && !timer.expired(tCountdown)) return;
+
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        long diff = sched.secondsToNextTransition(tv.tv_sec);
+        if (diff < 0) {
+            timer.cancel(tCountdown);
+            return;
         }
 
-        if (shouldUpdate) {
-            Firebase.RTDB.setInt(fb, PATH_SCHED_COUNTDOWN, diff);
-            lastCountdownUpdate = millis();
-            Serial.printf("[Schedule] Countdown = %d sec\n", diff);
-        }
-    }
+        // offline: ค่าชั่วคราว ไม่ต้องค้างคิวไว้ส่งทีหลัง
+        if (cloud->online()) out->setInt(PATH_SCHED_COUNTDOWN, (int)diff);
+        gwPrintf("[Schedule] Countdown = %ld sec\n", diff);
 
-    // ---------- tilt helper ----------
-    const char* tiltToText(uint8_t t) {
-        if (t == TILT_FALL)    return "FALL";
-        if (t == TILT_WARNING) return "WARN";
-        return "NORMAL";
+        long step = (diff > 60) ? 60 : 10;
+        long k = diff % step;
+        if (k == 0) k = (diff > 0 && diff < step) ? diff : step;
+        timer.after(tCountdown, (uint32_t)((k - 1) * 1000 + (1000 - tv.tv_usec / 1000)));
     }
 
-    // ---------- อ่าน config จาก Firebase ----------
-    void fetchConfig(FirebaseData* fb) {
-        if (!fb) return;
-        if (millis() - lastCfg < CONFIG_POLL_MS) return;
-
-        // mode
-        if (Firebase.RTDB.getString(fb, PATH_CTRL_MODE))
-            mode = fb->stringData();
-
-        // manual_state
-        if (Firebase.RTDB.getBool(fb, PATH_CTRL_MANUAL))
-            manual = fb->boolData();
+    // ---------- config ล่าสุดจาก cache (stream หรือ polling ใน cloud task) ----------
+    // คืน false ถ้ายังไม่เคยได้ config เลย
+    bool fetchConfig() {
+        ConfigStream &cs = cloud->config();
+        uint32_t v = cs.getVersion();
+        if (v == 0) return false;
+        if (v == cfgVersion) return true;
+
+        ControlConfig c;
+        cfgVersion    = cs.snapshot(c);
+        cfgEventUs    = cs.changedMicros();
+        mode          = c.mode;
+        manual        = c.manual;
+        targetHumid   = c.targetHumid;
+        schedEnable   = c.schedEnable;
+        compileSchedule(c);
+        timer.cancel(tCountdown);     // schedule เปลี่ยน → เขียน countdown ใหม่ทันที
+        traceConfig(c);
+        if (lan) lan->config(mode, manual, targetHumid);
+
+        checkUserOverride();
+        return true;
+    }
 
-        // humid target
-        if (Firebase.RTDB.getInt(fb, PATH_CTRL_TARGET_HUMID))
-            targetHumid = fb->intData();
+    // ---------- input ที่ update() เห็นจริง → trace สำหรับ replay บน host (env:trace) ----------
+    void traceSensor(uint8_t node, bool fresh, const SensorSample &s) {
+#ifdef TRACE_RECORD
+        if (fresh) cloud->trace().sensor(node, nodes->mac(node), s.pkt, s.rxMicros);
+#else
+        (void)node; (void)fresh; (void)s;
+#endif
+    }
 
-        // schedule enable
-        if (Firebase.RTDB.getBool(fb, PATH_SCHED_ENABLE))
-            schedEnable = fb->boolData();
+    void traceEnv() {
+#ifdef TRACE_RECORD
+        cloud->trace().env(env->getTemp(), env->getHumidity());
+#endif
+    }
 
-        // schedule start/stop
-        String sStart, sStop;
-        if (Firebase.RTDB.getString(fb, PATH_SCHED_START)) {
-            sStart = fb->stringData();
-            schedStartMin = parseHHMM(sStart);
-        }
-        if (Firebase.RTDB.getString(fb, PATH_SCHED_STOP)) {
-            sStop = fb->stringData();
-            schedStopMin = parseHHMM(sStop);
-        }
+    void traceConfig(const ControlConfig &c) {
+#ifdef TRACE_RECORD
+        cloud->trace().config(c, cfgEventUs);
+#else
+        (void)c;
+#endif
+    }
 
-        // user override → cancel schedule
+    // user override → cancel schedule (ใช้ทั้ง stream และ polling)
+    // ยกเลิกที่ gateway ทันที ส่วน PATH_SCHED_ENABLE=false ค้างเป็น flag (ไม่เข้า outbox ตอน offline)
+    void checkUserOverride() {
         bool userOverride = (mode != prevMode) || (manual != prevManual);
         prevMode   = mode;
         prevManual = manual;
 
         if (userOverride && schedEnable) {
-            schedEnable = false;
-            Firebase.RTDB.setBool(fb, PATH_SCHED_ENABLE, false);
+            schedEnable     = false;
+            schedOffPending = true;
             Serial.println("[Schedule] Cancelled by user override (Control)");
         }
+    }
 
-        lastCfg = millis();
+    // override กี่ครั้งตอน offline ก็เขียนครั้งเดียวเมื่อ online (task ไม่ drain outbox ระหว่างหลุด)
+    void flushUserOverride() {
+        if (!schedOffPending || !cloud->online()) return;
+        out->setBool(PATH_SCHED_ENABLE, false);
+        schedOffPending = false;
     }
 
     // ---------- push Sensor Node data -> Firebase ----------
-    void pushSensorToFirebase(const SensorPacket &d, FirebaseData* fb) {
-        if (!fb) return;
+    // field ไหนต้องส่ง (เปลี่ยน / heartbeat) ตัดสินจาก SENSOR_SCHEMA ที่เดียว
+    void pushSensorToFirebase(uint8_t node, NodeControl &c, const SensorPacket &d) {
         if (d.nodeId == 0) return;
 
-        bool changed = false;
-        if (!hasLastSensor ||
-            d.waterPercent != lastSensor.waterPercent ||
-            d.waterRaw     != lastSensor.waterRaw ||
-            d.tiltState    != lastSensor.tiltState ||
-            d.controlState != lastSensor.controlState) {
-            changed = true;
-        }
+        uint32_t nowMs = millis();
+        uint32_t mask  = SENSOR_SCHEMA.dirty(c.tlm, d, nowMs);
+        if (c.resync) mask |= SENSOR_SCHEMA.refreshMask(d);
+        if (!mask) return;
 
-        bool timeUp = (millis() - lastSensorPush > SENSOR_PUSH_MS);
-
-        if (!changed && !timeUp) return;
-
-        // water
-        Firebase.RTDB.setInt(fb, PATH_SENSOR_WATER_PCT, d.waterPercent);
-        Firebase.RTDB.setInt(fb, PATH_SENSOR_WATER_RAW, d.waterRaw);
-
-        // tilt
-        Firebase.RTDB.setInt(fb, PATH_SENSOR_TILT_STATE, d.tiltState);
-        Firebase.RTDB.setString(fb, PATH_SENSOR_TILT_STATE_TXT, tiltToText(d.tiltState));
-
-        // control state (feedback)
-        Firebase.RTDB.setBool(fb, PATH_SENSOR_CONTROL_STATE, d.controlState);
-
-        // keyPress: log เฉพาะตอนมีการกดจริง ๆ
-        if (d.keyPress != 0 && d.keyPress != lastSensor.keyPress) {
-            String keyStr; keyStr += d.keyPress;
-            Firebase.RTDB.setString(fb, PATH_SENSOR_KEY_LAST, keyStr);
+        // cloud หลุด → เก็บลง store-and-forward แทน outbox (กันค่าเก่าค้างคิว)
+        // กลับมา online แล้วค่อย push ค่าล่าสุดเต็มชุด
+        if (!cloud->telemetryOnline()) {
+            recordHistory(node, &d);
+            c.resync = true;
+        } else {
+            c.resync = false;
+            out->setTelemetry(sensorTlmEmit, d, mask, node);   // 1 slot ต่อ sample
         }
 
-        lastSensor     = d;
-        hasLastSensor  = true;
-        lastSensorPush = millis();
+        SENSOR_SCHEMA.commit(c.tlm, d, mask, nowMs);
+        c.lastSensor    = d;
+        c.hasLastSensor = true;
     }
 
-public:
-    ControlLogic(GatewayNetwork* n, EnvSensorService* e)
-        : net(n), env(e) {}
-
-    void begin() {
-        if (env) env->begin();
+    // push + ตั้ง deadline ของ heartbeat/rate limit ถัดไปจาก schema
+    void pushSensor(uint8_t node, const SensorPacket &d) {
+        STAGE_SCOPE(prof, CS_SENSOR);
+        NodeControl &c = nodes->control(node);
+        timer.expired(tPush[node]);
+        pushSensorToFirebase(node, c, d);
+        if (!c.hasLastSensor) return;
+
+        uint32_t t = SENSOR_SCHEMA.msUntilDue(c.tlm, c.lastSensor, millis());
+        if (t == UINT32_MAX) timer.cancel(tPush[node]);
+        else                 timer.after(tPush[node], t);
     }
 
-    void update(time_t now, SensorPacket &d) {
-        if (!net || !net->ok()) return;
-        FirebaseData* fb = net->get();
+    void recordHistory(uint8_t node, const SensorPacket* d) {
+        TelemetryRecord r;
+        memset(&r, 0, sizeof(r));
+        r.ts   = (uint32_t)time(nullptr);
+        r.ms   = (uint16_t)(millis() % 1000);
+        r.boot = net->bootCache().bootCount();
+        r.node = node;
+        if (d) {
+            r.waterPct = d->waterPercent;
+            r.waterRaw = d->waterRaw;
+            r.tilt     = d->tiltState;
+            r.ctrl     = d->controlState ? 1 : 0;
+        } else if (env) {
+            r.temp10 = (int16_t)lroundf(env->getTemp() * 10.0f);
+            r.hum10  = (int16_t)lroundf(env->getHumidity() * 10.0f);
+        }
+        cloud->history().record(r);
+    }
 
-        // 1) อ่าน config จาก Firebase
-        fetchConfig(fb);
+    // ---------- state ที่ควรเป็นจาก config (ใช้ร่วมทุก node) ----------
+    bool decideFromConfig(bool inWin) {
+        if (schedEnable && inWin) {
+            return true;     // ถึงเวลาตั้งเวลา → บังคับเปิด
+        }
+        if (mode == MODE_MANUAL) {
+            return manual;
+        }
+        if (mode == MODE_AUTO) {
+            float h = (env ? env->getHumidity() : NAN);
+            bool hasHumidity = env && env->isReady() && !isnan(h) && h > 0.0f;
 
-        // 2) อัปเดต DHT11 + push env ขึ้น Firebase
-        if (env) env->update(fb);
+            // แห้งกว่า target → เปิด, ไม่มีค่า humidity → ปิดไว้ก่อนเพื่อความปลอดภัย
+            return hasHumidity && (h < (float)targetHumid);
+        }
+        return false;
+    }
 
-        // 3) push ข้อมูลจาก Sensor Node ขึ้น Firebase
-        pushSensorToFirebase(d, fb);
+    // ---------- ต่อ node: safety → ส่งคำสั่ง → feedback → mismatch ----------
+    void updateNode(uint8_t node, bool cfgWant, bool inWin) {
+        NodeControl &c = nodes->control(node);
 
-        // 4) คำนวณ safety (เงื่อนไขขึ้นกับ safetyEnabled)
-        bool unsafe = false;
-        String unsafeReason;
+        SensorSample sample;
+        bool fresh = nodes->mailbox(node).take(sample);
+        const SensorPacket &d = sample.pkt;
+        traceSensor(node, fresh, sample);
+        if (fresh && lan) lan->sensor(node, d);
 
-        if (safetyEnabled && d.nodeId != 0) {
-            if (d.waterPercent <= CONTROL_WATER_EMPTY_PCT) {
-                unsafe = true;
-                unsafeReason += "WATER_EMPTY";
-            }
-            if (d.tiltState == TILT_FALL) {
-                if (unsafeReason.length()) unsafeReason += "+";
-                unsafeReason += "TILT_FALL";
-                unsafe = true;
-            }
+        // event ที่เก่าสุดใน tick นี้ที่อาจทำให้คำสั่งเปลี่ยน
+        uint32_t eventUs = cfgEventUs;
+        if (fresh && (eventUs == 0 || (int32_t)(sample.rxMicros - eventUs) < 0)) {
+            eventUs = sample.rxMicros;
         }
 
-        // 5) schedule window + countdown
-        bool inWin = inScheduleWindow(now);
-        updateCountdown(now, fb, inWin);
-
-        // 6) ตัดสินใจ state ที่ควรจะเป็น
-        bool want = false;
-
-        if (unsafe) {
-            want = false;    // safety สำคัญสุด
-        } else if (schedEnable && inWin) {
-            want = true;     // ถึงเวลาตั้งเวลา → บังคับเปิด
-        } else {
-            if (mode == "manual") {
-                want = manual;
-            } else if (mode == "auto") {
-                float h = (env ? env->getHumidity() : NAN);
-                bool hasHumidity = env && env->isReady() && !isnan(h) && h > 0.0f;
-
-                if (hasHumidity) {
-                    // แห้งกว่า target → เปิด
-                    want = (h < (float)targetHumid);
-                } else {
-                    want = false; // ไม่มีค่า humidity → ปิดไว้ก่อนเพื่อความปลอดภัย
-                }
-            } else {
-                want = false;
-            }
+        // 3) push ข้อมูลจาก Sensor Node ขึ้น Firebase (เข้า outbox)
+        pushSensor(node, d);
+        STAGE_LAP_BEGIN(lap);
+
+        // 4) คำนวณ safety (เงื่อนไขขึ้นกับ safetyEnabled) — เงื่อนไขเดียวกับ fast path
+        uint8_t reason = safetyEvaluate(d);
+        bool unsafe = (reason != SAFETY_OK);
+
+        // 4.1) fast path ใน onRecv ส่ง OFF ไปแล้ว → sync state ไม่ต้องส่งซ้ำ
+        NodeSafety &ns = nodes->safety(node);
+        uint8_t tripped = ns.pending.exchange(0, std::memory_order_acquire);
+        if (tripped) {
+            c.lastCmd = false;
+            timer.after(tHeartbeat[node], CMD_HEARTBEAT_MS);
+            timer.after(tCheck[node], MISMATCH_CHECK_MS);
+            gwPrintf("[SAFETY] #%u fast-path OFF reason=%s (rx->send %luus)\n",
+                     node, safetyReasonText(tripped), (unsigned long)ns.lastLatencyUs);
         }
 
+        // 6) safety สำคัญสุด
+        bool want = unsafe ? false : cfgWant;
+
         const char* safeStr;
         if (!safetyEnabled) {
             safeStr = "DISABLED";
@@ -293,72 +360,272 @@ public:
             safeStr = unsafe ? "BLOCK" : "OK";
         }
         const char* schedNowStr = (schedEnable && inWin) ? "ON" : "OFF";
+        STAGE_LAP(lap, prof, CS_SAFETY);
 
         // 7) ส่งคำสั่งไป Sensor Node (control-only)
-        if (want != lastCmd || millis() - lastSend > CMD_HEARTBEAT_MS) {
-            net->send(want);
-            lastCmd   = want;
-            lastSend  = millis();
-            lastCheck = millis();
-
-            Serial.printf("[Sent]  CMD=%s (mode=%s, sched_en=%s, sched_now=%s, safety=%s)\n",
-                          want ? "ON" : "OFF",
-                          mode.c_str(),
-                          schedEnable ? "ON" : "OFF",
-                          schedNowStr,
-                          safeStr);
+        bool heartbeat = !timer.armed(tHeartbeat[node]) || timer.expired(tHeartbeat[node]);
+        if (want != c.lastCmd || heartbeat) {
+            bool changedCmd = (want != c.lastCmd);
+            net->send(node, want);
+            if (changedCmd && eventUs != 0) {
+                cmdLatency.add((uint32_t)(micros() - eventUs));
+            }
+            c.lastCmd = want;
+            if (heartbeat) timer.rearm(tHeartbeat[node], CMD_HEARTBEAT_MS);
+            else           timer.after(tHeartbeat[node], CMD_HEARTBEAT_MS);
+            timer.after(tCheck[node], MISMATCH_CHECK_MS);
+
+            gwPrintf("[Sent]  #%u CMD=%s (mode=%s, sched_en=%s, sched_now=%s, safety=%s)\n",
+                     node,
+                     want ? "ON" : "OFF",
+                     controlModeText(mode),
+                     schedEnable ? "ON" : "OFF",
+                     schedNowStr,
+                     safeStr);
 
             if (unsafe && safetyEnabled) {
-                Serial.printf("[SAFETY] reason=%s (water=%d%%, tilt=%s)\n",
-                              unsafeReason.c_str(),
-                              d.waterPercent,
-                              tiltToText(d.tiltState));
+                gwPrintf("[SAFETY] #%u reason=%s (water=%d%%, tilt=%s)\n",
+                         node,
+                         safetyReasonText(reason),
+                         d.waterPercent,
+                         tiltText(d.tiltState));
             }
         }
 
+        STAGE_LAP(lap, prof, CS_SEND);
+
         // 8) feedback จาก Sensor: sync control_state
+        //    offline → ไม่เข้าคิว, lastFb ยังเป็นค่าที่ขึ้น RTDB ล่าสุด → online แล้วเขียนค่าปัจจุบันทีเดียว
         bool fbState = d.controlState;
-        if (fbState != lastFb) {
-            if (fb) Firebase.RTDB.setBool(fb, PATH_CTRL_STATE, fbState);
-            lastFb     = fbState;
-            lastFbTime = millis();
+        if (fbState != c.lastFb && cloud->online()) {
+            out->setBool(PATH_CTRL_STATE, fbState, node);
+            c.lastFb     = fbState;
+            c.lastFbTime = millis();
         }
+        if (lan) lan->state(node, want, fbState);
+        STAGE_LAP(lap, prof, CS_FEEDBACK);
 
         // 9) mismatch + auto recovery (เร็วขึ้น)
-        if (millis() - lastCheck > 400) {   // จาก 900 → 400ms
-            if (want != fbState) {
-                if (mismatchCount < MAX_RECOVERY) {
-                    mismatchCount++;
-                    Serial.printf("⚠ CONTROL MISMATCH - attempt %d, resend CMD=%s\n",
-                                  mismatchCount, want ? "ON" : "OFF");
-
-                    net->send(want);
-                    lastSend  = millis();
-                    lastCheck = millis();
+        // frame ที่ยังไม่ ack → ให้ CommandLink ส่งซ้ำตาม RTO (ระดับ ms) ไปก่อน
+        // check นี้เหลือไว้สำหรับกรณี ack แล้วแต่ relay ไม่เปลี่ยนตาม
+        // timer ของ check ตั้งเฉพาะตอน state ไม่ตรง (ตรงกันแล้วไม่ต้องตื่น)
+        int tc = tCheck[node];
+        if (want == fbState) {
+            if (c.mismatchCount > 0) {
+                gwPrintf("[CONTROL] #%u Mismatch resolved. States are in sync.\n", node);
+            }
+            c.mismatchCount = 0;
+            timer.cancel(tc);
+        } else if (!timer.armed(tc)) {
+            timer.after(tc, MISMATCH_CHECK_MS);
+        } else if (timer.expired(tc)) {
+            if (nodes->link(node).pending()) {
+                timer.after(tc, MISMATCH_CHECK_MS);    // ยังรอ ack อยู่ → ดูใหม่รอบหน้า
+            } else {
+                if (c.mismatchCount < MAX_RECOVERY) {
+                    c.mismatchCount++;
+                    gwPrintf("⚠ CONTROL MISMATCH #%u - attempt %d, resend CMD=%s\n",
+                             node, c.mismatchCount, want ? "ON" : "OFF");
+
+                    net->send(node, want);
+                    timer.after(tHeartbeat[node], CMD_HEARTBEAT_MS);
+                    timer.after(tc, MISMATCH_CHECK_MS);
                 } else {
-                    Serial.println("❗ CONTROL MISMATCH PERSIST - trusting Sensor and syncing state");
+                    gwPrintf("❗ CONTROL MISMATCH PERSIST #%u - trusting Sensor and syncing state\n", node);
 
                     bool real = fbState;
-                    lastCmd = real;
-                    mismatchCount = 0;
+                    c.lastCmd = real;
+                    c.mismatchCount = 0;
 
-                    // ถ้าอยู่ใน manual → sync manual_state ให้ตรงกับของจริง
-                    if (mode == "manual" && fb) {
+                    // node หลักอยู่ใน manual → sync manual_state (ใช้ร่วมทั้งห้อง) ให้ตรงกับของจริง
+                    if (node == 0 && mode == MODE_MANUAL) {
                         manual = real;
-                        Firebase.RTDB.setBool(fb, PATH_CTRL_MANUAL, real);
-                        Serial.printf("[AUTO-SYNC] Update PATH_CTRL_MANUAL to %s\n",
-                                      real ? "true" : "false");
+                        out->setBool(PATH_CTRL_MANUAL, real);
+                        gwPrintf("[AUTO-SYNC] Update PATH_CTRL_MANUAL to %s\n",
+                                 real ? "true" : "false");
                     }
-
-                    lastCheck = millis();
                 }
-            } else {
-                if (mismatchCount > 0) {
-                    Serial.println("[CONTROL] Mismatch resolved. States are in sync.");
-                }
-                mismatchCount = 0;
-                lastCheck = millis();
             }
         }
+        STAGE_LAP(lap, prof, CS_MISMATCH);
+    }
+
+public:
+    ControlLogic(GatewayNetwork* n, EnvSensorService* e, CloudTask* c, NodeTable* t)
+        : net(n), env(e), cloud(c), out(&c->outbox()), nodes(t) {
+        // slot ไม่พอ → add() คืน NONE แล้ว heartbeat ของ node ท้าย ๆ ยิงทุก tick
+        static_assert(4 + 3 * GATEWAY_MAX_NODES <= TIMER_MAX_SLOTS,
+                      "TIMER_MAX_SLOTS too small for GATEWAY_MAX_NODES");
+        int gHb   = timer.addGroup("heartbeat");
+        int gChk  = timer.addGroup("mismatch");
+        int gPush = timer.addGroup("sensor");
+        tEnv       = timer.add(timer.addGroup("env"));
+        tCountdown = timer.add(timer.addGroup("countdown"));
+        tRetx      = timer.add(timer.addGroup("retransmit"));
+        tStats     = timer.add(timer.addGroup("stats"));
+        for (int i = 0; i < GATEWAY_MAX_NODES; i++) {
+            tHeartbeat[i] = timer.add(gHb);
+            tCheck[i]     = timer.add(gChk);
+            tPush[i]      = timer.add(gPush);
+        }
+    }
+
+    void begin() {
+        if (env) env->begin();
+    }
+
+    // live feed ไป LanServer (เรียกก่อน task เริ่ม)
+    void setLan(LanFeed* f) { lan = f; }
+
+    // มี config ใหม่ใน cache ที่ยังไม่ได้ apply → ควรปลุก update() ทันที
+    bool configPending() const {
+        return cloud->config().getVersion() != cfgVersion;
+    }
+
+    void update(time_t now) {
+        if (!net || !nodes) return;
+        AllocScope allocScope(allocStats);
+        STAGE_SCOPE(prof, CS_TOTAL);
+        STAGE_LAP_BEGIN(lap);
+
+        // 1) อ่าน config จาก cache (ไม่มี network I/O)
+        //    ยังไม่เคยได้ config → ยังไม่สั่งงาน (เหมือนเดิมที่รอ Firebase ready)
+        bool hasConfig = fetchConfig();
+        flushUserOverride();
+        STAGE_LAP(lap, prof, CS_CONFIG);
+
+        // 2) สั่ง DHT อ่านทุก ENV_POLL_MS (ไม่ block) + ใช้ค่าที่ decode เสร็จแล้ว push ขึ้น Firebase
+        if (env) {
+            if (!timer.armed(tEnv) || timer.expired(tEnv)) {
+                timer.rearm(tEnv, ENV_POLL_MS);
+                env->startRead();
+            }
+            // offline → ไม่เข้า outbox (task ไม่ drain ระหว่างหลุด) เก็บลง history แทน
+            bool online = cloud->telemetryOnline();
+            if (env->update(online ? out : nullptr) && !online) {
+                recordHistory(TelemetryRecord::NODE_ENV, nullptr);
+            }
+            if (env->readings() != envSeq) {
+                envSeq = env->readings();
+                traceEnv();
+                if (lan) lan->env(env->getTemp(), env->getHumidity());
+            }
+        }
+        STAGE_LAP(lap, prof, CS_ENV);
+
+        // ส่งซ้ำคำสั่งที่ยังไม่ได้ ack (ครบ RTO)
+        timer.expired(tRetx);
+        net->serviceRetransmits();
+        unsigned long rtx = net->msUntilRetransmit(ULONG_MAX);
+        if (rtx == ULONG_MAX) timer.cancel(tRetx);
+        else                  timer.after(tRetx, rtx);
+        STAGE_LAP(lap, prof, CS_RETX);
+
+        uint8_t count = nodes->count();
+
+        if (!hasConfig) {
+            // ยังสั่งงานไม่ได้ แต่ยัง push ข้อมูล sensor ขึ้นไปตามปกติ
+            for (uint8_t i = 0; i < count; i++) {
+                SensorSample sample;
+                bool fresh = nodes->mailbox(i).take(sample);
+                traceSensor(i, fresh, sample);
+                if (fresh && lan) lan->sensor(i, sample.pkt);
+                pushSensor(i, sample.pkt);
+            }
+            STAGE_LAP_SKIP(lap);
+            out->commit();
+            if (lan) lan->commit();
+            STAGE_LAP(lap, prof, CS_COMMIT);
+            return;
+        }
+
+        // 5) schedule window + countdown (ใช้ร่วมทุก node)
+        bool inWin = inScheduleWindow(now);
+        updateCountdown();
+        STAGE_LAP(lap, prof, CS_SCHEDULE);
+
+        // 6) state จาก config คำนวณครั้งเดียว แล้วแต่ละ node ค่อยตัดด้วย safety ของตัวเอง
+        bool cfgWant = decideFromConfig(inWin);
+        STAGE_LAP(lap, prof, CS_DECIDE);
+
+        // 3, 4, 7-9 วัดแยกใน updateNode ต่อ node
+        for (uint8_t i = 0; i < count; i++) {
+            updateNode(i, cfgWant, inWin);
+        }
+        cfgEventUs = 0;
+        STAGE_LAP_SKIP(lap);
+
+        // 10) ปลุก cloud task ให้ส่งทุก write ของ tick นี้เป็น PATCH เดียว (+ LAN task ถ้ามี event)
+        out->commit();
+        if (lan) lan->commit();
+        STAGE_LAP(lap, prof, CS_COMMIT);
+    }
+
+    // ---------- deadline ถัดไปที่ update() ต้องรันแม้ไม่มี event ----------
+    // heartbeat / mismatch check / sensor push / countdown / env poll / retransmit อยู่ใน TimerService
+    unsigned long msUntilNextDeadline(unsigned long cap) {
+        return timer.msUntilNext(cap);
+    }
+
+    TimerService& timers() { return timer; }
+
+    // ครบรอบ CONTROL_STATS_MS → true ครั้งเดียว (เรียกหลัง update() จาก task เดียวกัน)
+    // deadline อยู่ใน TimerService → msUntilNextDeadline() ปลุก task ให้ตรงรอบเอง
+    bool statsDue() {
+        if (!timer.armed(tStats)) {
+            timer.after(tStats, CONTROL_STATS_MS);
+            return false;
+        }
+        if (!timer.expired(tStats)) return false;
+        timer.rearm(tStats, CONTROL_STATS_MS);
+        return true;
+    }
+
+    const LatencyStat& commandLatency() const { return cmdLatency; }
+
+    // allocation ต่อ tick (ทุกค่าเป็น 0 ถ้าไม่ได้ build ด้วย ALLOC_TRACE)
+    const AllocStats& allocations() const { return allocStats; }
+
+    // สรุป stage ตั้งแต่ครั้งก่อน → Serial + /diagnostics/control แล้วเริ่มนับใหม่
+    // เรียกจาก task เดียวกับ update() (ไม่มี lock)
+    void reportProfile() {
+#ifdef STAGE_PROFILE
+        for (uint8_t i = 0; i < CS_COUNT; i++) {
+            if (prof[i].count == 0) continue;
+            StageSummary s = stageSummarize(i, prof[i]);
+            Serial.printf("[Prof] %-9s n=%lu min=%lu avg=%lu p99<=%lu max=%lu ns\n",
+                          controlStageText(i),
+                          (unsigned long)s.n,
+                          (unsigned long)s.minNs,
+                          (unsigned long)s.avgNs,
+                          (unsigned long)s.p99Ns,
+                          (unsigned long)s.maxNs);
+            if (cloud->online()) out->setRecord(stageTlmEmit, s, 1);
+            prof[i].reset();
+        }
+        out->commit();
+#endif
+    }
+
+    void printLatency() const {
+        Serial.printf("[Control] event->cmd n=%lu avg=%luus max=%luus last=%luus\n",
+                      (unsigned long)cmdLatency.count,
+                      (unsigned long)cmdLatency.avgUs(),
+                      (unsigned long)cmdLatency.maxUs,
+                      (unsigned long)cmdLatency.lastUs);
+
+        const LatencyStat &fs = net->safetyFastLatency();
+        Serial.printf("[SAFETY] fast-path rx->OFF n=%lu avg=%luus max=%luus\n",
+                      (unsigned long)fs.count,
+                      (unsigned long)fs.avgUs(),
+                      (unsigned long)fs.maxUs);
+
+#ifdef ALLOC_TRACE
+        Serial.printf("[Alloc] update() last=%lu max=%lu dirty=%lu/%lu ticks\n",
+                      (unsigned long)allocStats.lastTick,
+                      (unsigned long)allocStats.maxTick,
+                      (unsigned long)allocStats.dirtyTicks,
+                      (unsigned long)allocStats.ticks);
+#endif
     }
 };
@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include "constant.h"
+
+// ตัด OFF ทันทีใน onRecv โดยไม่รอ control loop / cloud
+#ifndef SAFETY_FAST_PATH
+#define SAFETY_FAST_PATH 1
+#endif
+
+// ---------- เหตุผลที่ไม่ปลอดภัย (bitmask) ----------
+enum SafetyReason : uint8_t {
+    SAFETY_OK          = 0,
+    SAFETY_WATER_EMPTY = 1 << 0,
+    SAFETY_TILT_FALL   = 1 << 1,
+};
+
+// ใช้ทั้ง fast path (Wi-Fi task) และ slow path (ControlLogic) → เงื่อนไขเดียวกันเสมอ
+inline uint8_t safetyEvaluate(const SensorPacket &d) {
+    if (!SAFETY_ENABLE_DEFAULT || d.nodeId == 0) return SAFETY_OK;
+
+    uint8_t r = SAFETY_OK;
+    if (d.waterPercent <= CONTROL_WATER_EMPTY_PCT) r |= SAFETY_WATER_EMPTY;
+    if (d.tiltState == TILT_FALL)                  r |= SAFETY_TILT_FALL;
+    return r;
+}
+
+// bitmask → ข้อความสำหรับ log (ตาราง static ไม่ต้องต่อ String)
+inline const char* safetyReasonText(uint8_t r) {
+    static const char* const txt[4] = { "OK", "WATER_EMPTY", "TILT_FALL", "WATER_EMPTY+TILT_FALL" };
+    return txt[r & (SAFETY_WATER_EMPTY | SAFETY_TILT_FALL)];
+}
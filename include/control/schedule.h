@@ -0,0 +1,213 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+// หลายช่วงเวลาต่อวัน + เลือกวันในสัปดาห์: "07:00-09:00/12345, 18:30-01:00"
+// (ไม่มี /... = ทุกวัน, เลขวัน 0=อา ... 6=ส, ข้ามเที่ยงคืนได้)
+#ifndef PATH_SCHED_WINDOWS
+#define PATH_SCHED_WINDOWS "/control/schedule/windows"
+#endif
+
+#ifndef SCHED_MAX_WINDOWS
+#define SCHED_MAX_WINDOWS 8
+#endif
+
+#define SCHED_ALL_DAYS 0x7F
+#define SCHED_DAY_MIN  1440
+#define SCHED_WEEK_MIN (7 * SCHED_DAY_MIN)
+
+struct SchedWindow {
+    uint8_t days     = SCHED_ALL_DAYS;   // bit d = tm_wday d
+    int16_t startMin = -1;               // นาทีจากเที่ยงคืน
+    int16_t stopMin  = -1;               // < startMin = ข้ามเที่ยงคืน
+};
+
+// "HH:MM-HH:MM[/days]" คั่นด้วย ',' หรือ ';' → คืนจำนวน window (ไม่มี allocation)
+// window ที่รูปแบบผิดถูกข้าม
+inline uint8_t schedParseWindows(const char* s, SchedWindow* out, uint8_t max) {
+    uint8_t n = 0;
+    while (*s && n < max) {
+        while (*s == ' ' || *s == ',' || *s == ';') s++;
+        if (!*s) break;
+
+        int v[4] = { 0, 0, 0, 0 };
+        bool ok = true;
+        for (int k = 0; k < 4 && ok; k++) {
+            int digits = 0;
+            while (*s == ' ') s++;
+            for (; *s >= '0' && *s <= '9'; s++, digits++) {
+                if (digits < 2) v[k] = v[k] * 10 + (*s - '0');
+            }
+            if (digits == 0 || digits > 2) { ok = false; break; }
+            if (k == 1) while (*s == ' ') s++;
+            // ตัวคั่นต้องมีจริงก่อนขยับ (input ถูกตัดกลางคัน เช่น "07:00-09" ห้ามเลย '\0')
+            char sep = (k == 0 || k == 2) ? ':' : (k == 1 ? '-' : 0);
+            if (sep) {
+                ok = (*s == sep);
+                if (ok) s++;
+            }
+        }
+
+        SchedWindow w;
+        if (ok && *s == '/') {
+            s++;
+            w.days = 0;
+            for (; *s >= '0' && *s <= '6'; s++) w.days |= 1 << (*s - '0');
+        }
+        if (ok && v[0] <= 23 && v[1] <= 59 && v[2] <= 23 && v[3] <= 59 && w.days) {
+            w.startMin = v[0] * 60 + v[1];
+            w.stopMin  = v[2] * 60 + v[3];
+            out[n++] = w;
+        }
+        while (*s && *s != ',' && *s != ';') s++;   // ข้ามส่วนที่เหลือของ window นี้
+    }
+    return n;
+}
+
+inline bool schedSameWindows(const SchedWindow* a, uint8_t na, const SchedWindow* b, uint8_t nb) {
+    if (na != nb) return false;
+    for (uint8_t i = 0; i < na; i++) {
+        if (a[i].days != b[i].days || a[i].startMin != b[i].startMin || a[i].stopMin != b[i].stopMin)
+            return false;
+    }
+    return true;
+}
+
+// ---------- ตาราง interval ใน 1 สัปดาห์ (นาที) เรียง + รวมช่วงที่ทับกัน ----------
+// compile ครั้งเดียวตอน config เปลี่ยน, query ด้วย binary search
+// ผลล่าสุด cache ไว้จนถึง transition ถัดไป → tick ปกติไม่ต้อง localtime_r
+class ScheduleEngine {
+private:
+    struct Interval {
+        uint16_t start;   // นาทีจากอาทิตย์ 00:00
+        uint16_t stop;    // exclusive
+    };
+
+    static const uint8_t MAX_IV = SCHED_MAX_WINDOWS * 7 * 2;
+
+    Interval iv[MAX_IV];
+    uint8_t  n = 0;
+
+    // cache ของ evaluate() ล่าสุด
+    bool   cacheOk  = false;
+    bool   inWin    = false;
+    time_t evalAt   = 0;
+    time_t nextEdge = 0;     // 0 = ไม่มี transition (ว่าง / เปิดตลอด)
+
+    void addInterval(uint16_t s, uint16_t e) {
+        if (s >= e || n >= MAX_IV) return;
+        iv[n].start = s;
+        iv[n].stop  = e;
+        n++;
+    }
+
+    static long secOfWeek(time_t now) {
+        struct tm t;
+        localtime_r(&now, &t);
+        return t.tm_wday * 86400L + t.tm_hour * 3600L + t.tm_min * 60L + t.tm_sec;
+    }
+
+    // interval ตัวสุดท้ายที่ start <= m (-1 = ไม่มี)
+    int floorIndex(uint16_t m) const {
+        int lo = 0, hi = n;             // หา upper_bound ของ start
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (iv[mid].start <= m) lo = mid + 1;
+            else                    hi = mid;
+        }
+        return lo - 1;
+    }
+
+public:
+    void clear() {
+        n = 0;
+        cacheOk = false;
+    }
+
+    void compile(const SchedWindow* w, uint8_t count) {
+        clear();
+        for (uint8_t k = 0; k < count; k++) {
+            int s = w[k].startMin, e = w[k].stopMin;
+            if (s < 0 || e < 0 || s == e) continue;
+            int len = (s < e) ? e - s : SCHED_DAY_MIN - s + e;
+
+            for (int d = 0; d < 7; d++) {
+                if (!(w[k].days & (1 << d))) continue;
+                int a = d * SCHED_DAY_MIN + s;
+                int b = a + len;
+                if (b <= SCHED_WEEK_MIN) {
+                    addInterval(a, b);
+                } else {                              // เสาร์ข้ามไปอาทิตย์
+                    addInterval(a, SCHED_WEEK_MIN);
+                    addInterval(0, b - SCHED_WEEK_MIN);
+                }
+            }
+        }
+
+        // insertion sort (n เล็ก, ทำตอน config เปลี่ยนเท่านั้น)
+        for (uint8_t i = 1; i < n; i++) {
+            Interval x = iv[i];
+            int j = i - 1;
+            while (j >= 0 && iv[j].start > x.start) {
+                iv[j + 1] = iv[j];
+                j--;
+            }
+            iv[j + 1] = x;
+        }
+
+        // รวมช่วงที่ทับ/ต่อกัน
+        uint8_t m = 0;
+        for (uint8_t i = 0; i < n; i++) {
+            if (m && iv[i].start <= iv[m - 1].stop) {
+                if (iv[i].stop > iv[m - 1].stop) iv[m - 1].stop = iv[i].stop;
+            } else {
+                iv[m++] = iv[i];
+            }
+        }
+        n = m;
+    }
+
+    bool    empty()     const { return n == 0; }
+    uint8_t intervals() const { return n;      }
+
+    // อยู่ในช่วงหรือไม่ ณ นาทีของสัปดาห์ + นาทีถึง transition ถัดไป (-1 = ไม่มี)
+    bool lookup(uint16_t m, int32_t &untilMin) const {
+        untilMin = -1;
+        if (n == 0) return false;
+        if (n == 1 && iv[0].start == 0 && iv[0].stop == SCHED_WEEK_MIN) return true;
+
+        int i = floorIndex(m);
+        if (i >= 0 && m < iv[i].stop) {
+            int32_t end = iv[i].stop;
+            // ช่วงที่ชนปลายสัปดาห์ต่อกับช่วงต้นสัปดาห์
+            if (end == SCHED_WEEK_MIN && iv[0].start == 0) end += iv[0].stop;
+            untilMin = end - m;
+            return true;
+        }
+
+        // ยังไม่ถึงช่วงถัดไป (ถ้าเลยตัวสุดท้ายแล้ว → ตัวแรกของสัปดาห์หน้า)
+        int32_t next = (i + 1 < n) ? iv[i + 1].start : iv[0].start + SCHED_WEEK_MIN;
+        untilMin = next - m;
+        return false;
+    }
+
+    // ใช้ cache จนกว่าจะถึง transition ถัดไป / เวลากระโดดถอยหลัง
+    bool evaluate(time_t now) {
+        if (cacheOk && now >= evalAt && (nextEdge == 0 || now < nextEdge)) return inWin;
+
+        long sow = secOfWeek(now);
+        int32_t untilMin;
+        inWin    = lookup((uint16_t)(sow / 60), untilMin);
+        nextEdge = (untilMin < 0) ? 0 : now + untilMin * 60L - (sow % 60);
+        evalAt   = now;
+        cacheOk  = true;
+        return inWin;
+    }
+
+    // วินาทีถึง transition ถัดไป (-1 = ไม่มี) — เรียกหลัง evaluate()
+    long secondsToNextTransition(time_t now) const {
+        if (!cacheOk || nextEdge == 0) return -1;
+        long d = (long)(nextEdge - now);
+        return d > 0 ? d : 0;
+    }
+};
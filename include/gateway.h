@@ -2,69 +2,216 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <esp_now.h>
+#include <esp_wifi.h>
+#include <esp_sntp.h>
 #include <Firebase_ESP_Client.h>
 #include "addons/TokenHelper.h"
 #include "addons/RTDBHelper.h"
 #include "constant.h"
+#include "node_table.h"
+#include "control/safety.h"
+#include "latency_stat.h"
+#include "boot_cache.h"
 #include <time.h>
 
-extern SensorPacket currentSensorData;
-extern bool isSensorDataNew;
+extern NodeTable nodeTable;
+
+#ifndef FIREBASE_AUTH_TIMEOUT_MS
+#define FIREBASE_AUTH_TIMEOUT_MS 20000 // token เก่าใช้ไม่ได้ภายในนี้ → signUp ใหม่
+#endif
+
+#ifndef WIFI_FAST_CONNECT_MS
+#define WIFI_FAST_CONNECT_MS 8000      // ต่อด้วย channel/BSSID ที่จำไว้ไม่ได้ภายในนี้ → scan ปกติ
+#endif
+
+// ---------- ลำดับ boot (ESP-NOW + control ขึ้นก่อน, cloud ตามมาใน background) ----------
+enum BootState : uint8_t {
+    BOOT_LOCAL = 0,    // ESP-NOW พร้อม, รอ Wi-Fi
+    BOOT_WIFI,         // Wi-Fi ต่อแล้ว รอ NTP
+    BOOT_AUTH,         // เวลา sync แล้ว รอ Firebase token
+    BOOT_READY,        // cloud พร้อม
+};
 
 class GatewayNetwork {
 private:
-    FirebaseData   fbdo;
     FirebaseAuth   auth;
     FirebaseConfig config;
-    CommandPacket  cmd;
+    BootCache      cache;
+
+    volatile BootState bootState = BOOT_LOCAL;
+    bool          wifiFast      = false;   // กำลังลอง fast connect
+    bool          timeRestored  = false;
+    bool          cachedToken   = false;   // auth ด้วย refresh token จาก NVS
+    unsigned long wifiStartMs   = 0;
+    unsigned long authStartMs   = 0;
+    unsigned long lastTimeSave  = 0;
+
+    // เวลาตั้งแต่ boot (ms) ของแต่ละขั้น (0 = ยังไม่ถึง)
+    uint32_t wifiMs  = 0;
+    uint32_t timeMs  = 0;
+    uint32_t cloudMs = 0;
+
+    static volatile bool& ntpSynced() {
+        static volatile bool s = false;
+        return s;
+    }
+
+    static void onTimeSync(struct timeval*) { ntpSynced() = true; }
+
+    // boot → คำสั่งแรกที่ส่งออกไป (ms, 0 = ยังไม่มี)
+    static uint32_t& firstCommandMs() {
+        static uint32_t t = 0;
+        return t;
+    }
+
+    // task ที่ต้องปลุกเมื่อมี packet เข้า (control task)
+    static TaskHandle_t& wakeTask() {
+        static TaskHandle_t t = nullptr;
+        return t;
+    }
+
+    // packet เข้า → OFF ถูกส่ง (fast path)
+    static LatencyStat& safetyLatency() {
+        static LatencyStat s;
+        return s;
+    }
+
+    // ---------- safety fast path (Wi-Fi task) ----------
+    // ไม่ปลอดภัย → ส่ง OFF ทันที ไม่ขึ้นกับ config/cloud, slow path มา reconcile + log ทีหลัง
+    static void safetyFastPath(int node, const SensorPacket &p, uint32_t rxUs) {
+        NodeSafety &ns = nodeTable.safety(node);
+        uint8_t reason = safetyEvaluate(p);
+
+        if (reason == SAFETY_OK) {
+            ns.latched = false;
+            return;
+        }
+
+        // ตัดไปแล้วและเครื่องรายงานว่าปิดอยู่ → ไม่ต้องส่งซ้ำ
+        if (ns.latched && !p.controlState) return;
+
+        nodeTable.link(node).beginCommand(false, micros());
+        if (!sendRaw(node, false)) return;
+
+        uint32_t dt = (uint32_t)(micros() - rxUs);
+        safetyLatency().add(dt);
+        ns.lastLatencyUs = dt;
+        ns.latched = true;
+        ns.pending.fetch_or(reason, std::memory_order_release);
+    }
+
+    // ส่ง CommandPacket จริง 1 frame (ผลตามมาทาง onSent)
+    static bool sendRaw(uint8_t node, bool state) {
+        if (firstCommandMs() == 0) firstCommandMs() = millis();
+        CommandPacket c;
+        memset(&c, 0, sizeof(c));
+        c.active = state;
+        esp_err_t err = esp_now_send(nodeTable.mac(node), (uint8_t*)&c, sizeof(c));
+        if (err != ESP_OK) {
+            nodeTable.link(node).onStatus(false, micros());   // ไม่มี callback ตามมา
+            Serial.printf("[GW] ESP-NOW send error #%u: %d\n", node, (int)err);
+            return false;
+        }
+        return true;
+    }
+
+    // send callback = MAC-layer ACK จาก node → ยืนยันคำสั่ง + วัด RTT
+    static void onSent(const uint8_t * mac, esp_now_send_status_t status) {
+        int node = nodeTable.find(mac);
+        if (node == NodeTable::NONE) return;
+
+        bool ok = (status == ESP_NOW_SEND_SUCCESS);
+        nodeTable.link(node).onStatus(ok, micros());
+
+        // FAIL → ปลุก control task ให้คำนวณ deadline retransmit ใหม่
+        if (!ok && wakeTask()) xTaskNotifyGive(wakeTask());
+    }
+
+    static bool addPeer(const uint8_t mac[6]) {
+        esp_now_peer_info_t peer = {};
+        memcpy(peer.peer_addr, mac, 6);
+        peer.channel = 0;
+        peer.encrypt = false;
+        return esp_now_add_peer(&peer) == ESP_OK;
+    }
 
     static void onRecv(const uint8_t * mac, const uint8_t * incoming, int len) {
+        uint32_t rxUs = micros();
         if (len == sizeof(SensorPacket)) {
-            memcpy(&currentSensorData, incoming, sizeof(SensorPacket));
-            isSensorDataNew = true;
+            int node = nodeTable.find(mac);
+            if (node == NodeTable::NONE) {
+                if (!NODE_AUTO_LEARN) return;
+                node = nodeTable.add(mac, false);
+                if (node == NodeTable::NONE) return;   // table เต็ม
+                addPeer(mac);
+                Serial.printf("[ESP-NOW] New node #%d %02X:%02X:%02X:%02X:%02X:%02X\n",
+                              node, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+            }
+
+            SensorPacket p;
+            memcpy(&p, incoming, sizeof(SensorPacket));
+            if (SAFETY_FAST_PATH) safetyFastPath(node, p, rxUs);
+            nodeTable.mailbox(node).publish(p);
+            if (wakeTask()) xTaskNotifyGive(wakeTask());
 
-            char keyChar = (currentSensorData.keyPress == 0) ? '-' : currentSensorData.keyPress;
+            char keyChar = (p.keyPress == 0) ? '-' : p.keyPress;
             Serial.printf(
-                "[Recv]  CTRL=%s | W=%d%%(%d) | T=%d | KEY='%c'\n",
-                currentSensorData.controlState ? "ON" : "OFF",
-                currentSensorData.waterPercent,
-                currentSensorData.waterRaw,
-                currentSensorData.tiltState,
+                "[Recv]  #%d CTRL=%s | W=%d%%(%d) | T=%d | KEY='%c'\n",
+                node,
+                p.controlState ? "ON" : "OFF",
+                p.waterPercent,
+                p.waterRaw,
+                p.tiltState,
                 keyChar
             );
         }
     }
 
-public:
-    void begin() {
-        WiFi.mode(WIFI_AP_STA);
-        WiFi.setSleep(false);
-        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-
-        Serial.print("[WiFi] Connecting");
-        while (WiFi.status() != WL_CONNECTED) {
-            Serial.print(".");
-            delay(300);
-        }
-        Serial.println("\n[WiFi] Connected ✔");
-        Serial.print("[WiFi] IP: "); Serial.println(WiFi.localIP());
-
-        // NTP
-        configTime(7 * 3600, 0, "pool.ntp.org");
-        while (time(nullptr) < 1000000000) {
-            Serial.print(".");
-            delay(300);
+    void startWifi() {
+        uint8_t ch, bssid[6];
+        wifiFast = cache.loadWifi(ch, bssid);
+        if (wifiFast) {
+            esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);   // ESP-NOW ใช้ได้ทันทีบน channel เดิม
+            WiFi.begin(WIFI_SSID, WIFI_PASSWORD, ch, bssid, true);
+        } else {
+            WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
         }
-        Serial.println("\n[Time] Synced");
+        wifiStartMs = millis();
+    }
 
-        // Firebase
+    void startFirebase() {
         config.api_key = FIREBASE_API_KEY;
         config.database_url = FIREBASE_DATABASE_URL;
         config.token_status_callback = tokenStatusCallback;
 
-        Firebase.signUp(&config, &auth, "", "");
+        // มี refresh token จาก boot ก่อน → ใช้ user เดิม (ไม่สร้าง anonymous user ใหม่ทุก boot)
+        char tok[BOOT_TOKEN_LEN];
+        cachedToken = cache.loadToken(tok, sizeof(tok));
+        if (cachedToken) {
+            Firebase.setIdToken(&config, "", 0, tok);     // expire 0 → lib refresh ทันที
+            Serial.println("[Boot] Firebase: reuse cached refresh token");
+        } else {
+            Firebase.signUp(&config, &auth, "", "");
+            Serial.println("[Boot] Firebase: anonymous sign-up");
+        }
         Firebase.begin(&config, &auth);
         Firebase.reconnectWiFi(true);
+        authStartMs = millis();
+    }
+
+public:
+    // ไม่ block: ESP-NOW + callback พร้อมเมื่อ return, Wi-Fi/NTP/Firebase ไปต่อใน service()
+    void begin() {
+        cache.begin();
+        timeRestored = cache.restoreTime();
+
+        WiFi.mode(WIFI_AP_STA);
+        WiFi.setSleep(false);   // modem sleep ทำให้ ESP-NOW จาก Sensor Node หลุด → ประหยัดด้วย DFS แทน (main.cpp)
+        startWifi();
+
+        // NTP ทำงานเองใน background
+        sntp_set_time_sync_notification_cb(onTimeSync);
+        configTime(7 * 3600, 0, "pool.ntp.org");
 
         // ESP-NOW
         if (esp_now_init() != ESP_OK) {
@@ -72,33 +219,146 @@ public:
             return;
         }
 
+        // node หลักใช้ path เดิม (index 0) + allow-list → ต้องลงทะเบียนก่อนเปิดรับ
+        nodeTable.add(SENSOR_NODE_MAC, true);
+#ifdef NODE_ALLOW_MACS
+        static const uint8_t allow[][6] = { NODE_ALLOW_MACS };
+        for (const uint8_t* m : allow) {
+            if (nodeTable.add(m, false) == NodeTable::NONE || !addPeer(m))
+                Serial.printf("[ESP-NOW] Allow-list node %02X:%02X:%02X:%02X:%02X:%02X not added\n",
+                              m[0], m[1], m[2], m[3], m[4], m[5]);
+        }
+#endif
         esp_now_register_recv_cb(onRecv);
+        esp_now_register_send_cb(onSent);
 
-        esp_now_peer_info_t peer = {};
-        memcpy(peer.peer_addr, SENSOR_NODE_MAC, 6);
-        peer.channel = 0;
-        peer.encrypt = false;
-
-        if (esp_now_add_peer(&peer) != ESP_OK) {
+        if (!addPeer(SENSOR_NODE_MAC)) {
             Serial.println("[ESP-NOW] Add peer failed");
         } else {
-            Serial.println("[Network] ESP-NOW Ready");
+            Serial.printf("[Network] ESP-NOW Ready (%lums, time %s)\n",
+                          millis(), timeRestored ? "from NVS" : "unknown");
+        }
+    }
+
+    // ---------- boot state machine (เรียกเป็นระยะจาก cloud task) ----------
+    void service() {
+        switch (bootState) {
+            case BOOT_LOCAL:
+                if (WiFi.status() == WL_CONNECTED) {
+                    wifiMs = millis();
+                    cache.saveWifi((uint8_t)WiFi.channel(), WiFi.BSSID());
+                    Serial.printf("[WiFi] Connected ✔ IP: %s ch=%d (%lums)\n",
+                                  WiFi.localIP().toString().c_str(), WiFi.channel(),
+                                  (unsigned long)wifiMs);
+                    bootState = BOOT_WIFI;
+                } else if (wifiFast && millis() - wifiStartMs > WIFI_FAST_CONNECT_MS) {
+                    Serial.println("[WiFi] Cached channel/BSSID failed, full scan");
+                    WiFi.disconnect();
+                    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+                    wifiFast = false;
+                    wifiStartMs = millis();
+                }
+                break;
+
+            case BOOT_WIFI:
+                if (ntpSynced()) {
+                    timeMs = millis();
+                    cache.saveTime(time(nullptr));
+                    lastTimeSave = millis();
+                    Serial.printf("[Time] Synced (%lums)\n", (unsigned long)timeMs);
+                    startFirebase();
+                    bootState = BOOT_AUTH;
+                }
+                break;
+
+            case BOOT_AUTH:
+                if (Firebase.ready()) {
+                    cloudMs = millis();
+                    cache.saveToken(Firebase.getRefreshToken().c_str());
+                    bootState = BOOT_READY;
+                    printBootTimes();
+                } else if (cachedToken && millis() - authStartMs > FIREBASE_AUTH_TIMEOUT_MS) {
+                    Serial.println("[Boot] Cached token rejected, signing up again");
+                    cache.clearToken();
+                    startFirebase();
+                }
+                break;
+
+            case BOOT_READY:
+                if (millis() - lastTimeSave > BOOT_TIME_SAVE_MS) {
+                    lastTimeSave = millis();
+                    cache.saveTime(time(nullptr));
+                }
+                break;
         }
     }
 
+    void printBootTimes() const {
+        Serial.printf("[Boot] first_cmd=%lums wifi=%lums ntp=%lums cloud_ready=%lums\n",
+                      (unsigned long)firstCommandMs(), (unsigned long)wifiMs,
+                      (unsigned long)timeMs, (unsigned long)cloudMs);
+    }
+
+    BootState bootStage()            const { return bootState;        }
+    uint32_t  timeToFirstCommandMs() const { return firstCommandMs(); }
+    uint32_t  timeToCloudReadyMs()   const { return cloudMs;          }
+    BootCache& bootCache()                 { return cache;            }
+
+    // NTP ตอบแล้ว (เวลาจาก NVS ตอน boot ไม่นับ — ใช้ตัดสิน schedule ไม่ได้)
+    bool      timeSynced()           const { return ntpSynced();      }
+
     // ตอนนี้ command เป็น control อย่างเดียวแล้ว
-    void send(bool state) {
-        cmd.active = state;
-        esp_err_t err = esp_now_send(SENSOR_NODE_MAC, (uint8_t*)&cmd, sizeof(cmd));
-        if (err != ESP_OK) {
-            Serial.printf("[GW] ESP-NOW send error: %d\n", (int)err);
+    // seq อยู่ฝั่ง gateway (CommandPacket บนสายยังเหมือนเดิม ให้ Sensor Node เดิมใช้ได้)
+    void send(uint8_t node, bool state) {
+        nodeTable.link(node).beginCommand(state, micros());
+        sendRaw(node, state);
+    }
+
+    // ส่งซ้ำคำสั่งที่ยังไม่ ack เมื่อครบ RTO (เรียกทุก tick ของ control)
+    void serviceRetransmits() {
+        uint32_t nowUs = micros();
+        uint8_t count = nodeTable.count();
+        for (uint8_t i = 0; i < count; i++) {
+            bool state;
+            if (nodeTable.link(i).retransmitDue(nowUs, state)) sendRaw(i, state);
         }
     }
 
-    FirebaseData* get() { return &fbdo; }
-    bool ok() { return Firebase.ready(); }
+    // เหลืออีกกี่ ms ถึง retransmit ที่ใกล้ที่สุด (cap ถ้าไม่มีค้าง)
+    unsigned long msUntilRetransmit(unsigned long cap) {
+        uint32_t nowUs = micros();
+        uint32_t best  = UINT32_MAX;
+        uint8_t count = nodeTable.count();
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t left = nodeTable.link(i).usUntilRetransmit(nowUs);
+            if (left < best) best = left;
+        }
+        if (best == UINT32_MAX) return cap;
+        unsigned long ms = (best + 999) / 1000;
+        return ms < cap ? ms : cap;
+    }
 
-    void log(const String& s) {
-        if (ok()) Firebase.RTDB.pushString(&fbdo, PATH_ERROR_LOG, s);
+    void printLinkStats() {
+        uint8_t count = nodeTable.count();
+        for (uint8_t i = 0; i < count; i++) {
+            CommandLink &l = nodeTable.link(i);
+            LinkStats st = l.stats();
+            Serial.printf("[Link] #%u seq=%u srtt=%luus rto=%luus rtt=[%lu..%lu]us sent=%lu ack=%lu fail=%lu rtx=%lu gaveup=%lu loss=%lu.%lu%%\n",
+                          i, l.lastSeq(),
+                          (unsigned long)l.srttUs(), (unsigned long)l.rtoUs(),
+                          (unsigned long)st.rttMinUs, (unsigned long)st.rttMaxUs,
+                          (unsigned long)st.sent, (unsigned long)st.acked,
+                          (unsigned long)st.failed, (unsigned long)st.retransmits,
+                          (unsigned long)st.gaveUp,
+                          (unsigned long)(l.lossPermille() / 10),
+                          (unsigned long)(l.lossPermille() % 10));
+        }
     }
+
+    void setWakeTask(TaskHandle_t t) { wakeTask() = t; }
+
+    const LatencyStat& safetyFastLatency() const { return safetyLatency(); }
+
+    // RtdbClient อยู่ใน CloudTask (ใช้จาก task เดียว)
+    bool ok() { return bootState == BOOT_READY && Firebase.ready(); }
 };
@@ -0,0 +1,80 @@
+#pragma once
+#include <Arduino.h>
+#include "constant.h"
+#include "spsc_ring.h"
+#include "node_table.h"
+
+#ifndef LAN_FEED_DEPTH
+#define LAN_FEED_DEPTH 32              // ต้องเป็นกำลังสอง
+#endif
+
+// ---------- event 1 รายการที่ control task ส่งให้ LAN server (ไม่มี heap) ----------
+struct LanEvent {
+    enum Kind : uint8_t { L_SENSOR, L_ENV, L_STATE, L_CONFIG };
+
+    Kind    kind;
+    uint8_t node;
+    union {
+        SensorPacket pkt;
+        struct { float temp, hum; }             env;
+        struct { bool cmd, fb; }                state;
+        struct { uint8_t mode; bool manual; int16_t target; } cfg;
+    };
+};
+
+// ---------- control path → LAN task ----------
+// producer = control task (ค่าที่ update() เห็น/ตัดสินจริง), consumer = LanServer
+// เต็ม = ทิ้ง event ใหม่ (LAN เป็น best effort, cloud ยังได้ครบทาง outbox)
+class LanFeed {
+private:
+    SpscRing<LanEvent, LAN_FEED_DEPTH> ring;
+    TaskHandle_t consumer = nullptr;
+    uint8_t  lastState[GATEWAY_MAX_NODES];   // bit0 cmd, bit1 fb, 0xFF = ยังไม่เคยส่ง
+    uint32_t dropped = 0;
+
+    void push(const LanEvent &e) {
+        if (!ring.push(e)) dropped++;
+    }
+
+public:
+    LanFeed() { memset(lastState, 0xFF, sizeof(lastState)); }
+
+    void setConsumer(TaskHandle_t t) { consumer = t; }
+
+    // ---------- producer (control task) ----------
+    void sensor(uint8_t node, const SensorPacket &p) {
+        LanEvent e; e.kind = LanEvent::L_SENSOR; e.node = node; e.pkt = p;
+        push(e);
+    }
+
+    void env(float temp, float hum) {
+        LanEvent e; e.kind = LanEvent::L_ENV; e.node = 0; e.env.temp = temp; e.env.hum = hum;
+        push(e);
+    }
+
+    // ส่งเฉพาะตอน cmd/feedback ของ node เปลี่ยน
+    void state(uint8_t node, bool cmd, bool fb) {
+        if (node >= GATEWAY_MAX_NODES) return;
+        uint8_t bits = (cmd ? 1 : 0) | (fb ? 2 : 0);
+        if (lastState[node] == bits) return;
+        lastState[node] = bits;
+        LanEvent e; e.kind = LanEvent::L_STATE; e.node = node; e.state.cmd = cmd; e.state.fb = fb;
+        push(e);
+    }
+
+    void config(uint8_t mode, bool manual, int target) {
+        LanEvent e; e.kind = LanEvent::L_CONFIG; e.node = 0;
+        e.cfg.mode = mode; e.cfg.manual = manual; e.cfg.target = (int16_t)target;
+        push(e);
+    }
+
+    // จบ tick → ปลุก LAN task (เหมือน RtdbOutbox::commit)
+    void commit() {
+        if (consumer && !ring.empty()) xTaskNotifyGive(consumer);
+    }
+
+    // ---------- consumer (LAN task) ----------
+    bool pop(LanEvent &e) { return ring.pop(e); }
+
+    uint32_t dropCount() const { return dropped; }
+};
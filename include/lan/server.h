@@ -0,0 +1,436 @@
+#pragma once
+#include <Arduino.h>
+#include <stdarg.h>
+#include <WiFi.h>
+#include <WebSocketsServer.h>
+#include "constant.h"
+#include "spsc_ring.h"
+#include "node_table.h"
+#include "lan/feed.h"
+#include "control/config_stream.h"
+
+// ---------- WebSocket บน LAN: dashboard ในวง Wi-Fi เดียวกันคุยกับ gateway ตรง ----------
+// ออก: snapshot ตอนต่อ + delta ของ sensor / env / state / config ทันทีที่ control เห็น
+// เข้า: {"auth":"<LAN_TOKEN>"} ครั้งแรกของ connection แล้วค่อย
+//       {"mode":"auto"} {"manual":true} {"target":55} (รวมใน message เดียวได้ รวม auth ด้วย)
+//       → ConfigStream ทันที (ปลุก control) แล้ว cloud task sync ขึ้น RTDB ทีหลัง
+// ทุก client มีคิวส่งของตัวเองขนาดคงที่: เต็มแล้วทิ้งเก่าสุด → client ช้าไม่ถ่วงคนอื่น
+// snapshot ตอนต่อไม่ผ่านคิว: มี cursor ของตัวเอง ประกอบจากค่าล่าสุดตอนส่ง (ไม่โดนทิ้ง)
+#ifndef LAN_SERVER_ENABLE
+#define LAN_SERVER_ENABLE 1
+#endif
+
+// shared secret ของคำสั่ง (ws:// ไม่เข้ารหัส → กันแค่เครื่องอื่นใน LAN ที่ไม่รู้ token)
+// ว่าง = รับคำสั่งไม่ได้เลย (feed อ่านอย่างเดียว) → ต้องตั้งเองถึงจะสั่งจาก LAN ได้
+#ifndef LAN_TOKEN
+#define LAN_TOKEN ""
+#endif
+
+#ifndef LAN_WS_PORT
+#define LAN_WS_PORT 81
+#endif
+
+#ifndef LAN_MAX_CLIENTS
+#define LAN_MAX_CLIENTS WEBSOCKETS_SERVER_CLIENT_MAX
+#endif
+
+#ifndef LAN_CLIENT_QUEUE
+#define LAN_CLIENT_QUEUE 16            // ต้องเป็นกำลังสอง
+#endif
+
+#ifndef LAN_MSG_LEN
+#define LAN_MSG_LEN 128
+#endif
+
+#ifndef LAN_SEND_BUDGET
+#define LAN_SEND_BUDGET 4              // message ต่อ client ต่อรอบ (กัน client เดียวกิน loop)
+#endif
+
+#ifndef LAN_TASK_CORE
+#define LAN_TASK_CORE 0
+#endif
+
+#ifndef LAN_TASK_PRIO
+#define LAN_TASK_PRIO 1
+#endif
+
+#ifndef LAN_TASK_STACK
+#define LAN_TASK_STACK 6144
+#endif
+
+#ifndef LAN_TASK_IDLE_MS
+#define LAN_TASK_IDLE_MS 20            // ws.loop() อย่างน้อยทุกเท่านี้ (accept / ping / rx)
+#endif
+
+struct LanMsg {
+    uint16_t len;
+    char     text[LAN_MSG_LEN];
+};
+
+// ---------- ประกอบ JSON แบบไม่มี heap ----------
+class LanJson {
+private:
+    LanMsg &m;
+    bool    first = true;
+
+    void add(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (m.len >= sizeof(m.text)) return;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(m.text + m.len, sizeof(m.text) - m.len, fmt, ap);
+        va_end(ap);
+        m.len = (n < 0 || m.len + (size_t)n >= sizeof(m.text)) ? sizeof(m.text) : m.len + n;
+    }
+
+    void key(const char* k) {
+        add("%s\"%s\":", first ? "" : ",", k);
+        first = false;
+    }
+
+public:
+    LanJson(LanMsg &msg, const char* type) : m(msg) {
+        m.len = 0;
+        add("{\"t\":\"%s\"", type);
+        first = false;
+    }
+
+    void num(const char* k, int v)     { key(k); add("%d", v); }
+    void real(const char* k, float v)  { key(k); if (isnan(v)) add("null"); else add("%.1f", v); }
+    void flag(const char* k, bool v)   { key(k); add(v ? "true" : "false"); }
+    void str(const char* k, const char* v) { key(k); add("\"%s\"", v); }
+
+    // false = ล้น buffer (ไม่ส่ง)
+    bool end() {
+        add("}");
+        return m.len < sizeof(m.text);
+    }
+};
+
+// ค่าของ key ใน JSON object ชั้นเดียว (ชี้ตัวแรกหลัง ':') หรือ nullptr
+inline const char* lanJsonValue(const char* s, const char* key) {
+    size_t n = strlen(key);
+    for (const char* p = strchr(s, '"'); p; p = strchr(p + 1, '"')) {
+        if (strncmp(p + 1, key, n) != 0 || p[n + 1] != '"') continue;
+        const char* v = p + n + 2;
+        while (*v == ' ') v++;
+        if (*v != ':') continue;
+        v++;
+        while (*v == ' ') v++;
+        return v;
+    }
+    return nullptr;
+}
+
+class LanServer {
+private:
+    struct LanClient {
+        bool     on     = false;
+        bool     authed = false;
+        uint8_t  snap   = 0;           // ลำดับถัดไปของ snapshot (SNAP_DONE = ส่งครบแล้ว)
+        SpscRing<LanMsg, LAN_CLIENT_QUEUE> q;
+        uint32_t drops = 0;
+    };
+
+    // snapshot: config, env, แล้ว sensor + state ของแต่ละ node
+    static const uint8_t SNAP_DONE = 2 + 2 * GATEWAY_MAX_NODES;
+    static_assert(2 + 2 * GATEWAY_MAX_NODES <= 255, "snapshot cursor is uint8_t");
+
+    WebSocketsServer ws{LAN_WS_PORT};
+    LanFeed          in;
+    ConfigStream*    cfg;
+    TaskHandle_t     handle  = nullptr;
+    bool             started = false;
+    LanClient        clients[LAN_MAX_CLIENTS];
+
+    // ---------- ค่าล่าสุดที่ broadcast ไปแล้ว (snapshot ให้ client ใหม่ + ฐานของ delta) ----------
+    SensorPacket  sensor[GATEWAY_MAX_NODES];
+    uint8_t       state[GATEWAY_MAX_NODES];    // bit0 cmd, bit1 fb, 0xFF = ยังไม่มี
+    bool          hasSensor[GATEWAY_MAX_NODES] = {};
+    float         temp = NAN, hum = NAN;
+    LanEvent      cfgLast;
+    bool          hasCfg = false;
+
+    // ---------- stats ----------
+    uint32_t sent      = 0;
+    uint32_t drops     = 0;
+    uint32_t commands  = 0;
+    uint32_t rejected  = 0;
+    uint32_t authFail  = 0;
+
+    static void taskEntry(void* arg) {
+        static_cast<LanServer*>(arg)->run();
+    }
+
+    void run() {
+        Serial.printf("[LAN] Task Running on CORE %d\n", LAN_TASK_CORE);
+        while (true) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LAN_TASK_IDLE_MS));
+            step();
+        }
+    }
+
+    void step() {
+        if (!started) {
+            if (WiFi.status() != WL_CONNECTED) return;
+            ws.onEvent([this](uint8_t num, WStype_t type, uint8_t* payload, size_t len) {
+                onEvent(num, type, payload, len);
+            });
+            ws.begin();
+            started = true;
+            Serial.printf("[LAN] ws://%s:%u\n", WiFi.localIP().toString().c_str(), (unsigned)LAN_WS_PORT);
+        }
+
+        ws.loop();
+
+        LanEvent e;
+        LanMsg   m;
+        while (in.pop(e)) {
+            if (format(e, m, false)) broadcast(m);
+        }
+
+        // snapshot ก่อน แล้วค่อยคิว (delta ที่มาระหว่าง snapshot ส่งตามหลัง)
+        for (uint8_t i = 0; i < LAN_MAX_CLIENTS; i++) {
+            LanClient &c = clients[i];
+            for (int k = 0; c.on && k < LAN_SEND_BUDGET; k++) {
+                if (!nextSnapshot(c, m) && !c.q.pop(m)) break;
+                if (ws.sendTXT(i, (uint8_t*)m.text, m.len)) sent++;
+            }
+        }
+    }
+
+    // ---------- event → JSON (full = snapshot ทั้งก้อน, ไม่งั้นเฉพาะ field ที่เปลี่ยน) ----------
+    bool format(const LanEvent &e, LanMsg &m, bool full) {
+        switch (e.kind) {
+            case LanEvent::L_SENSOR: {
+                if (e.node >= GATEWAY_MAX_NODES) return false;
+                const SensorPacket &p = e.pkt;
+                const SensorPacket &o = sensor[e.node];
+                bool all = full || !hasSensor[e.node];
+                bool any = all;
+                LanJson j(m, "sensor");
+                j.num("node", e.node);
+                if (all || p.waterPercent != o.waterPercent) { j.num("water", p.waterPercent);  any = true; }
+                if (all || p.waterRaw != o.waterRaw)         { j.num("raw", p.waterRaw);        any = true; }
+                if (all || p.tiltState != o.tiltState)       { j.num("tilt", p.tiltState);      any = true; }
+                if (all || p.controlState != o.controlState) { j.flag("ctrl", p.controlState);  any = true; }
+                if (all || p.keyPress != o.keyPress)         { j.num("key", (int)p.keyPress);   any = true; }
+                sensor[e.node]    = p;
+                hasSensor[e.node] = true;
+                return any && j.end();
+            }
+            case LanEvent::L_ENV: {
+                bool dt = full || isnan(temp) || lroundf(e.env.temp * 10) != lroundf(temp * 10);
+                bool dh = full || isnan(hum)  || lroundf(e.env.hum * 10)  != lroundf(hum * 10);
+                temp = e.env.temp;
+                hum  = e.env.hum;
+                if (!dt && !dh) return false;
+                LanJson j(m, "env");
+                if (dt) j.real("temp", temp);
+                if (dh) j.real("hum", hum);
+                return j.end();
+            }
+            case LanEvent::L_STATE: {
+                if (e.node >= GATEWAY_MAX_NODES) return false;
+                state[e.node] = (e.state.cmd ? 1 : 0) | (e.state.fb ? 2 : 0);
+                LanJson j(m, "state");
+                j.num("node", e.node);
+                j.flag("cmd", e.state.cmd);
+                j.flag("fb", e.state.fb);
+                return j.end();
+            }
+            case LanEvent::L_CONFIG: {
+                cfgLast = e;
+                hasCfg  = true;
+                LanJson j(m, "config");
+                j.str("mode", controlModeText((ControlMode)e.cfg.mode));
+                j.flag("manual", e.cfg.manual);
+                j.num("target", e.cfg.target);
+                return j.end();
+            }
+        }
+        return false;
+    }
+
+    // ---------- per-client queue: เต็ม → ทิ้งเก่าสุด ----------
+    void enqueue(uint8_t num, const LanMsg &m) {
+        LanClient &c = clients[num];
+        if (!c.on) return;
+        if (!c.q.push(m)) {
+            LanMsg old;
+            c.q.pop(old);
+            c.q.push(m);
+            c.drops++;
+            drops++;
+        }
+    }
+
+    void broadcast(const LanMsg &m) {
+        for (uint8_t i = 0; i < LAN_MAX_CLIENTS; i++) enqueue(i, m);
+    }
+
+    // message ถัดไปของ snapshot ตาม cursor ของ client (false = ครบแล้ว)
+    bool nextSnapshot(LanClient &c, LanMsg &m) {
+        LanEvent e;
+        while (c.snap < SNAP_DONE) {
+            uint8_t i = c.snap++;
+            if (i == 0) {
+                if (hasCfg && format(cfgLast, m, true)) return true;
+            } else if (i == 1) {
+                if (isnan(temp)) continue;
+                e.kind = LanEvent::L_ENV; e.node = 0; e.env.temp = temp; e.env.hum = hum;
+                if (format(e, m, true)) return true;
+            } else {
+                uint8_t n = (i - 2) / 2;
+                if ((i & 1) == 0) {
+                    if (!hasSensor[n]) continue;
+                    e.kind = LanEvent::L_SENSOR; e.node = n; e.pkt = sensor[n];
+                } else {
+                    if (state[n] == 0xFF) continue;
+                    e.kind = LanEvent::L_STATE; e.node = n;
+                    e.state.cmd = state[n] & 1; e.state.fb = (state[n] & 2) != 0;
+                }
+                if (format(e, m, true)) return true;
+            }
+        }
+        return false;
+    }
+
+    // เทียบ token แบบใช้เวลาเท่ากันทุกตัวอักษร (ไม่บอกว่าผิดที่ตำแหน่งไหน)
+    static bool tokenMatches(const char* v) {
+        static const char token[] = LAN_TOKEN;
+        const size_t n = sizeof(token) - 1;
+        if (n == 0 || *v != '"') return false;
+        v++;
+        uint8_t diff = 0;
+        size_t  i = 0;
+        for (; i < n && v[i] && v[i] != '"'; i++) diff |= (uint8_t)(v[i] ^ token[i]);
+        return diff == 0 && i == n && v[i] == '"';
+    }
+
+    void reply(uint8_t num, bool ok, const char* why) {
+        LanMsg m;
+        LanJson j(m, "ack");
+        j.flag("ok", ok);
+        if (why) j.str("error", why);
+        if (j.end()) enqueue(num, m);
+    }
+
+    // ---------- คำสั่งจาก client → ConfigStream (แก้เฉพาะ field ที่ส่งมา) ----------
+    void handleCommand(uint8_t num, const uint8_t* payload, size_t len) {
+        char buf[LAN_MSG_LEN];
+        if (len >= sizeof(buf)) {
+            rejected++;
+            reply(num, false, "too long");
+            return;
+        }
+        memcpy(buf, payload, len);
+        buf[len] = '\0';
+
+        LanClient &c = clients[num];
+        bool authMsg = false;
+        if (const char* v = lanJsonValue(buf, "auth")) {
+            if (!tokenMatches(v)) {
+                authFail++;
+                reply(num, false, "auth");
+                ws.disconnect(num);        // เดา token ได้ทีละ connection
+                return;
+            }
+            c.authed = true;
+            authMsg  = true;
+        }
+        if (!c.authed) {
+            rejected++;
+            reply(num, false, sizeof(LAN_TOKEN) > 1 ? "unauthorized" : "read-only");
+            return;
+        }
+
+        uint8_t     fields = 0;
+        ControlMode mode   = MODE_UNKNOWN;
+        bool        manual = false;
+        int         target = 0;
+
+        if (const char* v = lanJsonValue(buf, "mode")) {
+            if      (strncmp(v, "\"manual\"", 8) == 0) mode = MODE_MANUAL;
+            else if (strncmp(v, "\"auto\"", 6) == 0)   mode = MODE_AUTO;
+            else { rejected++; reply(num, false, "mode"); return; }
+            fields |= ConfigStream::LOCAL_MODE;
+        }
+        if (const char* v = lanJsonValue(buf, "manual")) {
+            if      (strncmp(v, "true", 4) == 0)  manual = true;
+            else if (strncmp(v, "false", 5) == 0) manual = false;
+            else { rejected++; reply(num, false, "manual"); return; }
+            fields |= ConfigStream::LOCAL_MANUAL;
+        }
+        if (const char* v = lanJsonValue(buf, "target")) {
+            char* end;
+            long t = strtol(v, &end, 10);
+            if (end == v || t < 0 || t > 100) { rejected++; reply(num, false, "target"); return; }
+            target = (int)t;
+            fields |= ConfigStream::LOCAL_TARGET;
+        }
+        if (!fields) {
+            if (authMsg) { reply(num, true, nullptr); return; }
+            rejected++;
+            reply(num, false, "no field");
+            return;
+        }
+
+        commands++;
+        cfg->applyLocal(fields, mode, manual, target);
+        reply(num, true, nullptr);
+    }
+
+    void onEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t len) {
+        if (num >= LAN_MAX_CLIENTS) return;
+        LanClient &c = clients[num];
+        switch (type) {
+            case WStype_CONNECTED: {
+                LanMsg m;
+                while (c.q.pop(m)) {}
+                c.on     = true;
+                c.authed = false;
+                c.snap   = 0;
+                Serial.printf("[LAN] client %u connected\n", num);
+                break;
+            }
+            case WStype_DISCONNECTED:
+                c.on     = false;
+                c.authed = false;
+                Serial.printf("[LAN] client %u disconnected\n", num);
+                break;
+            case WStype_TEXT:
+                handleCommand(num, payload, len);
+                break;
+            default:
+                break;
+        }
+    }
+
+public:
+    explicit LanServer(ConfigStream* c) : cfg(c) {
+        memset(state, 0xFF, sizeof(state));
+    }
+
+    void begin() {
+        if (!LAN_SERVER_ENABLE) return;
+        xTaskCreatePinnedToCore(
+            taskEntry, "LanTask", LAN_TASK_STACK,
+            this, LAN_TASK_PRIO, &handle, LAN_TASK_CORE
+        );
+        in.setConsumer(handle);
+    }
+
+    // control task เขียนที่นี่ (ดู ControlLogic::setLan)
+    LanFeed& feed() { return in; }
+
+    void printStats() const {
+        if (!LAN_SERVER_ENABLE) return;
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < LAN_MAX_CLIENTS; i++) n += clients[i].on ? 1 : 0;
+        Serial.printf("[LAN] clients=%u sent=%lu drop=%lu feed_drop=%lu cmd=%lu rejected=%lu auth_fail=%lu%s\n",
+                      n, (unsigned long)sent, (unsigned long)drops,
+                      (unsigned long)in.dropCount(),
+                      (unsigned long)commands, (unsigned long)rejected,
+                      (unsigned long)authFail, sizeof(LAN_TOKEN) > 1 ? "" : " (read-only)");
+    }
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// ---------- สถิติ latency แบบเบา ๆ (count / avg / max / ล่าสุด) ----------
+struct LatencyStat {
+    uint32_t count  = 0;
+    uint32_t lastUs = 0;
+    uint32_t maxUs  = 0;
+    uint64_t sumUs  = 0;
+
+    void add(uint32_t us) {
+        count++;
+        lastUs = us;
+        sumUs += us;
+        if (us > maxUs) maxUs = us;
+    }
+
+    uint32_t avgUs() const { return count ? (uint32_t)(sumUs / count) : 0; }
+
+    void reset() { *this = LatencyStat(); }
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+#include <stdarg.h>
+
+#define GW_LOG_BUF 192
+
+// printf ลง Serial ผ่าน buffer บน stack
+// (HardwareSerial::printf จะ malloc เมื่อข้อความยาวเกิน 64 byte)
+inline void gwPrintf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+inline void gwPrintf(const char* fmt, ...) {
+    char buf[GW_LOG_BUF];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n <= 0) return;
+    if (n >= (int)sizeof(buf)) n = sizeof(buf) - 1;
+    Serial.write((const uint8_t*)buf, n);
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "constant.h"
+#include "sensor/mailbox.h"
+#include "sensor/telemetry.h"
+#include "control/safety.h"
+#include "command_link.h"
+
+#ifndef GATEWAY_MAX_NODES
+#define GATEWAY_MAX_NODES 20
+#endif
+
+// node ใหม่ที่ส่ง SensorPacket มา → รับเข้า table อัตโนมัติ
+// ปิดไว้: ESP-NOW ไม่เข้ารหัส ใครก็ส่ง packet ขนาดถูกมาจอง slot / รับคำสั่งได้
+// ใช้ NODE_ALLOW_MACS แทน หรือเปิดชั่วคราวตอนติดตั้งเท่านั้น
+#ifndef NODE_AUTO_LEARN
+#define NODE_AUTO_LEARN 0
+#endif
+
+// node ที่รับได้นอกจาก SENSOR_NODE_MAC (ลงทะเบียนตอน begin) เช่น
+//   -DNODE_ALLOW_MACS="{0x24,0x6F,0x28,0x01,0x02,0x03},{0x24,0x6F,0x28,0x01,0x02,0x04}"
+
+// RTDB path ของ node อื่นนอกจากตัวหลัก: NODE_PATH_ROOT/<mac>/sensor/...
+#ifndef NODE_PATH_ROOT
+#define NODE_PATH_ROOT "/nodes"
+#endif
+
+#define NODE_PREFIX_LEN 24
+
+// ---------- state ต่อ node ที่ ControlLogic ใช้ทุก tick ----------
+struct NodeControl {
+    bool          lastCmd        = false;  // คำสั่งล่าสุดที่ส่งไป
+    bool          lastFb         = false;  // controlState ล่าสุดที่เขียนขึ้น RTDB
+    uint8_t       mismatchCount  = 0;
+    bool          hasLastSensor  = false;
+    bool          resync         = false;  // มีค่าที่เก็บลง history ตอน offline → push ใหม่เมื่อ online
+    unsigned long lastFbTime     = 0;
+    SensorPacket  lastSensor{};
+    SensorSchema::State tlm;               // ค่าที่ส่งล่าสุดต่อ field (dirty / heartbeat)
+};
+
+// ---------- fast-path safety ต่อ node (เขียนจาก Wi-Fi task) ----------
+struct NodeSafety {
+    std::atomic<uint8_t> pending{0};   // reason ที่ fast path ตัด OFF แล้ว รอ slow path reconcile
+    bool                 latched = false;
+    uint32_t             lastLatencyUs = 0;
+};
+
+// ---------- fixed-capacity node table (key = MAC) ----------
+// แยก array ตามการใช้งาน: key สำหรับ lookup ใน onRecv, control state สำหรับ loop
+// writer (add) มีแค่ setup กับ Wi-Fi task, slot ถูกเติมให้ครบก่อน publish count
+class NodeTable {
+private:
+    uint64_t      keys[GATEWAY_MAX_NODES];
+    uint8_t       macs[GATEWAY_MAX_NODES][6];
+    SensorMailbox boxes[GATEWAY_MAX_NODES];
+    NodeControl   ctl[GATEWAY_MAX_NODES];
+    NodeSafety    safe[GATEWAY_MAX_NODES];
+    CommandLink   links[GATEWAY_MAX_NODES];
+    char          prefix[GATEWAY_MAX_NODES][NODE_PREFIX_LEN];
+
+    std::atomic<uint8_t> n{0};
+    uint32_t rejected = 0;   // table เต็ม
+
+    static uint64_t keyOf(const uint8_t mac[6]) {
+        uint64_t k = 0;
+        for (int i = 0; i < 6; i++) k = (k << 8) | mac[i];
+        return k;
+    }
+
+public:
+    static const int NONE = -1;
+
+    int find(const uint8_t mac[6]) const {
+        uint64_t k = keyOf(mac);
+        uint8_t cnt = n.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < cnt; i++) {
+            if (keys[i] == k) return i;
+        }
+        return NONE;
+    }
+
+    // legacyPaths = ใช้ PATH_* เดิมตรง ๆ (node หลัก / ระบบ 1 node)
+    int add(const uint8_t mac[6], bool legacyPaths) {
+        int found = find(mac);
+        if (found != NONE) return found;
+
+        uint8_t i = n.load(std::memory_order_relaxed);
+        if (i >= GATEWAY_MAX_NODES) {
+            rejected++;
+            return NONE;
+        }
+
+        keys[i] = keyOf(mac);
+        memcpy(macs[i], mac, 6);
+        ctl[i] = NodeControl();
+        safe[i].pending.store(0, std::memory_order_relaxed);
+        safe[i].latched = false;
+        links[i] = CommandLink();
+        if (legacyPaths) {
+            prefix[i][0] = '\0';
+        } else {
+            snprintf(prefix[i], NODE_PREFIX_LEN, "%s/%02x%02x%02x%02x%02x%02x",
+                     NODE_PATH_ROOT, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        }
+
+        n.store(i + 1, std::memory_order_release);
+        return i;
+    }
+
+    uint8_t count() const { return n.load(std::memory_order_acquire); }
+
+    SensorMailbox& mailbox(uint8_t i)          { return boxes[i]; }
+    NodeControl&   control(uint8_t i)          { return ctl[i];   }
+    const NodeControl& control(uint8_t i) const { return ctl[i];  }
+    NodeSafety&    safety(uint8_t i)           { return safe[i];  }
+    CommandLink&   link(uint8_t i)             { return links[i]; }
+    const uint8_t* mac(uint8_t i)        const { return macs[i];  }
+    const char*    pathPrefix(uint8_t i) const { return prefix[i]; }
+
+    uint32_t rejectedCount() const { return rejected; }
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ---------- DHT11/DHT22 pulse → reading (ไม่มี dependency กับ Arduino/IDF) ----------
+// input = ลำดับ level/ระยะเวลาที่จับได้ (RMT หรือ trace ที่บันทึกไว้)
+// bit = ช่วง HIGH หลัง LOW ~50us: ~26us = 0, ~70us = 1
+// 40 bit สุดท้ายของ trace คือข้อมูล (ก่อนหน้าอาจมี pull-up + response 80us)
+
+#ifndef DHT_BIT_THRESHOLD_US
+#define DHT_BIT_THRESHOLD_US 48
+#endif
+
+#define DHT_PULSE_MIN_US 10
+#define DHT_PULSE_MAX_US 100     // HIGH ยาวกว่านี้ = ไม่ใช่ bit (ท้าย trace = line idle)
+
+#define DHT_MODEL_11 11
+#define DHT_MODEL_22 22
+
+struct DhtEdge {
+    uint8_t  level;     // 0 = LOW, 1 = HIGH
+    uint16_t us;
+};
+
+struct DhtReading {
+    float temp = 0.0f;  // °C
+    float hum  = 0.0f;  // %RH
+};
+
+enum DhtStatus : uint8_t {
+    DHT_OK = 0,
+    DHT_ERR_SHORT,      // bit ไม่ครบ 40 (ไม่มี sensor / สายหลุด)
+    DHT_ERR_PULSE,      // ความกว้าง pulse ผิดสเปก
+    DHT_ERR_CHECKSUM,
+    DHT_ERR_RANGE,      // ค่าออกนอกช่วงของ sensor
+};
+
+inline const char* dhtStatusText(DhtStatus s) {
+    switch (s) {
+        case DHT_OK:           return "OK";
+        case DHT_ERR_SHORT:    return "SHORT";
+        case DHT_ERR_PULSE:    return "PULSE";
+        case DHT_ERR_CHECKSUM: return "CHECKSUM";
+        default:               return "RANGE";
+    }
+}
+
+// 5 byte → ค่า (ตรวจ checksum แล้ว)
+inline DhtStatus dhtConvert(const uint8_t b[5], int model, DhtReading &out) {
+    if ((uint8_t)(b[0] + b[1] + b[2] + b[3]) != b[4]) return DHT_ERR_CHECKSUM;
+
+    if (model == DHT_MODEL_22) {
+        out.hum  = ((b[0] << 8) | b[1]) * 0.1f;
+        out.temp = (((b[2] & 0x7F) << 8) | b[3]) * 0.1f;
+        if (b[2] & 0x80) out.temp = -out.temp;
+    } else {
+        out.hum  = b[0] + b[1] * 0.1f;
+        out.temp = b[2] + (b[3] & 0x7F) * 0.1f;
+        if (b[3] & 0x80) out.temp = -out.temp;
+    }
+
+    if (out.hum < 0.0f || out.hum > 100.0f || out.temp < -40.0f || out.temp > 80.0f)
+        return DHT_ERR_RANGE;
+    return DHT_OK;
+}
+
+inline DhtStatus dhtDecode(const DhtEdge* e, size_t n, int model, DhtReading &out) {
+    // RMT อาจบันทึก HIGH ของ idle หลัง bit สุดท้ายไว้ด้วย (ยาวเท่า idle threshold) → ตัดทิ้ง
+    while (n > 0 && e[n - 1].level && e[n - 1].us > DHT_PULSE_MAX_US) n--;
+
+    // ช่วง HIGH 40 ตัวสุดท้าย (นับจากท้าย trace)
+    uint16_t highs[40];
+    int found = 0;
+    for (size_t i = n; i-- > 0 && found < 40;) {
+        if (e[i].level) highs[39 - found++] = e[i].us;
+    }
+    if (found < 40) return DHT_ERR_SHORT;
+
+    uint8_t b[5] = { 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 40; i++) {
+        uint16_t h = highs[i];
+        if (h < DHT_PULSE_MIN_US || h > DHT_PULSE_MAX_US) return DHT_ERR_PULSE;
+        b[i / 8] = (uint8_t)((b[i / 8] << 1) | (h > DHT_BIT_THRESHOLD_US ? 1 : 0));
+    }
+    return dhtConvert(b, model, out);
+}
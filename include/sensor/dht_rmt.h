@@ -0,0 +1,149 @@
+#pragma once
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include "sensor/dht_decoder.h"
+
+#ifndef DHT_RMT_CHANNEL
+#define DHT_RMT_CHANNEL RMT_CHANNEL_4
+#endif
+
+#define DHT_START_LOW_MS  20     // host ดึง LOW ≥ 18ms (DHT11)
+#define DHT_CAPTURE_MS    10     // response + 40 bit ใช้ ~5ms
+#define DHT_IDLE_US       200    // HIGH นานเท่านี้ = จบ frame
+#define DHT_MAX_EDGES     96
+
+// ---------- DHT ผ่าน RMT capture (ไม่ bit-bang, ไม่ปิด interrupt) ----------
+// ลำดับทั้งหมดวิ่งใน esp_timer task:
+//   start(): ดึง LOW → +20ms release + เริ่ม RMT rx → +10ms อ่าน ringbuffer, decode, publish
+// ผู้ใช้อ่านค่าล่าสุดผ่าน latest() (ไม่ต้อง poll sensor เอง)
+class DhtRmt {
+private:
+    gpio_num_t      pin;
+    int             model;
+    RingbufHandle_t rb = nullptr;
+    esp_timer_handle_t tRelease = nullptr;
+    esp_timer_handle_t tCollect = nullptr;
+    volatile bool   busy = false;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    DhtReading   last;
+    uint32_t     seq = 0;            // เพิ่มทุกครั้งที่มีค่าใหม่ที่ผ่าน checksum
+    TaskHandle_t wakeTask = nullptr; // ปลุกเมื่อมีค่าใหม่
+
+    // ---------- stats ----------
+    uint32_t okCount   = 0;
+    uint32_t errCount  = 0;
+    uint32_t busySkips = 0;          // รอบที่ conversion ก่อนหน้ายังไม่จบ
+    DhtStatus lastErr  = DHT_OK;
+
+    static void onRelease(void* arg) { static_cast<DhtRmt*>(arg)->release(); }
+    static void onCollect(void* arg) { static_cast<DhtRmt*>(arg)->collect(); }
+
+    void release() {
+        rmt_rx_start(DHT_RMT_CHANNEL, true);
+        gpio_set_level(pin, 1);                 // open-drain ปล่อย → sensor ตอบ
+        esp_timer_start_once(tCollect, DHT_CAPTURE_MS * 1000);
+    }
+
+    void collect() {
+        rmt_rx_stop(DHT_RMT_CHANNEL);
+
+        DhtEdge edges[DHT_MAX_EDGES];
+        size_t  n = 0;
+        size_t  len = 0;
+        rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(rb, &len, 0);
+        if (items) {
+            size_t count = len / sizeof(rmt_item32_t);
+            for (size_t i = 0; i < count && n + 2 <= DHT_MAX_EDGES; i++) {
+                if (items[i].duration0 == 0) break;
+                edges[n].level = items[i].level0;
+                edges[n].us    = items[i].duration0;
+                n++;
+                if (items[i].duration1 == 0) break;
+                edges[n].level = items[i].level1;
+                edges[n].us    = items[i].duration1;
+                n++;
+            }
+            vRingbufferReturnItem(rb, items);
+        }
+
+        DhtReading r;
+        DhtStatus st = dhtDecode(edges, n, model, r);
+        if (st == DHT_OK) {
+            portENTER_CRITICAL(&lock);
+            last = r;
+            seq++;
+            portEXIT_CRITICAL(&lock);
+            okCount++;
+            if (wakeTask) xTaskNotifyGive(wakeTask);
+        } else {
+            errCount++;
+            lastErr = st;
+        }
+        busy = false;
+    }
+
+public:
+    DhtRmt(uint8_t p, int m) : pin((gpio_num_t)p), model(m) {}
+
+    bool begin() {
+        // open-drain + pull-up: ขา output ดึง LOW ได้ และ RMT ยังเห็นสัญญาณทั้งสองทาง
+        gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+        gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+        gpio_set_level(pin, 1);
+
+        rmt_config_t cfg = RMT_DEFAULT_CONFIG_RX(pin, DHT_RMT_CHANNEL);
+        cfg.clk_div = 80;                          // 1 tick = 1us
+        cfg.mem_block_num = 2;
+        cfg.rx_config.filter_en = true;
+        cfg.rx_config.filter_ticks_thresh = 100;   // ตัด glitch < 1.25us (APB tick)
+        cfg.rx_config.idle_threshold = DHT_IDLE_US;
+        if (rmt_config(&cfg) != ESP_OK) return false;
+        if (rmt_driver_install(DHT_RMT_CHANNEL, 1024, 0) != ESP_OK) return false;
+        rmt_get_ringbuf_handle(DHT_RMT_CHANNEL, &rb);
+
+        // rmt_config ตั้งขาเป็น input → คืนเป็น open-drain
+        gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+
+        esp_timer_create_args_t a = {};
+        a.arg = this;
+        a.callback = onRelease;
+        a.name = "dht_rel";
+        esp_timer_create(&a, &tRelease);
+        a.callback = onCollect;
+        a.name = "dht_col";
+        esp_timer_create(&a, &tCollect);
+        return rb != nullptr;
+    }
+
+    // เริ่มอ่าน 1 ครั้ง (return ทันที ผลมาทาง latest())
+    bool start() {
+        if (!rb) return false;
+        if (busy) {
+            busySkips++;
+            return false;
+        }
+        busy = true;
+        gpio_set_level(pin, 0);
+        esp_timer_start_once(tRelease, DHT_START_LOW_MS * 1000);
+        return true;
+    }
+
+    // ค่าล่าสุดที่ผ่าน checksum → seq (0 = ยังไม่เคยได้)
+    uint32_t latest(DhtReading &out) {
+        portENTER_CRITICAL(&lock);
+        out = last;
+        uint32_t s = seq;
+        portEXIT_CRITICAL(&lock);
+        return s;
+    }
+
+    void setWakeTask(TaskHandle_t t) { wakeTask = t; }
+
+    uint32_t  okReads()     const { return okCount;   }
+    uint32_t  errors()      const { return errCount;  }
+    uint32_t  skipped()     const { return busySkips; }
+    DhtStatus lastError()   const { return lastErr;   }
+};
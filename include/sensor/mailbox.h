@@ -0,0 +1,79 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "constant.h"
+
+// ---------- SensorPacket 1 ชุด + metadata ตอนรับ ----------
+struct SensorSample {
+    SensorPacket pkt{};
+    uint32_t     seq      = 0;   // ลำดับ packet (เริ่ม 1, 0 = ยังไม่เคยได้)
+    uint32_t     rxMicros = 0;   // micros() ตอน onRecv
+};
+
+// ---------- seqlock mailbox: ESP-NOW callback → control loop ----------
+// writer (Wi-Fi task) ไม่มีวันรอ, reader retry จนได้ snapshot ที่ไม่ขาดกลาง
+// มี writer ได้ตัวเดียว
+class SensorMailbox {
+private:
+    std::atomic<uint32_t> lock{0};        // คี่ = กำลังเขียน
+    SensorSample          slot;
+
+    std::atomic<uint32_t> consumed{0};    // seq ล่าสุดที่ reader take() ไปแล้ว
+    std::atomic<uint32_t> overwritten{0}; // packet ที่ถูกทับก่อนมีคนอ่าน
+    uint32_t              maxAgeUs = 0;   // อายุ packet สูงสุดตอนถูก take()
+
+public:
+    // เรียกจาก onRecv เท่านั้น
+    void publish(const SensorPacket &p) {
+        uint32_t s = lock.load(std::memory_order_relaxed);
+        uint32_t prevSeq = s / 2;
+
+        if (prevSeq != 0 && consumed.load(std::memory_order_relaxed) != prevSeq) {
+            overwritten.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        lock.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.pkt      = p;
+        slot.seq      = prevSeq + 1;
+        slot.rxMicros = micros();
+
+        lock.store(s + 2, std::memory_order_release);
+    }
+
+    // copy ค่าล่าสุดแบบไม่ขาดกลาง (ไม่ mark ว่าอ่านแล้ว)
+    bool read(SensorSample &out) const {
+        uint32_t s1, s2 = 0;
+        do {
+            s1 = lock.load(std::memory_order_acquire);
+            if (s1 & 1) continue;
+            out = slot;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s2 = lock.load(std::memory_order_relaxed);
+        } while ((s1 & 1) || s1 != s2);
+        return out.seq != 0;
+    }
+
+    // เหมือน read() แต่ mark ว่า consume แล้ว คืน true ถ้าเป็น packet ใหม่
+    bool take(SensorSample &out) {
+        read(out);
+        if (out.seq == 0) return false;
+
+        uint32_t prev = consumed.exchange(out.seq, std::memory_order_relaxed);
+        if (prev == out.seq) return false;
+
+        uint32_t age = (uint32_t)(micros() - out.rxMicros);
+        if (age > maxAgeUs) maxAgeUs = age;
+        return true;
+    }
+
+    bool hasNew() const {
+        uint32_t s = lock.load(std::memory_order_acquire) / 2;
+        return s != 0 && s != consumed.load(std::memory_order_relaxed);
+    }
+
+    uint32_t received()         const { return lock.load(std::memory_order_relaxed) / 2; }
+    uint32_t overwrittenCount() const { return overwritten.load(std::memory_order_relaxed); }
+    uint32_t maxPacketAgeUs()   const { return maxAgeUs; }
+};
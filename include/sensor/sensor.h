@@ -1,75 +1,92 @@
 #pragma once
 #include <Arduino.h>
 #include <math.h>
-#include <DHT.h>
-#include <Firebase_ESP_Client.h>
 #include "constant.h"
+#include "cloud/outbox.h"
+#include "sensor/telemetry.h"
+#include "sensor/dht_rmt.h"
+#include "log.h"
+
+// DHT_TYPE ใน constant.h ใช้ชื่อเดียวกับ DHT library (DHT11 / DHT22)
+#ifndef DHT11
+#define DHT11 DHT_MODEL_11
+#endif
+#ifndef DHT22
+#define DHT22 DHT_MODEL_22
+#endif
 
 class EnvSensorService {
 private:
-    DHT dht;
+    DhtRmt dht;
     bool  ready        = false;
     float curTemp      = 0.0f;
     float curHum       = 0.0f;
+    uint32_t seenSeq   = 0;       // seq ของค่าที่ใช้ไปแล้ว
+    uint32_t seenErr   = 0;
+    bool  resync       = false;   // มี sample ที่ไม่ได้ขึ้น cloud (offline) → รอบ online ถัดไปส่งเต็มชุด
 
-    float lastTempSent = 0.0f;
-    float lastHumSent  = 0.0f;
-    bool  pushedOnce   = false;
-
-    unsigned long lastRead = 0;
-    unsigned long lastPush = 0;
+    EnvSchema::State tlm;     // deadband / heartbeat ตาม ENV_SCHEMA
 
 public:
     EnvSensorService() : dht(DHT_PIN, DHT_TYPE) {}
 
     void begin() {
-        dht.begin();
-        Serial.println("[Env] DHT11 init");
+        if (dht.begin()) Serial.println("[Env] DHT init (RMT capture)");
+        else             Serial.println("[Env] DHT RMT init failed");
     }
 
-    void update(FirebaseData* fb) {
-        // อ่านค่าทุก ENV_POLL_MS
-        if (millis() - lastRead < ENV_POLL_MS) return;
-        lastRead = millis();
+    void setWakeTask(TaskHandle_t t) { dht.setWakeTask(t); }
 
-        float h = dht.readHumidity();
-        float t = dht.readTemperature();
+    // เริ่ม conversion รอบใหม่ (รอบ ENV_POLL_MS คุมโดย timer ของ ControlLogic)
+    // return ทันที — ผลมาทีหลังผ่าน update()
+    void startRead() { dht.start(); }
 
-        if (isnan(h) || isnan(t)) {
-            Serial.println("[Env] DHT read failed");
-            return;
+    // ใช้ค่าใหม่ล่าสุด (ถ้ามี) ไม่ block, เรียกได้ทุก tick
+    // out = nullptr เมื่อ cloud offline → ไม่เข้า outbox (caller เก็บลง history แทน)
+    // คืน true ถ้ารอบนี้มีค่าใหม่ที่ต้องส่ง (online = push แล้ว, offline = ต้องเก็บ)
+    bool update(RtdbOutbox* out) {
+        if (dht.errors() != seenErr) {
+            seenErr = dht.errors();
+            gwPrintf("[Env] DHT read failed (%s)\n", dhtStatusText(dht.lastError()));
         }
 
+        DhtReading r;
+        uint32_t seq = dht.latest(r);
+        if (seq == seenSeq) return false;
+        seenSeq = seq;
+
         ready   = true;
-        curHum  = h;
-        curTemp = t;
+        curHum  = r.hum;
+        curTemp = r.temp;
 
-        bool push = false;
-        if (!pushedOnce) {
-            push = true;
+        EnvSample s = { curTemp, curHum };
+        uint32_t nowMs = millis();
+        uint32_t mask  = ENV_SCHEMA.dirty(tlm, s, nowMs);
+        if (mask && resync && out != nullptr) mask |= ENV_SCHEMA.refreshMask(s);
+        if (!mask) return false;
+
+        if (out != nullptr) {
+            out->setTelemetry(envTlmEmit, s, mask);
+            resync = false;
         } else {
-            if (fabsf(h - lastHumSent) >= 1.0f ||
-                fabsf(t - lastTempSent) >= 0.5f) {
-                push = true;
-            } else if (millis() - lastPush > SENSOR_PUSH_MS) {
-                push = true;
-            }
+            resync = true;
         }
+        ENV_SCHEMA.commit(tlm, s, mask, nowMs);
 
-        if (push && fb != nullptr) {
-            Firebase.RTDB.setFloat(fb, PATH_SENSOR_TEMP, curTemp);
-            Firebase.RTDB.setFloat(fb, PATH_SENSOR_HUMID, curHum);
-
-            lastTempSent = curTemp;
-            lastHumSent  = curHum;
-            lastPush     = millis();
-            pushedOnce   = true;
-
-            Serial.printf("[Env]  T=%.1f°C H=%.1f%%\n", curTemp, curHum);
-        }
+        gwPrintf("[Env]  T=%.1f°C H=%.1f%%\n", curTemp, curHum);
+        return true;
     }
 
     bool  isReady()     const { return ready;     }
+    uint32_t readings() const { return seenSeq;   }   // เพิ่มทุกค่าใหม่ที่ update() ใช้
     float getTemp()     const { return curTemp;   }
     float getHumidity() const { return curHum;    }
+
+    void printStats() const {
+        Serial.printf("[Env] dht ok=%lu err=%lu skip=%lu last=%s\n",
+                      (unsigned long)dht.okReads(),
+                      (unsigned long)dht.errors(),
+                      (unsigned long)dht.skipped(),
+                      dhtStatusText(dht.lastError()));
+    }
 };
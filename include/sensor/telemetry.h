@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include "constant.h"
+#include "cloud/schema.h"
+
+// ---------- schema ของ telemetry ที่ขึ้น RTDB ----------
+// เพิ่ม field = เพิ่ม 1 บรรทัดในตาราง (dirty / deadband / rate limit / serialize ตามมาเอง)
+
+inline const char* tiltText(uint8_t t) {
+    if (t == TILT_FALL)    return "FALL";
+    if (t == TILT_WARNING) return "WARN";
+    return "NORMAL";
+}
+
+inline const char* sensorTiltText(const SensorPacket& p) { return tiltText(p.tiltState); }
+
+// ---------- Sensor Node (SensorPacket) ----------
+static constexpr TlmField<SensorPacket> SENSOR_TLM_FIELDS[] = {
+    //        record        member        type      path                        deadband gap flags
+    TLM_FIELD(SensorPacket, waterPercent, TLM_INT,  PATH_SENSOR_WATER_PCT,      0.0f,    0,  TLM_NONE),
+    TLM_FIELD(SensorPacket, waterRaw,     TLM_INT,  PATH_SENSOR_WATER_RAW,      0.0f,    0,  TLM_NONE),
+    TLM_FIELD(SensorPacket, tiltState,    TLM_INT,  PATH_SENSOR_TILT_STATE,     0.0f,    0,  TLM_NONE),
+    TLM_TEXT_FIELD(SensorPacket, tiltState, PATH_SENSOR_TILT_STATE_TXT, &sensorTiltText),
+    TLM_FIELD(SensorPacket, controlState, TLM_BOOL, PATH_SENSOR_CONTROL_STATE,  0.0f,    0,  TLM_NONE),
+    TLM_FIELD(SensorPacket, keyPress,     TLM_CHAR, PATH_SENSOR_KEY_LAST,       0.0f,    0,  TLM_NONZERO | TLM_NO_REFRESH),
+};
+
+typedef TlmSchema<SensorPacket, TLM_COUNT(SENSOR_TLM_FIELDS)> SensorSchema;
+static constexpr SensorSchema SENSOR_SCHEMA(SENSOR_TLM_FIELDS, SENSOR_PUSH_MS);
+
+// ---------- DHT บน gateway ----------
+struct EnvSample {
+    float temp;
+    float hum;
+};
+
+static constexpr TlmField<EnvSample> ENV_TLM_FIELDS[] = {
+    TLM_FIELD(EnvSample, temp, TLM_FLOAT, PATH_SENSOR_TEMP,  0.5f, 0, TLM_NONE),
+    TLM_FIELD(EnvSample, hum,  TLM_FLOAT, PATH_SENSOR_HUMID, 1.0f, 0, TLM_NONE),
+};
+
+typedef TlmSchema<EnvSample, TLM_COUNT(ENV_TLM_FIELDS)> EnvSchema;
+static constexpr EnvSchema ENV_SCHEMA(ENV_TLM_FIELDS, SENSOR_PUSH_MS);
+
+// ---------- serializer สำหรับ outbox (record อยู่ใน RtdbWrite::str แบบ packed) ----------
+inline void sensorTlmEmit(TelemetrySink& b, const char* rec, uint32_t mask, const char* prefix) {
+    SensorPacket p;
+    memcpy(&p, rec, sizeof(p));
+    SENSOR_SCHEMA.emit(b, p, mask, prefix);
+}
+
+inline void envTlmEmit(TelemetrySink& b, const char* rec, uint32_t mask, const char* prefix) {
+    EnvSample s;
+    memcpy(&s, rec, sizeof(s));
+    ENV_SCHEMA.emit(b, s, mask, prefix);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ---------- lock-free ring: 1 producer / 1 consumer ----------
+// N ต้องเป็นกำลังสอง, ใช้ได้จริง N-1 ช่อง (ไม่ต้องมี flag แยกว่าเต็ม)
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+private:
+    T buf[N];
+    std::atomic<uint32_t> head{0};   // เขียนโดย producer
+    std::atomic<uint32_t> tail{0};   // เขียนโดย consumer
+
+public:
+    // producer side
+    bool push(const T& v) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t next = (h + 1) & (N - 1);
+        if (next == tail.load(std::memory_order_acquire)) return false;   // เต็ม
+        buf[h] = v;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    bool pop(T& out) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;      // ว่าง
+        out = buf[t];
+        tail.store((t + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    // ดูตัวหน้าสุดโดยไม่ถอดออก (consumer side)
+    const T* peek() const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return nullptr;
+        return &buf[t];
+    }
+
+    size_t size() const {
+        uint32_t h = head.load(std::memory_order_acquire);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        return (h - t) & (N - 1);
+    }
+
+    bool   empty()    const { return size() == 0; }
+    size_t capacity() const { return N - 1; }
+};
@@ -0,0 +1,138 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- เวลาแต่ละ stage ด้วย cycle counter + histogram log2 ----------
+// เปิดด้วย env:profile (-DSTAGE_PROFILE); build ปกติ STAGE_SCOPE หายไปทั้งหมด
+// วัดเป็น CPU cycle (CCOUNT) → แปลงเป็น us ตอนรายงานด้วย clock ปัจจุบัน
+// (เปิด DFS อยู่ค่า us เป็นค่าประมาณ แต่ cycle คืองานจริงของ CPU)
+
+#define STAGE_BUCKETS 32               // bucket b = [2^b, 2^(b+1)) cycle
+
+inline uint32_t stageCycles() {
+#if defined(__XTENSA__)
+    uint32_t c;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(c));
+    return c;
+#else
+    return (uint32_t)micros();         // host / stub: 1 "cycle" = 1us
+#endif
+}
+
+inline uint32_t stageCyclesPerUs() {
+#if defined(__XTENSA__)
+    uint32_t mhz = getCpuFrequencyMhz();
+    return mhz ? mhz : 1;
+#else
+    return 1;
+#endif
+}
+
+struct StageHist {
+    uint32_t bucket[STAGE_BUCKETS];
+    uint32_t count = 0;
+    uint32_t minC  = UINT32_MAX;
+    uint32_t maxC  = 0;
+    uint64_t sumC  = 0;
+
+    StageHist() { reset(); }
+
+    void reset() {
+        memset(bucket, 0, sizeof(bucket));
+        count = 0;
+        minC  = UINT32_MAX;
+        maxC  = 0;
+        sumC  = 0;
+    }
+
+    void add(uint32_t c) {
+        bucket[31 - __builtin_clz(c | 1)]++;
+        count++;
+        sumC += c;
+        if (c < minC) minC = c;
+        if (c > maxC) maxC = c;
+    }
+
+    uint32_t avg() const { return count ? (uint32_t)(sumC / count) : 0; }
+
+    // ขอบบนของ bucket ที่ครอบ percentile (ไม่เกิน max จริง)
+    uint32_t percentile(uint32_t permille) const {
+        if (count == 0) return 0;
+        uint32_t need = (uint32_t)(((uint64_t)count * permille + 999) / 1000);
+        uint32_t acc = 0;
+        for (int b = 0; b < STAGE_BUCKETS; b++) {
+            acc += bucket[b];
+            if (acc >= need) {
+                uint32_t hi = (b >= 31) ? UINT32_MAX : ((1u << (b + 1)) - 1);
+                return hi < maxC ? hi : maxC;
+            }
+        }
+        return maxC;
+    }
+};
+
+// RAII: วัดตั้งแต่สร้างจนออกจาก scope
+class StageScope {
+private:
+    StageHist &h;
+    uint32_t   start;
+
+public:
+    explicit StageScope(StageHist &hist) : h(hist), start(stageCycles()) {}
+    ~StageScope() { h.add(stageCycles() - start); }
+};
+
+// stage ต่อกันเป็นลำดับ: split() ปิด stage ก่อนหน้าและเริ่มตัวถัดไปในคราวเดียว
+// (ไม่ต้องครอบทุก stage ด้วย block)
+class StageLap {
+private:
+    uint32_t t;
+
+public:
+    StageLap() : t(stageCycles()) {}
+
+    void split(StageHist &h) {
+        uint32_t now = stageCycles();
+        h.add(now - t);
+        t = now;
+    }
+
+    void restart() { t = stageCycles(); }
+};
+
+#ifdef STAGE_PROFILE
+#define STAGE_SCOPE(prof, id)     StageScope stageScope_##id((prof)[id])
+#define STAGE_LAP_BEGIN(lap)      StageLap lap
+#define STAGE_LAP(lap, prof, id)  (lap).split((prof)[id])
+#define STAGE_LAP_SKIP(lap)       (lap).restart()
+#else
+#define STAGE_SCOPE(prof, id)     ((void)0)
+#define STAGE_LAP_BEGIN(lap)      ((void)0)
+#define STAGE_LAP(lap, prof, id)  ((void)0)
+#define STAGE_LAP_SKIP(lap)       ((void)0)
+#endif
+
+// สรุปต่อ stage (ns — stage เล็ก ๆ ใช้ไม่ถึง 1us) สำหรับส่งขึ้น RTDB เป็น 1 record
+struct StageSummary {
+    uint8_t  stage;
+    uint32_t n;
+    uint32_t minNs;
+    uint32_t avgNs;
+    uint32_t p99Ns;
+    uint32_t maxNs;
+};
+
+inline uint32_t stageCyclesToNs(uint32_t c) {
+    uint64_t ns = (uint64_t)c * 1000u / stageCyclesPerUs();
+    return ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+inline StageSummary stageSummarize(uint8_t id, const StageHist &h) {
+    StageSummary s;
+    s.stage = id;
+    s.n     = h.count;
+    s.minNs = h.count ? stageCyclesToNs(h.minC) : 0;
+    s.avgNs = stageCyclesToNs(h.avg());
+    s.p99Ns = stageCyclesToNs(h.percentile(990));
+    s.maxNs = stageCyclesToNs(h.maxC);
+    return s;
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include <Arduino.h>
+#include "latency_stat.h"
+#include "node_table.h"
+
+// ControlLogic จอง env / countdown / retransmit / stats (ControlTask พิมพ์ + upload profile)
+// + heartbeat / mismatch / sensor ต่อ node
+#ifndef TIMER_MAX_SLOTS
+#define TIMER_MAX_SLOTS (4 + 3 * GATEWAY_MAX_NODES)
+#endif
+
+static_assert(TIMER_MAX_SLOTS <= 255, "TimerService slot count is uint8_t");
+
+#ifndef TIMER_MAX_GROUPS
+#define TIMER_MAX_GROUPS 8
+#endif
+
+// ---------- deadline ของงาน periodic ทั้งหมดของ control task อยู่ที่เดียว ----------
+// slot = one-shot deadline (arm ใหม่เองหลังทำงาน), group = ชื่อ + สถิติ jitter ร่วมกัน
+// เวลาเก็บเป็น micros() 32-bit (deadline ต้องไม่เกิน ~35 นาที)
+// ใช้จาก task เดียว (control task) → ไม่มี lock
+class TimerService {
+private:
+    struct Slot {
+        uint32_t dueUs;
+        bool     armed;
+        uint8_t  group;
+    };
+
+    struct Group {
+        const char* name;
+        LatencyStat jitter;     // ช้ากว่า deadline เท่าไหร่ตอนถูกตรวจเจอ
+    };
+
+    Slot     slots[TIMER_MAX_SLOTS];
+    Group    groups[TIMER_MAX_GROUPS];
+    uint8_t  nSlots  = 0;
+    uint8_t  nGroups = 0;
+    uint8_t  dropped = 0;    // add() ที่ไม่ได้ slot (deadline นั้นจะไม่มีวัน expire)
+
+    // deadline ที่ใกล้สุด (cache จนกว่า slot นั้นจะหมด/ถูกยกเลิก)
+    bool     nextValid = true;
+    int      nextSlot  = -1;
+
+    // ---------- idle ของ task เจ้าของ ----------
+    uint32_t waitStartUs = 0;
+    uint32_t winStartUs  = 0;
+    uint32_t winIdleUs   = 0;
+    uint32_t idlePm      = 0;    // ต่อพันของหน้าต่างล่าสุด
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    void recompute() {
+        nextSlot = -1;
+        for (uint8_t i = 0; i < nSlots; i++) {
+            if (!slots[i].armed) continue;
+            if (nextSlot < 0 || before(slots[i].dueUs, slots[nextSlot].dueUs)) nextSlot = i;
+        }
+        nextValid = true;
+    }
+
+    void armAt(int id, uint32_t dueUs) {
+        slots[id].dueUs = dueUs;
+        slots[id].armed = true;
+        if (nextValid && (nextSlot < 0 || nextSlot == id || before(dueUs, slots[nextSlot].dueUs))) {
+            if (nextSlot == id) nextValid = false;   // ถูกเลื่อนออกไป → อาจไม่ใช่ตัวแรกแล้ว
+            else                nextSlot  = id;
+        }
+    }
+
+public:
+    static const int NONE = -1;
+
+    int addGroup(const char* name) {
+        if (nGroups >= TIMER_MAX_GROUPS) return NONE;
+        groups[nGroups].name = name;
+        groups[nGroups].jitter.reset();
+        return nGroups++;
+    }
+
+    // slot ใหม่ (ยังไม่ arm)
+    // เต็ม → NONE + log (after/expired บน NONE ไม่ทำอะไร งานนั้นจะเงียบหายไปเลย)
+    int add(int group) {
+        if (nSlots >= TIMER_MAX_SLOTS || group < 0) {
+            dropped++;
+            Serial.printf("[Timer] add(%s) failed: %u/%u slots, %u groups\n",
+                          group >= 0 && group < nGroups ? groups[group].name : "?",
+                          nSlots, TIMER_MAX_SLOTS, nGroups);
+            return NONE;
+        }
+        slots[nSlots].armed = false;
+        slots[nSlots].group = (uint8_t)group;
+        return nSlots++;
+    }
+
+    void after(int id, uint32_t ms) {
+        if (id < 0) return;
+        armAt(id, micros() + ms * 1000u);
+    }
+
+    // periodic: ต่อจาก deadline เดิม (ไม่สะสม drift) ถ้าตกไปไกลแล้วเริ่มนับจากตอนนี้
+    void rearm(int id, uint32_t periodMs) {
+        if (id < 0) return;
+        uint32_t now = micros();
+        uint32_t due = slots[id].dueUs + periodMs * 1000u;
+        if (before(due, now)) due = now + periodMs * 1000u;
+        armAt(id, due);
+    }
+
+    void cancel(int id) {
+        if (id < 0 || !slots[id].armed) return;
+        slots[id].armed = false;
+        if (nextSlot == id) nextValid = false;
+    }
+
+    bool armed(int id) const { return id >= 0 && slots[id].armed; }
+
+    uint8_t droppedCount() const { return dropped; }
+
+    // ถึง deadline แล้วหรือยัง → true ครั้งเดียว (disarm + เก็บ jitter)
+    bool expired(int id) {
+        if (id < 0 || !slots[id].armed) return false;
+        uint32_t now = micros();
+        if (before(now, slots[id].dueUs)) return false;
+
+        groups[slots[id].group].jitter.add(now - slots[id].dueUs);
+        slots[id].armed = false;
+        if (nextSlot == id) nextValid = false;
+        return true;
+    }
+
+    // ms ถึง deadline ที่ใกล้สุด (ไม่มี/เกิน cap → cap)
+    uint32_t msUntilNext(uint32_t cap) {
+        if (!nextValid) recompute();
+        if (nextSlot < 0) return cap;
+        uint32_t now = micros();
+        uint32_t due = slots[nextSlot].dueUs;
+        if (!before(now, due)) return 0;
+        uint32_t ms = (due - now + 999) / 1000;
+        return ms < cap ? ms : cap;
+    }
+
+    // ---------- idle: เวลาที่ task เจ้าของ block รอ deadline/event ----------
+    void idleBegin() { waitStartUs = micros(); }
+
+    void idleEnd() {
+        uint32_t now = micros();
+        winIdleUs += now - waitStartUs;
+        if (winStartUs == 0) winStartUs = waitStartUs;
+    }
+
+    // ปิดหน้าต่างสถิติ (เรียกตอนพิมพ์ stats)
+    uint32_t idlePermille() {
+        uint32_t now = micros();
+        uint32_t span = now - winStartUs;
+        if (winStartUs != 0 && span > 0) {
+            idlePm = (uint32_t)((uint64_t)winIdleUs * 1000u / span);
+            if (idlePm > 1000) idlePm = 1000;
+        }
+        winStartUs = now;
+        winIdleUs  = 0;
+        return idlePm;
+    }
+
+    void printStats() {
+        uint32_t pm = idlePermille();
+        Serial.printf("[Timer] idle=%lu.%lu%% slots=%u/%u%s\n",
+                      (unsigned long)(pm / 10), (unsigned long)(pm % 10),
+                      nSlots, TIMER_MAX_SLOTS, dropped ? " (add FAILED)" : "");
+        for (uint8_t g = 0; g < nGroups; g++) {
+            const LatencyStat &j = groups[g].jitter;
+            if (j.count == 0) continue;
+            Serial.printf("[Timer] %-10s n=%lu jitter avg=%luus max=%luus\n",
+                          groups[g].name,
+                          (unsigned long)j.count,
+                          (unsigned long)j.avgUs(),
+                          (unsigned long)j.maxUs);
+        }
+    }
+};
@@ -0,0 +1,219 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "constant.h"
+#include "control/config_stream.h"
+
+// ---------- trace ของ input ที่ ControlLogic เห็น (record บนบอร์ด → replay บน host) ----------
+// header 16 byte แล้วตามด้วย record ต่อกันจนจบไฟล์ (little-endian ทั้งหมด)
+//   u8 type | varint zigzag(dt us จาก record ก่อนหน้า) | payload
+// TRACE_SENSOR : u8 node, mac[6], SensorPacket ดิบ (ยาว pktLen ตาม header)
+// TRACE_ENV    : i16 temp x10, i16 hum x10
+// TRACE_CONFIG : u8 mode, u8 flags (bit0 manual, bit1 sched), i16 target, i16 start, i16 stop,
+//                u8 n, n x (u8 days, i16 start, i16 stop)
+// TRACE_TIME   : u32 epoch (wall clock กระโดด เช่น NTP sync ครั้งแรก)
+// dt เป็นค่าติดลบได้ (packet ที่ rx ก่อน record ก่อนหน้าแต่ถูกอ่านทีหลัง)
+//
+// header: 0 "GWTR", 4 u8 version, 5 u8 pktLen, 6 u16 สำรอง,
+//         8 u32 epoch ตอนเริ่ม (0 = ยังไม่รู้เวลา), 12 u32 micros() ตอนเริ่ม
+
+#define TRACE_MAGIC       "GWTR"
+#define TRACE_VERSION     1
+#define TRACE_HDR_LEN     16
+#define TRACE_MAX_PAYLOAD 64
+#define TRACE_MAX_RECORD  (1 + 5 + TRACE_MAX_PAYLOAD)
+
+enum TraceType : uint8_t {
+    TRACE_SENSOR = 1,
+    TRACE_ENV    = 2,
+    TRACE_CONFIG = 3,
+    TRACE_TIME   = 4,
+};
+
+static_assert(7 + sizeof(SensorPacket) <= TRACE_MAX_PAYLOAD, "SensorPacket too large for trace");
+static_assert(9 + 5 * SCHED_MAX_WINDOWS <= TRACE_MAX_PAYLOAD, "SCHED_MAX_WINDOWS too large for trace");
+
+struct TraceHeader {
+    uint8_t  pktLen  = sizeof(SensorPacket);
+    uint32_t epoch   = 0;
+    uint32_t startUs = 0;
+};
+
+struct TraceEvent {
+    uint8_t  type = 0;
+    uint8_t  len  = 0;
+    uint32_t us   = 0;                  // micros() ของเหตุการณ์
+    uint8_t  data[TRACE_MAX_PAYLOAD];
+};
+
+// ---------- byte helpers ----------
+inline void tracePut16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+inline void tracePut32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;         p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+inline uint16_t traceGet16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+inline uint32_t traceGet32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ---------- header ----------
+inline void traceHeaderWrite(uint8_t* p, const TraceHeader &h) {
+    memcpy(p, TRACE_MAGIC, 4);
+    p[4] = TRACE_VERSION;
+    p[5] = h.pktLen;
+    tracePut16(p + 6, 0);
+    tracePut32(p + 8, h.epoch);
+    tracePut32(p + 12, h.startUs);
+}
+
+inline bool traceHeaderRead(const uint8_t* p, size_t len, TraceHeader &h) {
+    if (len < TRACE_HDR_LEN || memcmp(p, TRACE_MAGIC, 4) != 0 || p[4] != TRACE_VERSION) return false;
+    h.pktLen  = p[5];
+    h.epoch   = traceGet32(p + 8);
+    h.startUs = traceGet32(p + 12);
+    return h.pktLen > 0 && 7 + h.pktLen <= TRACE_MAX_PAYLOAD;
+}
+
+// ---------- record ----------
+// คืนความยาวที่เขียน (ไม่เกิน TRACE_MAX_RECORD)
+inline size_t traceEncode(const TraceEvent &e, uint32_t &prevUs, uint8_t* out) {
+    int32_t  d = (int32_t)(e.us - prevUs);
+    uint32_t z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+    prevUs = e.us;
+
+    size_t n = 0;
+    out[n++] = e.type;
+    do {
+        uint8_t b = z & 0x7F;
+        z >>= 7;
+        out[n++] = z ? (uint8_t)(b | 0x80) : b;
+    } while (z);
+    memcpy(out + n, e.data, e.len);
+    return n + e.len;
+}
+
+inline size_t tracePayloadLen(uint8_t type, const uint8_t* p, size_t avail, uint8_t pktLen) {
+    switch (type) {
+        case TRACE_SENSOR: return 7 + pktLen;
+        case TRACE_ENV:    return 4;
+        case TRACE_TIME:   return 4;
+        case TRACE_CONFIG:
+            if (avail < 9) return 9;
+            return p[8] <= SCHED_MAX_WINDOWS ? 9 + 5 * (size_t)p[8] : 0;
+        default:           return 0;
+    }
+}
+
+// คืนจำนวน byte ที่ใช้ (0 = ข้อมูลไม่ครบ / record เสีย)
+inline size_t traceDecode(const uint8_t* p, size_t n, uint8_t pktLen, uint32_t &prevUs, TraceEvent &e) {
+    if (n < 2) return 0;
+    size_t i = 0;
+    e.type = p[i++];
+
+    uint32_t z = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (i >= n || shift > 28) return 0;
+        uint8_t b = p[i++];
+        z |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    int32_t d = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+
+    size_t len = tracePayloadLen(e.type, p + i, n - i, pktLen);
+    if (len == 0 || len > TRACE_MAX_PAYLOAD || i + len > n) return 0;
+
+    e.len = (uint8_t)len;
+    memcpy(e.data, p + i, len);
+    e.us = prevUs + (uint32_t)d;
+    prevUs = e.us;
+    return i + len;
+}
+
+// ---------- payload แต่ละชนิด ----------
+inline void traceMakeSensor(TraceEvent &e, uint32_t us, uint8_t node, const uint8_t mac[6],
+                            const SensorPacket &p) {
+    e.type = TRACE_SENSOR;
+    e.us   = us;
+    e.data[0] = node;
+    memcpy(e.data + 1, mac, 6);
+    memcpy(e.data + 7, &p, sizeof(p));
+    e.len = (uint8_t)(7 + sizeof(p));
+}
+
+// pktLen ของ trace ไม่เท่ากับ build นี้ → copy เท่าที่ตรงกัน ที่เหลือเป็น 0
+inline void traceReadSensor(const TraceEvent &e, uint8_t &node, uint8_t mac[6], SensorPacket &p) {
+    node = e.data[0];
+    memcpy(mac, e.data + 1, 6);
+    memset(&p, 0, sizeof(p));
+    size_t n = e.len - 7;
+    memcpy(&p, e.data + 7, n < sizeof(p) ? n : sizeof(p));
+}
+
+inline void traceMakeEnv(TraceEvent &e, uint32_t us, float temp, float hum) {
+    e.type = TRACE_ENV;
+    e.us   = us;
+    tracePut16(e.data,     (uint16_t)(int16_t)lroundf(temp * 10.0f));
+    tracePut16(e.data + 2, (uint16_t)(int16_t)lroundf(hum * 10.0f));
+    e.len = 4;
+}
+
+inline void traceReadEnv(const TraceEvent &e, float &temp, float &hum) {
+    temp = (int16_t)traceGet16(e.data)     / 10.0f;
+    hum  = (int16_t)traceGet16(e.data + 2) / 10.0f;
+}
+
+inline void traceMakeConfig(TraceEvent &e, uint32_t us, const ControlConfig &c) {
+    e.type = TRACE_CONFIG;
+    e.us   = us;
+    uint8_t* p = e.data;
+    p[0] = (uint8_t)c.mode;
+    p[1] = (uint8_t)((c.manual ? 1 : 0) | (c.schedEnable ? 2 : 0));
+    tracePut16(p + 2, (uint16_t)(int16_t)c.targetHumid);
+    tracePut16(p + 4, (uint16_t)(int16_t)c.schedStartMin);
+    tracePut16(p + 6, (uint16_t)(int16_t)c.schedStopMin);
+    uint8_t n = c.schedWindowCount <= SCHED_MAX_WINDOWS ? c.schedWindowCount : SCHED_MAX_WINDOWS;
+    p[8] = n;
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t* w = p + 9 + 5 * i;
+        w[0] = c.schedWindows[i].days;
+        tracePut16(w + 1, (uint16_t)c.schedWindows[i].startMin);
+        tracePut16(w + 3, (uint16_t)c.schedWindows[i].stopMin);
+    }
+    e.len = (uint8_t)(9 + 5 * n);
+}
+
+inline void traceReadConfig(const TraceEvent &e, ControlConfig &c) {
+    const uint8_t* p = e.data;
+    c = ControlConfig();
+    c.mode          = p[0] <= MODE_UNKNOWN ? (ControlMode)p[0] : MODE_UNKNOWN;
+    c.manual        = p[1] & 1;
+    c.schedEnable   = (p[1] & 2) != 0;
+    c.targetHumid   = (int16_t)traceGet16(p + 2);
+    c.schedStartMin = (int16_t)traceGet16(p + 4);
+    c.schedStopMin  = (int16_t)traceGet16(p + 6);
+    c.schedWindowCount = p[8];
+    for (uint8_t i = 0; i < c.schedWindowCount; i++) {
+        const uint8_t* w = p + 9 + 5 * i;
+        c.schedWindows[i].days     = w[0];
+        c.schedWindows[i].startMin = (int16_t)traceGet16(w + 1);
+        c.schedWindows[i].stopMin  = (int16_t)traceGet16(w + 3);
+    }
+}
+
+inline void traceMakeTime(TraceEvent &e, uint32_t us, uint32_t epoch) {
+    e.type = TRACE_TIME;
+    e.us   = us;
+    tracePut32(e.data, epoch);
+    e.len = 4;
+}
+
+inline uint32_t traceReadTime(const TraceEvent &e) { return traceGet32(e.data); }
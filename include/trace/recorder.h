@@ -0,0 +1,137 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "spsc_ring.h"
+#include "trace/format.h"
+
+// ---------- บันทึก input ของ ControlLogic ลง LittleFS (env:trace) ----------
+// producer = control task (sensor / DHT / config ที่ update() อ่านจริง) → RAM ring
+// consumer = cloud task: spill() ต่อท้ายไฟล์ → ไม่มี flash I/O ใน control path
+// ไฟล์ใหม่ทุก boot, เต็ม TRACE_MAX_BYTES แล้วหยุด (replay ด้วย env:native)
+#ifndef TRACE_PATH
+#define TRACE_PATH "/trace.bin"
+#endif
+
+#ifndef TRACE_RAM_DEPTH
+#define TRACE_RAM_DEPTH 32             // ต้องเป็นกำลังสอง
+#endif
+
+#ifndef TRACE_MAX_BYTES
+#define TRACE_MAX_BYTES (512UL * 1024)
+#endif
+
+class TraceRecorder {
+private:
+    SpscRing<TraceEvent, TRACE_RAM_DEPTH> ram;
+
+    // ---------- producer (control task) ----------
+    // wall clock ที่ replay จะคำนวณได้ = epochRef + (us - usRef) → เพี้ยนเกิน 1s ค่อยเขียน TRACE_TIME
+    uint32_t epochRef = 0;
+    uint32_t usRef    = 0;
+    uint32_t recorded = 0;
+    uint32_t ramDrops = 0;
+
+    // ---------- consumer (cloud task) ----------
+    bool     fsOk   = false;
+    bool     full   = false;
+    uint32_t prevUs = 0;
+    uint32_t bytes  = 0;
+
+    void push(const TraceEvent &e) {
+        if (ram.push(e)) recorded++;
+        else             ramDrops++;
+    }
+
+    void checkTime() {
+        uint32_t us  = micros();
+        uint32_t now = (uint32_t)time(nullptr);
+        uint32_t expect = epochRef + (us - usRef) / 1000000UL;
+        if (now - expect + 1 <= 2) return;       // ต่างกันไม่เกิน 1s
+
+        epochRef = now;
+        usRef    = us;
+        TraceEvent e;
+        traceMakeTime(e, us, now);
+        push(e);
+    }
+
+public:
+    // cloud task เรียกครั้งเดียว (หลัง TelemetryStore::begin mount LittleFS แล้ว)
+    void begin() {
+        fsOk = LittleFS.begin(true);
+        if (!fsOk) {
+            Serial.println("[Trace] LittleFS mount failed, not recording");
+            return;
+        }
+
+        uint8_t hdr[TRACE_HDR_LEN];
+        TraceHeader h;                 // epoch 0 / startUs 0 → เวลาจริงตามมาเป็น TRACE_TIME
+        traceHeaderWrite(hdr, h);
+        File f = LittleFS.open(TRACE_PATH, FILE_WRITE);
+        if (!f || f.write(hdr, sizeof(hdr)) != sizeof(hdr)) {
+            fsOk = false;
+            Serial.println("[Trace] cannot create " TRACE_PATH);
+            return;
+        }
+        f.close();
+        bytes = sizeof(hdr);
+        Serial.println("[Trace] recording to " TRACE_PATH);
+    }
+
+    // ---------- producer (control task) ----------
+    void sensor(uint8_t node, const uint8_t mac[6], const SensorPacket &p, uint32_t rxUs) {
+        checkTime();
+        TraceEvent e;
+        traceMakeSensor(e, rxUs, node, mac, p);
+        push(e);
+    }
+
+    void env(float temp, float hum) {
+        checkTime();
+        TraceEvent e;
+        traceMakeEnv(e, micros(), temp, hum);
+        push(e);
+    }
+
+    void config(const ControlConfig &c, uint32_t changedUs) {
+        checkTime();
+        TraceEvent e;
+        traceMakeConfig(e, changedUs ? changedUs : (uint32_t)micros(), c);
+        push(e);
+    }
+
+    // ---------- consumer (cloud task) ----------
+    void spill() {
+        if (ram.empty()) return;
+
+        File f;
+        if (fsOk && !full) f = LittleFS.open(TRACE_PATH, FILE_APPEND);
+
+        uint8_t buf[TRACE_MAX_RECORD];
+        TraceEvent e;
+        while (ram.pop(e)) {
+            if (!f) continue;
+            size_t n = traceEncode(e, prevUs, buf);
+            if (bytes + n > TRACE_MAX_BYTES) {
+                full = true;
+                Serial.printf("[Trace] %s full (%lu bytes), recording stopped\n",
+                              TRACE_PATH, (unsigned long)bytes);
+                break;
+            }
+            if (f.write(buf, n) != n) {
+                fsOk = false;
+                Serial.println("[Trace] write failed, recording stopped");
+                break;
+            }
+            bytes += n;
+        }
+        if (f) f.close();
+        while (ram.pop(e)) {}          // หยุดบันทึกแล้ว → ทิ้งที่ค้าง
+    }
+
+    void printStats() const {
+        Serial.printf("[Trace] events=%lu bytes=%lu drop=%lu%s\n",
+                      (unsigned long)recorded, (unsigned long)bytes,
+                      (unsigned long)ramDrops, full ? " (full)" : "");
+    }
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <string>
+#include <algorithm>
+#include "sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// ---------- Arduino-ESP32 สำหรับ env:native (Linux) ----------
+// มีเฉพาะส่วนที่ include/ ใช้จริง; เวลาทั้งหมดมาจาก virtual clock ใน sim.h
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+typedef bool boolean;
+typedef int  esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+#define LOW  0
+#define HIGH 1
+
+inline unsigned long millis() { return (unsigned long)(nativeSim().nowUs / 1000); }
+inline unsigned long micros() { return (unsigned long)nativeSim().nowUs; }
+inline void delay(unsigned long ms) { nativeSim().nowUs += (uint64_t)ms * 1000; }
+inline void yield() {}
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+// heap ของ host ไม่มีความหมาย → ค่าคงที่ (ตัวนับ RtdbClient ยังทำงานครบ)
+struct EspClass {
+    uint32_t getFreeHeap()     const { return 200000; }
+    uint32_t getMinFreeHeap()  const { return 200000; }
+    uint32_t getMaxAllocHeap() const { return 110000; }
+};
+
+inline EspClass ESP;
+
+// ---------- wall clock จำลอง (schedule / countdown / history ts) ----------
+inline time_t nativeTime(time_t* t) {
+    time_t v = (time_t)(nativeSim().wallUs() / 1000000LL);
+    if (t) *t = v;
+    return v;
+}
+
+inline int nativeGettimeofday(struct timeval* tv, void*) {
+    int64_t us = nativeSim().wallUs();
+    tv->tv_sec  = (time_t)(us / 1000000LL);
+    tv->tv_usec = (suseconds_t)(us % 1000000LL);
+    return 0;
+}
+
+inline int nativeSettimeofday(const struct timeval* tv, const void*) {
+    nativeSim().setWall(tv->tv_sec);
+    return 0;
+}
+
+// code ใน include/ เรียก time()/gettimeofday() ตรง ๆ → เบนมาที่นาฬิกาจำลอง
+#define time(t)              nativeTime(t)
+#define gettimeofday(tv, tz) nativeGettimeofday(tv, tz)
+#define settimeofday(tv, tz) nativeSettimeofday(tv, tz)
+
+// gmtOffset → TZ ของ process (localtime_r ใน ScheduleEngine ให้ผลเหมือนบนบอร์ด)
+inline void configTime(long gmtOffsetSec, int daylightOffsetSec, const char*,
+                       const char* = nullptr, const char* = nullptr) {
+    long off = gmtOffsetSec + daylightOffsetSec;
+    char tz[24];
+    snprintf(tz, sizeof(tz), "<%+03ld>%+ld", off / 3600, -off / 3600);
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+// ---------- String (ส่วนที่ใช้กับ Firebase / WiFi) ----------
+class String {
+private:
+    std::string s;
+
+public:
+    String(const char* v = "") : s(v ? v : "") {}
+    String(const std::string &v) : s(v) {}
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned int length() const { return (unsigned int)s.size(); }
+
+    bool operator==(const char* o) const { return s == o; }
+    bool operator!=(const char* o) const { return s != o; }
+    bool operator==(const String &o) const { return s == o.s; }
+    String& operator+=(const char* o) { s += o; return *this; }
+};
+
+// ---------- Serial: stdout เมื่อ verbose (ไม่งั้นทิ้ง แต่ยัง format ครบเหมือนบนบอร์ด) ----------
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+
+    size_t write(const uint8_t* p, size_t n) {
+        if (nativeSim().verbose) fwrite(p, 1, n, stdout);
+        return n;
+    }
+
+    size_t print(const char* s)   { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t println(const char* s = "") { size_t n = print(s); return n + print("\n"); }
+    size_t println(const String &s)    { return println(s.c_str()); }
+
+    int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[512];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n > 0) write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+        return n;
+    }
+};
+
+inline HardwareSerial Serial;
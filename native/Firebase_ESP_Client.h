@@ -0,0 +1,207 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- Firebase RTDB บน host: key/value ใน NativeSim + นับทุก call ----------
+// PATCH (updateNode) ถูก parse กลับเป็น path → ค่า แล้ว echo ผ่าน stream เหมือน server
+
+struct TokenInfo {};
+struct FirebaseAuth {};
+
+struct FirebaseConfig {
+    String api_key;
+    String database_url;
+    void (*token_status_callback)(TokenInfo) = nullptr;
+};
+
+struct FirebaseJsonData {
+    bool   success = false;
+    String stringValue;
+};
+
+class FirebaseJson {
+private:
+    std::string raw;
+
+public:
+    void setJsonData(const char* s) { raw = s ? s : ""; }
+    const std::string& text() const { return raw; }
+
+    // stream ใน sim ส่งแต่ leaf event → ไม่มี JSON ให้ค้น
+    bool get(FirebaseJsonData &r, const char*) { r.success = false; return false; }
+};
+
+class FirebaseData {
+public:
+    std::string value;
+    std::string error;
+
+    String stringData() const { return String(value); }
+    bool   boolData()   const { return value == "true" || value == "1"; }
+    int    intData()    const { return atoi(value.c_str()); }
+    float  floatData()  const { return (float)atof(value.c_str()); }
+    String errorReason() const { return String(error); }
+
+    void setBSSLBufferSize(uint16_t, uint16_t) {}
+    void setResponseSize(uint16_t) {}
+    void keepAlive(int, int, int) {}
+};
+
+class FirebaseStream {
+private:
+    std::string path, type, value;
+
+public:
+    FirebaseStream(const std::string &p, const std::string &t, const std::string &v)
+        : path(p), type(t), value(v) {}
+
+    String dataPath()   const { return String(path);  }
+    String dataType()   const { return String(type);  }
+    String stringData() const { return String(value); }
+    String eventType()  const { return String("put"); }
+    FirebaseJson* jsonObjectPtr() { return nullptr; }
+};
+
+typedef void (*FirebaseStreamCallback)(FirebaseStream);
+typedef void (*FirebaseStreamTimeoutCallback)(bool);
+
+// ---------- flat JSON ของ RtdbBatch: {"a/b":1,"c":"x","d":{...}} ----------
+inline size_t nativeJsonValueEnd(const std::string &s, size_t i) {
+    if (s[i] == '"') {
+        for (i++; i < s.size() && s[i] != '"'; i++) if (s[i] == '\\') i++;
+        return i + 1;
+    }
+    if (s[i] == '{' || s[i] == '[') {
+        int depth = 0;
+        bool str = false;
+        for (; i < s.size(); i++) {
+            char c = s[i];
+            if (str) { if (c == '\\') i++; else if (c == '"') str = false; continue; }
+            if (c == '"') str = true;
+            else if (c == '{' || c == '[') depth++;
+            else if ((c == '}' || c == ']') && --depth == 0) return i + 1;
+        }
+        return i;
+    }
+    while (i < s.size() && s[i] != ',' && s[i] != '}') i++;
+    return i;
+}
+
+inline std::string nativeJsonUnquote(const std::string &v) {
+    if (v.size() < 2 || v[0] != '"') return v;
+    std::string out;
+    for (size_t i = 1; i + 1 < v.size(); i++) {
+        if (v[i] == '\\' && i + 2 < v.size()) i++;
+        out += v[i];
+    }
+    return out;
+}
+
+inline void nativeApplyPatch(const std::string &base, const std::string &json) {
+    size_t i = json.find('{');
+    if (i == std::string::npos) return;
+    i++;
+    while (i < json.size()) {
+        size_t k0 = json.find('"', i);
+        if (k0 == std::string::npos) return;
+        size_t k1 = json.find('"', k0 + 1);
+        size_t v0 = json.find(':', k1) + 1;
+        size_t v1 = nativeJsonValueEnd(json, v0);
+        std::string key = json.substr(k0 + 1, k1 - k0 - 1);
+        std::string path = (base == "/" ? "" : base) + "/" + key;
+        nativeSim().rtdbWrite(path, nativeJsonUnquote(json.substr(v0, v1 - v0)));
+        i = v1 + 1;
+    }
+}
+
+inline const char* nativeValueType(const std::string &v) {
+    if (v == "true" || v == "false") return "boolean";
+    if (v.empty()) return "string";
+    char* end = nullptr;
+    strtod(v.c_str(), &end);
+    if (*end != '\0') return "string";
+    return v.find('.') == std::string::npos ? "int" : "float";
+}
+
+class FirebaseRtdb {
+private:
+    static bool read(FirebaseData* fb, const char* path) {
+        NativeSim &s = nativeSim();
+        s.rtdbStats.gets++;
+        auto it = s.rtdb.find(path);
+        if (it == s.rtdb.end()) {
+            fb->error = "path not exist";
+            return false;
+        }
+        fb->value = it->second;
+        return true;
+    }
+
+    static bool write(const char* path, const std::string &v) {
+        nativeSim().rtdbStats.sets++;
+        nativeSim().rtdbWrite(path, v);
+        return true;
+    }
+
+public:
+    bool updateNodeSilent(FirebaseData*, const char* path, FirebaseJson* json) {
+        NativeSim &s = nativeSim();
+        s.rtdbStats.patches++;
+        s.rtdbStats.patchBytes += (uint32_t)json->text().size();
+        nativeApplyPatch(path, json->text());
+        return true;
+    }
+
+    bool updateNode(FirebaseData* fb, const char* path, FirebaseJson* json) {
+        return updateNodeSilent(fb, path, json);
+    }
+
+    bool pushString(FirebaseData*, const char*, const char*) {
+        nativeSim().rtdbStats.pushes++;
+        return true;
+    }
+
+    bool getString(FirebaseData* fb, const char* path) { return read(fb, path); }
+    bool getBool(FirebaseData* fb, const char* path)   { return read(fb, path); }
+    bool getInt(FirebaseData* fb, const char* path)    { return read(fb, path); }
+    bool getFloat(FirebaseData* fb, const char* path)  { return read(fb, path); }
+
+    bool setString(FirebaseData*, const char* path, const char* v) { return write(path, v); }
+    bool setBool(FirebaseData*, const char* path, bool v)  { return write(path, v ? "true" : "false"); }
+    bool setInt(FirebaseData*, const char* path, int v)    { return write(path, std::to_string(v)); }
+    bool setFloat(FirebaseData*, const char* path, float v) {
+        char b[24];
+        snprintf(b, sizeof(b), "%.2f", v);
+        return write(path, b);
+    }
+
+    bool beginStream(FirebaseData*, const char* path) {
+        NativeSim &s = nativeSim();
+        s.rtdbStats.streamBegin++;
+        s.streamPath = path;
+        return true;
+    }
+
+    // snapshot แรก = leaf ทุกตัวใต้ path (แทน put "/" แบบ JSON ของ server จริง)
+    void setStreamCallback(FirebaseData*, FirebaseStreamCallback cb, FirebaseStreamTimeoutCallback) {
+        NativeSim &s = nativeSim();
+        s.streamSink = [cb](const std::string &p, const std::string &v) {
+            cb(FirebaseStream(p, nativeValueType(v), v));
+        };
+        std::map<std::string, std::string> snap = s.rtdb;
+        for (const auto &kv : snap) s.streamNotify(kv.first, kv.second);
+    }
+};
+
+class FirebaseClient {
+public:
+    FirebaseRtdb RTDB;
+
+    bool signUp(FirebaseConfig*, FirebaseAuth*, const char*, const char*) { return true; }
+    void setIdToken(FirebaseConfig*, const char*, size_t, const char*) {}
+    void begin(FirebaseConfig*, FirebaseAuth*) {}
+    void reconnectWiFi(bool) {}
+    bool ready() { return nativeSim().fbReady; }
+    String getRefreshToken() { return String("native-refresh-token"); }
+};
+
+inline FirebaseClient Firebase;
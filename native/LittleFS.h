@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- ไม่มี flash บน host: mount ไม่ผ่าน → TelemetryStore ใช้ RAM อย่างเดียว ----------
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+class File {
+public:
+    explicit operator bool() const { return false; }
+    size_t size() const { return 0; }
+    size_t read(uint8_t*, size_t) { return 0; }
+    size_t write(const uint8_t*, size_t) { return 0; }
+    bool seek(uint32_t) { return false; }
+    void close() {}
+    bool isDirectory() const { return false; }
+    File openNextFile() { return File(); }
+    const char* name() const { return ""; }
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool = false) { return false; }
+    File open(const char*, const char* = FILE_READ) { return File(); }
+    bool mkdir(const char*)  { return false; }
+    bool remove(const char*) { return false; }
+    bool exists(const char*) { return false; }
+};
+
+inline LittleFSFS LittleFS;
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+// ---------- NVS ในหน่วยความจำ (เริ่มว่างทุกครั้ง = cold boot) ----------
+class Preferences {
+private:
+    std::map<std::string, std::vector<uint8_t>> kv;
+
+    size_t get(const char* k, void* out, size_t n) const {
+        auto it = kv.find(k);
+        if (it == kv.end()) return 0;
+        size_t len = std::min(n, it->second.size());
+        memcpy(out, it->second.data(), len);
+        return len;
+    }
+
+    void put(const char* k, const void* v, size_t n) {
+        const uint8_t* p = (const uint8_t*)v;
+        kv[k].assign(p, p + n);
+    }
+
+public:
+    bool begin(const char*, bool) { return true; }
+    bool clear()                  { kv.clear(); return true; }
+    bool remove(const char* k)    { return kv.erase(k) > 0; }
+
+    uint8_t getUChar(const char* k, uint8_t def)   { uint8_t v = def;  get(k, &v, 1); return v; }
+    uint32_t getULong(const char* k, uint32_t def) { uint32_t v = def; get(k, &v, 4); return v; }
+    size_t putUChar(const char* k, uint8_t v)      { put(k, &v, 1); return 1; }
+    size_t putULong(const char* k, uint32_t v)     { put(k, &v, 4); return 4; }
+
+    size_t getBytesLength(const char* k) const {
+        auto it = kv.find(k);
+        return it == kv.end() ? 0 : it->second.size();
+    }
+    size_t getBytes(const char* k, void* out, size_t n) { return get(k, out, n); }
+    size_t putBytes(const char* k, const void* v, size_t n) { put(k, v, n); return n; }
+
+    size_t getString(const char* k, char* out, size_t n) {
+        if (n == 0) return 0;
+        size_t len = get(k, out, n - 1);
+        out[len] = '\0';
+        return len ? len + 1 : 0;
+    }
+    size_t putString(const char* k, const char* v) { put(k, v, strlen(v)); return strlen(v); }
+};
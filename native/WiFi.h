@@ -0,0 +1,96 @@
+#pragma once
+#include <Arduino.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// ---------- Wi-Fi: ต่อติดทันที (replay สนใจ control path ไม่ใช่ boot) ----------
+#define WIFI_AP_STA  3
+#define WL_CONNECTED 3
+
+class IPAddress {
+public:
+    String toString() const { return String("127.0.0.1"); }
+};
+
+class WiFiClass {
+private:
+    uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 1 };
+
+public:
+    bool mode(int)      { return true; }
+    bool setSleep(bool) { return true; }
+    int  begin(const char*, const char*, int32_t = 0, const uint8_t* = nullptr, bool = true) {
+        return WL_CONNECTED;
+    }
+    bool disconnect()   { return true; }
+    int  status()       { return WL_CONNECTED; }
+    int32_t  channel()  { return 1; }
+    uint8_t* BSSID()    { return bssid; }
+    IPAddress localIP() { return IPAddress(); }
+    uint8_t* macAddress(uint8_t* mac) { memcpy(mac, bssid, 6); return mac; }
+};
+
+// ---------- WiFiClient: TCP จริงผ่าน POSIX socket (MqttSink ต่อ broker ในเครื่องได้) ----------
+class WiFiClient {
+private:
+    int  fd     = -1;
+    bool closed = false;               // อีกฝั่งปิดแล้ว (read ได้ 0)
+
+    bool wait(short ev, int ms) {
+        pollfd p = { fd, ev, 0 };
+        return ::poll(&p, 1, ms) > 0;
+    }
+
+public:
+    ~WiFiClient() { stop(); }
+
+    int connect(const char* host, uint16_t port) {
+        stop();
+        char svc[8];
+        snprintf(svc, sizeof(svc), "%u", (unsigned)port);
+        addrinfo hints = {}, *res = nullptr;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, svc, &hints, &res) != 0) return 0;
+        for (addrinfo* a = res; a; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        closed = false;
+        return fd >= 0;
+    }
+
+    size_t write(const uint8_t* p, size_t n) {
+        if (fd < 0) return 0;
+        ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+        return w < 0 ? 0 : (size_t)w;
+    }
+
+    // ให้เวลา broker ตอบ 1 ms (ตัวจริง lwIP รับเข้า buffer เองอยู่แล้ว)
+    int available() {
+        if (fd < 0 || closed || !wait(POLLIN, 1)) return 0;
+        return 1;
+    }
+
+    int read() {
+        uint8_t b;
+        if (fd < 0) return -1;
+        ssize_t n = ::recv(fd, &b, 1, 0);
+        if (n <= 0) { closed = true; return -1; }
+        return b;
+    }
+
+    uint8_t connected() { return fd >= 0 && !closed; }
+
+    void stop() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+};
+
+inline WiFiClass WiFi;
@@ -0,0 +1,2 @@
+#pragma once
+#include <Firebase_ESP_Client.h>
@@ -0,0 +1,4 @@
+#pragma once
+#include <Firebase_ESP_Client.h>
+
+inline void tokenStatusCallback(TokenInfo) {}
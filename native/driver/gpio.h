@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+    GPIO_MODE_INPUT_OUTPUT_OD,
+} gpio_mode_t;
+
+typedef enum {
+    GPIO_PULLUP_ONLY,
+    GPIO_FLOATING,
+} gpio_pull_mode_t;
+
+inline esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t)     { return ESP_OK; }
+inline esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t) { return ESP_OK; }
+inline esp_err_t gpio_set_level(gpio_num_t, uint32_t)             { return ESP_OK; }
@@ -0,0 +1,72 @@
+#pragma once
+#include <Arduino.h>
+#include "freertos/ringbuf.h"
+#include "driver/gpio.h"
+
+// ---------- RMT rx: rmt_rx_start() "จับ" frame DHT จาก sim.dhtBytes ----------
+typedef enum { RMT_CHANNEL_0, RMT_CHANNEL_1, RMT_CHANNEL_2, RMT_CHANNEL_3,
+               RMT_CHANNEL_4, RMT_CHANNEL_5, RMT_CHANNEL_6, RMT_CHANNEL_7 } rmt_channel_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0    : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1    : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct {
+    bool     filter_en;
+    uint8_t  filter_ticks_thresh;
+    uint16_t idle_threshold;
+} rmt_rx_config_t;
+
+typedef struct {
+    int             rmt_mode;
+    rmt_channel_t   channel;
+    gpio_num_t      gpio_num;
+    uint8_t         clk_div;
+    uint8_t         mem_block_num;
+    rmt_rx_config_t rx_config;
+} rmt_config_t;
+
+#define RMT_DEFAULT_CONFIG_RX(gpio, channel_id) \
+    { 1, channel_id, gpio, 80, 1, { false, 0, 12000 } }
+
+inline esp_err_t rmt_config(const rmt_config_t*) { return ESP_OK; }
+inline esp_err_t rmt_driver_install(rmt_channel_t, size_t, int) { return ESP_OK; }
+
+inline esp_err_t rmt_get_ringbuf_handle(rmt_channel_t, RingbufHandle_t* rb) {
+    *rb = &nativeSim().rmtItems;
+    return ESP_OK;
+}
+
+inline uint32_t nativeRmtItem(uint32_t l0, uint32_t d0, uint32_t l1, uint32_t d1) {
+    rmt_item32_t it;
+    it.duration0 = d0; it.level0 = l0;
+    it.duration1 = d1; it.level1 = l1;
+    return it.val;
+}
+
+// response 80/80us แล้ว 40 bit (LOW 50us + HIGH 26/70us) ปิดท้ายด้วย LOW 50us
+inline esp_err_t rmt_rx_start(rmt_channel_t, bool) {
+    NativeSim &s = nativeSim();
+    s.rmtItems.clear();
+    s.rmtPending = false;
+    if (!s.dhtPresent) return ESP_OK;
+
+    s.rmtItems.push_back(nativeRmtItem(0, 80, 1, 80));
+    for (int i = 0; i < 40; i++) {
+        bool one = (s.dhtBytes[i / 8] >> (7 - i % 8)) & 1;
+        s.rmtItems.push_back(nativeRmtItem(0, 50, 1, one ? 70 : 26));
+    }
+    s.rmtItems.push_back(nativeRmtItem(0, 50, 1, 0));
+    s.rmtPending = true;
+    return ESP_OK;
+}
+
+inline esp_err_t rmt_rx_stop(rmt_channel_t) { return ESP_OK; }
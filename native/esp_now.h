@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- ESP-NOW: send → command timeline + ack ตามเวลาจำลอง ----------
+typedef enum {
+    ESP_NOW_SEND_SUCCESS = 0,
+    ESP_NOW_SEND_FAIL,
+} esp_now_send_status_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac, const uint8_t* data, int len);
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac, esp_now_send_status_t status);
+
+typedef struct {
+    uint8_t peer_addr[6];
+    uint8_t channel;
+    int     ifidx;
+    bool    encrypt;
+} esp_now_peer_info_t;
+
+inline esp_err_t esp_now_init() { return ESP_OK; }
+inline esp_err_t esp_now_add_peer(const esp_now_peer_info_t*) { return ESP_OK; }
+
+inline esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+    nativeSim().recvCb = cb;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+    nativeSim().sentSink = [cb](const uint8_t* mac, bool ok) {
+        cb(mac, ok ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+    };
+    return ESP_OK;
+}
+
+inline esp_err_t esp_now_send(const uint8_t* mac, const uint8_t* data, size_t len) {
+    NativeDeviceScope device;
+    NativeSim &s = nativeSim();
+    NativeSend f;
+    f.us  = s.nowUs;
+    memcpy(f.mac, mac, 6);
+    f.len = (uint8_t)std::min(len, sizeof(f.data));
+    memcpy(f.data, data, f.len);
+    s.sends.push_back(f);
+
+    // loss แบบกระจายสม่ำเสมอ (ผลซ้ำได้ทุกครั้งที่ replay)
+    NativeAck a;
+    a.dueUs = s.nowUs + s.ackUs;
+    memcpy(a.mac, mac, 6);
+    s.lossAcc += s.lossPermille;
+    a.ok = s.lossAcc < 1000;
+    if (!a.ok) s.lossAcc -= 1000;
+    s.acks.push_back(a);
+    return ESP_OK;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <Arduino.h>
+
+// เวลาจำลองถือว่า sync แล้วตั้งแต่เริ่ม → แจ้งทันทีที่ลงทะเบียน
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) {
+    if (cb) cb(nullptr);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+
+// ---------- esp_timer one-shot บน virtual clock (replayer ยิงผ่าน NativeSim::runDue) ----------
+typedef NativeTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void*);
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void*          arg;
+    int            dispatch_method;
+    const char*    name;
+    bool           skip_unhandled_events;
+} esp_timer_create_args_t;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* a, esp_timer_handle_t* out) {
+    NativeSim &s = nativeSim();
+    s.timers.emplace_back(new NativeTimer());
+    NativeTimer* t = s.timers.back().get();
+    t->cb   = a->callback;
+    t->arg  = a->arg;
+    t->name = a->name ? a->name : "";
+    *out = t;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t us) {
+    t->dueUs = nativeSim().nowUs + us;
+    t->armed = true;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+    t->armed = false;
+    return ESP_OK;
+}
+
+inline int64_t esp_timer_get_time() { return (int64_t)nativeSim().nowUs; }
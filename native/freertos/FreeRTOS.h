@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include "../sim.h"
+
+// ---------- FreeRTOS สำหรับ env:native: task เป็นแค่ชื่อ + notify count ----------
+// ไม่มี scheduler: replayer เป็นคนเรียก update()/step() เองตามเวลาจำลอง
+
+typedef NativeTask* TaskHandle_t;
+typedef void*       QueueHandle_t;
+typedef int         BaseType_t;
+typedef unsigned    UBaseType_t;
+typedef uint32_t    TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct portMUX_TYPE { uint32_t owner; };
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(m)     ((void)(m))
+#define portEXIT_CRITICAL(m)      ((void)(m))
+#define portENTER_CRITICAL_ISR(m) ((void)(m))
+#define portEXIT_CRITICAL_ISR(m)  ((void)(m))
@@ -0,0 +1,16 @@
+#pragma once
+#include <stddef.h>
+#include "FreeRTOS.h"
+
+// ringbuffer ของ RMT rx: มี item ก้อนเดียวคือ capture ล่าสุดใน sim
+typedef void* RingbufHandle_t;
+
+inline void* xRingbufferReceive(RingbufHandle_t, size_t* len, TickType_t) {
+    NativeSim &s = nativeSim();
+    if (!s.rmtPending || s.rmtItems.empty()) return nullptr;
+    s.rmtPending = false;
+    *len = s.rmtItems.size() * sizeof(uint32_t);
+    return s.rmtItems.data();
+}
+
+inline void vRingbufferReturnItem(RingbufHandle_t, void*) {}
@@ -0,0 +1,29 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+// ไม่รัน fn จริง (loop ไม่รู้จบ) — แค่สร้าง handle ให้ notify ถึงได้
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char* name, uint32_t, void*,
+                                          UBaseType_t, TaskHandle_t* out, BaseType_t) {
+    TaskHandle_t t = nativeSim().task(name);
+    if (out) *out = t;
+    return pdPASS;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t t) {
+    if (t) t->notify++;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t) {
+    NativeTask* t = nativeSim().current;
+    if (!t) return 0;
+    uint32_t n = t->notify;
+    t->notify = clear ? 0 : (n ? n - 1 : 0);
+    return n;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nativeSim().current; }
+
+inline void vTaskDelete(TaskHandle_t) {}
+inline void vTaskDelay(TickType_t ms) { nativeSim().nowUs += (uint64_t)ms * 1000; }
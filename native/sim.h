@@ -0,0 +1,172 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+
+// ---------- โลกจำลองของ env:native (ใช้ร่วมกันทุก stand-in ใน native/) ----------
+// เวลา = virtual clock ที่ replayer เป็นคนเดิน (millis/micros/time อ่านจากที่นี่)
+// อุปกรณ์ภายนอก (ESP-NOW / RTDB / DHT) เก็บ state + ตัวนับไว้ที่นี่ให้ replayer รายงาน
+// ทุกอย่างวิ่งบน thread เดียว → ไม่มี lock
+
+struct NativeTask {
+    std::string name;
+    uint32_t    notify = 0;          // xTaskNotifyGive ที่ยังไม่ถูก take
+};
+
+struct NativeTimer {
+    void      (*cb)(void*) = nullptr;
+    void*       arg   = nullptr;
+    const char* name  = "";
+    uint64_t    dueUs = 0;
+    bool        armed = false;
+};
+
+// 1 frame ที่ esp_now_send ส่งออก (= command timeline)
+struct NativeSend {
+    uint64_t us;
+    uint8_t  mac[6];
+    uint8_t  len;
+    uint8_t  data[16];
+};
+
+struct NativeAck {
+    uint64_t dueUs;
+    uint8_t  mac[6];
+    bool     ok;
+};
+
+struct NativeRtdbStats {
+    uint32_t patches     = 0;        // updateNode(Silent)
+    uint32_t patchBytes  = 0;
+    uint32_t pushes      = 0;
+    uint32_t gets        = 0;
+    uint32_t sets        = 0;
+    uint32_t streamBegin = 0;
+    uint32_t streamEvents = 0;
+};
+
+struct NativeSim {
+    // ---------- เวลา ----------
+    uint64_t nowUs     = 0;
+    int64_t  epochRef  = 0;          // wall clock (วินาที) ณ usRef
+    uint64_t usRef     = 0;
+    bool     verbose   = false;      // Serial → stdout
+
+    // ---------- FreeRTOS ----------
+    std::vector<std::unique_ptr<NativeTask>> tasks;
+    NativeTask* current = nullptr;   // task ที่ replayer กำลังรันแทน
+    uint32_t    inDevice = 0;        // > 0: อยู่ใน stand-in ของ hardware (allocation ของโลกจำลอง ไม่ใช่ของ firmware)
+
+    // ---------- esp_timer ----------
+    std::vector<std::unique_ptr<NativeTimer>> timers;
+
+    // ---------- ESP-NOW ----------
+    void (*recvCb)(const uint8_t*, const uint8_t*, int) = nullptr;
+    std::function<void(const uint8_t*, bool)> sentSink;          // ตั้งโดย esp_now_register_send_cb
+    std::vector<NativeSend> sends;
+    std::deque<NativeAck>   acks;
+    uint32_t ackUs        = 1500;    // send → MAC ack
+    uint32_t lossPermille = 0;       // ack FAIL ต่อพัน (deterministic)
+    uint32_t lossAcc      = 0;
+
+    // ---------- DHT (สัญญาณที่ RMT จะเห็นรอบถัดไป) ----------
+    bool    dhtPresent = false;
+    uint8_t dhtBytes[5] = { 0, 0, 0, 0, 0 };   // frame 40 bit ที่ sensor ตอบ
+    std::vector<uint32_t> rmtItems;  // rmt_item32_t.val ของ capture ล่าสุด
+    bool    rmtPending = false;
+
+    // ---------- RTDB ----------
+    std::map<std::string, std::string> rtdb;     // path เต็ม → ค่าแบบ text
+    NativeRtdbStats rtdbStats;
+    bool fbReady = true;                         // false = RTDB หลุด (Firebase.ready())
+    std::function<void(const std::string&, const std::string&)> streamSink;   // ตั้งโดย setStreamCallback
+    std::string streamPath;
+
+    // ---------- wall clock ----------
+    int64_t wallUs() const {
+        return epochRef * 1000000LL + (int64_t)(nowUs - usRef);
+    }
+
+    void setWall(int64_t epoch) {
+        epochRef = epoch;
+        usRef    = nowUs;
+    }
+
+    NativeTask* task(const char* name) {
+        tasks.emplace_back(new NativeTask());
+        tasks.back()->name = name ? name : "";
+        return tasks.back().get();
+    }
+
+    // ---------- deadline ถัดไปของ timer/ack (UINT64_MAX = ไม่มี) ----------
+    uint64_t nextDueUs() const {
+        uint64_t t = UINT64_MAX;
+        for (const auto &p : timers) if (p->armed && p->dueUs < t) t = p->dueUs;
+        for (const auto &a : acks)   if (a.dueUs < t) t = a.dueUs;
+        return t;
+    }
+
+    // ยิง callback ทุกตัวที่ถึงเวลาแล้ว (timer อาจ arm ตัวใหม่ระหว่างนี้)
+    void runDue() {
+        bool again = true;
+        while (again) {
+            again = false;
+            for (size_t i = 0; i < timers.size(); i++) {
+                NativeTimer* t = timers[i].get();
+                if (t->armed && t->dueUs <= nowUs) {
+                    t->armed = false;
+                    t->cb(t->arg);
+                    again = true;
+                }
+            }
+            while (!acks.empty() && acks.front().dueUs <= nowUs) {
+                NativeAck a = acks.front();
+                acks.pop_front();
+                if (sentSink) sentSink(a.mac, a.ok);
+                again = true;
+            }
+        }
+    }
+
+    // ---------- RTDB write จาก gateway → store (+ echo ผ่าน stream เหมือน server จริง) ----------
+    void rtdbWrite(const std::string &path, const std::string &value) {
+        std::string p = (path.empty() || path[0] != '/') ? "/" + path : path;
+        auto it = rtdb.find(p);
+        if (it != rtdb.end() && it->second == value) return;
+        rtdb[p] = value;
+        streamNotify(p, value);
+    }
+
+    void streamNotify(const std::string &path, const std::string &value) {
+        if (!streamSink) return;
+        if (streamPath == "/") {
+            rtdbStats.streamEvents++;
+            streamSink(path, value);
+            return;
+        }
+        size_t n = streamPath.size();
+        if (path.compare(0, n, streamPath) != 0 || path.size() <= n || path[n] != '/') return;
+        rtdbStats.streamEvents++;
+        streamSink(path.substr(n), value);
+    }
+};
+
+inline NativeSim& nativeSim() {
+    static NativeSim s;
+    return s;
+}
+
+// ขอบเขตโค้ดจำลอง hardware (เช่น esp_now_send เก็บ timeline) → ตัวนับ allocation ของ test ข้ามไป
+struct NativeDeviceScope {
+    NativeDeviceScope()  { nativeSim().inDevice++; }
+    ~NativeDeviceScope() { nativeSim().inDevice--; }
+};
@@ -0,0 +1,32 @@
+#ifdef ALLOC_TRACE
+#include <Arduino.h>
+
+// linker: -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc (ดู env:alloc_trace)
+extern "C" {
+    volatile uint32_t gwAllocCount = 0;
+    volatile void*    gwAllocTask  = nullptr;
+
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t n, size_t size);
+    void* __real_realloc(void* p, size_t size);
+
+    static inline void gwCountAlloc() {
+        if (gwAllocTask && gwAllocTask == xTaskGetCurrentTaskHandle()) gwAllocCount = gwAllocCount + 1;
+    }
+
+    void* __wrap_malloc(size_t size) {
+        gwCountAlloc();
+        return __real_malloc(size);
+    }
+
+    void* __wrap_calloc(size_t n, size_t size) {
+        gwCountAlloc();
+        return __real_calloc(n, size);
+    }
+
+    void* __wrap_realloc(void* p, size_t size) {
+        gwCountAlloc();
+        return __real_realloc(p, size);
+    }
+}
+#endif
@@ -1,55 +1,145 @@
 #include <Arduino.h>
 #include <time.h>
+#include <esp_pm.h>
 #include "constant.h"
 #include "gateway.h"
+#include "cloud/cloud_task.h"
 #include "control/control.h"
+#include "lan/server.h"
 #include "audio.h"
 
-// shared กับ gateway.h
-SensorPacket currentSensorData;
-bool isSensorDataNew = false;
+// 1 = control logic เป็น task ที่ตื่นตาม event/deadline, 0 = polling ทุก LOGIC_INTERVAL_MS แบบเดิม
+#ifndef CONTROL_EVENT_DRIVEN
+#define CONTROL_EVENT_DRIVEN 1
+#endif
+
+#ifndef CONTROL_MAX_SLEEP_MS
+#define CONTROL_MAX_SLEEP_MS 1000
+#endif
+
+// ลด clock ตอน idle (DFS 240 ↔ 80 MHz) — ไม่เปิด light sleep / modem sleep
+// เพราะ ESP-NOW ต้องเปิดวิทยุตลอด (sleep = packet จาก Sensor Node หาย)
+#ifndef GATEWAY_PM_DFS
+#define GATEWAY_PM_DFS 1
+#endif
+
+// shared กับ gateway.h (onRecv เขียน mailbox ของแต่ละ node, loop อ่าน snapshot)
+NodeTable nodeTable;
 
 GatewayNetwork    network;
 AudioService      audio;
 EnvSensorService  env;                // <- ใหม่
-ControlLogic      control(&network, &env);
+CloudTask         cloud(&network, &nodeTable);    // Firebase I/O ทั้งหมด (core 0)
+ControlLogic      control(&network, &env, &cloud, &nodeTable);
+LanServer         lan(&cloud.config());               // dashboard บน LAN (core 0)
 
 TaskHandle_t AudioTaskHandle;
+TaskHandle_t ControlTaskHandle;
+
+// ตื่นเมื่อ: ESP-NOW packet เข้า / config เปลี่ยน / ถึง deadline ที่ใกล้ที่สุด
+void ControlTask(void * parameter) {
+    Serial.println("[Control] Task Running on CORE 1");
+    TimerService &timers = control.timers();
+    control.statsDue();                 // arm รอบแรก
+
+    while (true) {
+        unsigned long waitMs = control.msUntilNextDeadline(CONTROL_MAX_SLEEP_MS);
+        timers.idleBegin();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+        timers.idleEnd();
+
+        time_t now = time(nullptr);
+        control.update(now);
+
+        if (control.statsDue()) {
+            control.printLatency();
+            control.reportProfile();
+            network.printLinkStats();
+            network.printBootTimes();
+            timers.printStats();
+            env.printStats();
+            audio.printStats();
+            lan.printStats();
+        }
+    }
+}
 
 void AudioTask(void * parameter) {
     Serial.println("[Audio] Task Running on CORE 0");
     while (true) {
-        audio.loop();
-        vTaskDelay(1);  
+        audio.loop();       // block รอ frame จาก capture task
     }
 }
 
+static void configurePowerSave() {
+#if GATEWAY_PM_DFS && CONFIG_PM_ENABLE
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz       = 240;
+    pm.min_freq_mhz       = 80;
+    pm.light_sleep_enable = false;
+    esp_err_t err = esp_pm_configure(&pm);
+    Serial.printf("[Power] DFS 80-240MHz %s\n", err == ESP_OK ? "on" : "unavailable");
+#endif
+}
+
 void setup() {
     Serial.begin(115200);
     delay(500);
+    configurePowerSave();
 
+    // ESP-NOW + config จาก NVS ขึ้นก่อน → สั่งงานได้เลย, Wi-Fi/NTP/Firebase ตามมาใน cloud task
     network.begin();
+    cloud.begin();
     control.begin();      // ภายในจะเรียก env.begin()
 
+    if (LAN_SERVER_ENABLE) {
+        control.setLan(&lan.feed());
+        lan.begin();          // รอ Wi-Fi ขึ้นก่อนค่อยเปิด port
+    }
+
     if (ENABLE_AUDIO_STREAM) {
         audio.begin();
         xTaskCreatePinnedToCore(
             AudioTask, "AudioTask", 10000,
             NULL, 1, &AudioTaskHandle, 0
         );
+        audio.setSenderTask(AudioTaskHandle);
+    }
+
+    if (CONTROL_EVENT_DRIVEN) {
+        xTaskCreatePinnedToCore(
+            ControlTask, "ControlTask", 8192,
+            NULL, 3, &ControlTaskHandle, 1
+        );
+        network.setWakeTask(ControlTaskHandle);
+        cloud.config().setWakeTask(ControlTaskHandle);
+        env.setWakeTask(ControlTaskHandle);
     }
 
-    configTime(7*3600, 0, "pool.ntp.org");
     Serial.println("\n[System] Boot Completed");
 }
 
 void loop() {
+    if (CONTROL_EVENT_DRIVEN) {
+        vTaskDelete(NULL);   // งานทั้งหมดอยู่ใน ControlTask แล้ว
+        return;
+    }
+
     static unsigned long lastLogic = 0;
+    static unsigned long lastStats = 0;
 
-    if (millis() - lastLogic > LOGIC_INTERVAL_MS) {
+    // config ใหม่จาก stream → รันทันทีไม่ต้องรอรอบ
+    if (control.configPending() || millis() - lastLogic > LOGIC_INTERVAL_MS) {
         lastLogic = millis();
 
         time_t now = time(nullptr);
-        control.update(now, currentSensorData);
+        control.update(now);
+    }
+
+    if (millis() - lastStats > CONTROL_STATS_MS) {
+        lastStats = millis();
+        control.printLatency();
+        control.reportProfile();
+        network.printLinkStats();
     }
 }
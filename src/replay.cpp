@@ -0,0 +1,361 @@
+// ---------- env:native: replay trace ของ input ผ่าน ControlLogic จริงบน Linux ----------
+// trace มาจาก env:trace (LittleFS /trace.bin) หรือ --synth
+// sensor → esp_now recv cb, DHT → frame ที่ RMT จะ capture, config → RTDB stand-in (stream/poll)
+// เวลาเดินด้วย virtual clock: ControlTask/CloudTask ตื่นตาม deadline + notify เหมือนบนบอร์ด
+//
+//   replay [-v] [--ack-us N] [--loss PERMILLE] [--timeline FILE] TRACE
+//   replay --synth TRACE SECONDS
+#ifdef NATIVE_REPLAY
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <Arduino.h>
+#include "constant.h"
+#include "gateway.h"
+#include "cloud/cloud_task.h"
+#include "control/control.h"
+#include "trace/format.h"
+
+#ifndef CONTROL_MAX_SLEEP_MS
+#define CONTROL_MAX_SLEEP_MS 1000
+#endif
+
+#ifndef REPLAY_TAIL_MS
+#define REPLAY_TAIL_MS 5000            // เดินต่อหลัง event สุดท้าย (ให้ timer / ack / outbox จบ)
+#endif
+
+NodeTable nodeTable;
+
+GatewayNetwork    network;
+EnvSensorService  env;
+CloudTask         cloud(&network, &nodeTable);
+ControlLogic      control(&network, &env, &cloud, &nodeTable);
+
+struct ReplayEvent {
+    uint64_t   us;
+    TraceEvent e;
+};
+
+struct ReplayTrace {
+    TraceHeader              hdr;
+    std::vector<ReplayEvent> events;
+};
+
+// ---------- อ่าน trace (us 32 bit → 64 bit ต่อเนื่อง) ----------
+static bool loadTrace(const char* path, ReplayTrace &t) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return false; }
+    std::vector<uint8_t> buf;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) buf.insert(buf.end(), chunk, chunk + n);
+    fclose(f);
+
+    if (!traceHeaderRead(buf.data(), buf.size(), t.hdr)) {
+        fprintf(stderr, "%s: not a trace file\n", path);
+        return false;
+    }
+    if (t.hdr.pktLen != sizeof(SensorPacket))
+        fprintf(stderr, "warning: trace pktLen=%u, build sizeof(SensorPacket)=%u\n",
+                (unsigned)t.hdr.pktLen, (unsigned)sizeof(SensorPacket));
+
+    uint32_t prev = 0;
+    uint64_t us   = t.hdr.startUs;
+    size_t   pos  = TRACE_HDR_LEN;
+    while (pos < buf.size()) {
+        ReplayEvent r;
+        uint32_t before = prev;
+        size_t used = traceDecode(buf.data() + pos, buf.size() - pos, t.hdr.pktLen, prev, r.e);
+        if (used == 0) {
+            fprintf(stderr, "warning: truncated record at offset %u\n", (unsigned)pos);
+            break;
+        }
+        us  += (int64_t)(int32_t)(prev - before);
+        r.us = us;
+        t.events.push_back(r);
+        pos += used;
+    }
+    // dt ติดลบได้ (packet rx ก่อน record ก่อนหน้า) → เรียงตามเวลาก่อนป้อน
+    std::stable_sort(t.events.begin(), t.events.end(),
+                     [](const ReplayEvent &a, const ReplayEvent &b) { return a.us < b.us; });
+    return true;
+}
+
+// ---------- input → stand-in ----------
+static void setDht(float temp, float hum) {
+    NativeSim &s = nativeSim();
+    uint8_t* b = s.dhtBytes;
+#if DHT_TYPE == 11
+    int h10 = (int)lroundf(hum * 10.0f);
+    int t10 = (int)lroundf(fabsf(temp) * 10.0f);
+    b[0] = (uint8_t)(h10 / 10);  b[1] = (uint8_t)(h10 % 10);
+    b[2] = (uint8_t)(t10 / 10);  b[3] = (uint8_t)((t10 % 10) | (temp < 0 ? 0x80 : 0));
+#else
+    uint16_t h10 = (uint16_t)lroundf(hum * 10.0f);
+    uint16_t t10 = (uint16_t)lroundf(fabsf(temp) * 10.0f);
+    b[0] = (uint8_t)(h10 >> 8);  b[1] = (uint8_t)h10;
+    b[2] = (uint8_t)((t10 >> 8) | (temp < 0 ? 0x80 : 0));  b[3] = (uint8_t)t10;
+#endif
+    b[4] = (uint8_t)(b[0] + b[1] + b[2] + b[3]);
+    s.dhtPresent = true;
+}
+
+static std::string hhmm(int m) {
+    if (m < 0) return "";
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%02d:%02d", m / 60, m % 60);
+    return buf;
+}
+
+// เขียนลง RTDB stand-in แบบเดียวกับ dashboard → gateway เห็นผ่าน stream หรือ pollConfig
+static void setConfig(const ControlConfig &c) {
+    NativeSim &s = nativeSim();
+    std::string win;
+    for (uint8_t i = 0; i < c.schedWindowCount; i++) {
+        if (i) win += ",";
+        win += hhmm(c.schedWindows[i].startMin) + "-" + hhmm(c.schedWindows[i].stopMin);
+        if (c.schedWindows[i].days != SCHED_ALL_DAYS) {
+            win += "/";
+            for (int d = 0; d < 7; d++) if (c.schedWindows[i].days & (1 << d)) win += (char)('0' + d);
+        }
+    }
+    s.rtdbWrite(PATH_CTRL_MODE,         controlModeText(c.mode));
+    s.rtdbWrite(PATH_CTRL_MANUAL,       c.manual ? "true" : "false");
+    s.rtdbWrite(PATH_CTRL_TARGET_HUMID, std::to_string(c.targetHumid));
+    s.rtdbWrite(PATH_SCHED_ENABLE,      c.schedEnable ? "true" : "false");
+    s.rtdbWrite(PATH_SCHED_START,       hhmm(c.schedStartMin));
+    s.rtdbWrite(PATH_SCHED_STOP,        hhmm(c.schedStopMin));
+    s.rtdbWrite(PATH_SCHED_WINDOWS,     win);
+}
+
+static void deliver(const TraceEvent &e) {
+    NativeSim &s = nativeSim();
+    switch (e.type) {
+        case TRACE_SENSOR: {
+            uint8_t node, mac[6];
+            SensorPacket p;
+            traceReadSensor(e, node, mac, p);
+            if (s.recvCb) s.recvCb(mac, (const uint8_t*)&p, sizeof(p));
+            break;
+        }
+        case TRACE_ENV: {
+            float t, h;
+            traceReadEnv(e, t, h);
+            setDht(t, h);
+            break;
+        }
+        case TRACE_CONFIG: {
+            ControlConfig c;
+            traceReadConfig(e, c);
+            setConfig(c);
+            break;
+        }
+        case TRACE_TIME:
+            s.setWall(traceReadTime(e));
+            break;
+    }
+}
+
+// ---------- --synth: trace สังเคราะห์ (ความชื้นแกว่งรอบ target + เปลี่ยน config 2 ครั้ง) ----------
+static bool writeSynth(const char* path, uint32_t seconds) {
+    FILE* f = fopen(path, "wb");
+    if (!f) { perror(path); return false; }
+
+    TraceHeader h;
+    h.epoch   = 1760000000UL;           // 2025-10-09 ~16:53 UTC
+    h.startUs = 2000000UL;              // recording เริ่มหลัง boot ~2s
+    uint8_t hdr[TRACE_HDR_LEN];
+    traceHeaderWrite(hdr, h);
+    fwrite(hdr, 1, sizeof(hdr), f);
+
+    uint32_t prev = h.startUs;
+    uint8_t  buf[TRACE_MAX_RECORD];
+    auto put = [&](const TraceEvent &e) { fwrite(buf, 1, traceEncode(e, prev, buf), f); };
+
+    TraceEvent e;
+    traceMakeTime(e, h.startUs, h.epoch);
+    put(e);
+
+    ControlConfig c;
+    c.mode        = MODE_AUTO;
+    c.targetHumid = 60;
+    traceMakeConfig(e, h.startUs + 500000UL, c);
+    put(e);
+
+    for (uint32_t ms = 1000; ms <= seconds * 1000UL; ms += 250) {
+        uint32_t us = h.startUs + ms * 1000UL;
+        if (ms % 1000 == 0) {
+            SensorPacket p = {};
+            p.nodeId       = 0;
+            p.waterPercent = 90 - (int)(ms / 1000 * 80 / seconds);
+            p.waterRaw     = p.waterPercent * 40;
+            p.tiltState    = TILT_NORMAL;
+            p.controlState = false;
+            traceMakeSensor(e, us, 0, SENSOR_NODE_MAC, p);
+            put(e);
+        }
+        if (ms % ENV_POLL_MS == 0) {
+            float hum = 60.0f + 8.0f * sinf(2.0f * (float)M_PI * ms / 120000.0f);
+            traceMakeEnv(e, us, 28.0f, hum);
+            put(e);
+        }
+        if (ms == seconds * 1000UL / 3) {
+            c.mode   = MODE_MANUAL;
+            c.manual = true;
+            traceMakeConfig(e, us, c);
+            put(e);
+        }
+        if (ms == seconds * 2000UL / 3) {
+            c.mode        = MODE_AUTO;
+            c.manual      = false;
+            c.schedEnable = true;
+            c.schedWindowCount = 1;
+            c.schedWindows[0].startMin = 16 * 60 + 50;
+            c.schedWindows[0].stopMin  = 23 * 60;
+            traceMakeConfig(e, us, c);
+            put(e);
+        }
+    }
+    fclose(f);
+    printf("wrote %s (%lu s)\n", path, (unsigned long)seconds);
+    return true;
+}
+
+// ---------- report ----------
+static void printTimeline(FILE* out, uint64_t t0) {
+    for (const NativeSend &s : nativeSim().sends) {
+        CommandPacket c;
+        memcpy(&c, s.data, std::min((size_t)s.len, sizeof(c)));
+        fprintf(out, "%10.3f %02X:%02X:%02X:%02X:%02X:%02X %s\n", (s.us - t0) / 1e6,
+                s.mac[0], s.mac[1], s.mac[2], s.mac[3], s.mac[4], s.mac[5], c.active ? "ON" : "OFF");
+    }
+}
+
+static int usage() {
+    fprintf(stderr, "usage: replay [-v] [--ack-us N] [--loss PERMILLE] [--timeline FILE] TRACE\n"
+                    "       replay --synth TRACE SECONDS\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    NativeSim &sim = nativeSim();
+    const char* tracePath    = nullptr;
+    const char* timelinePath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--synth") {
+            if (i + 2 >= argc) return usage();
+            return writeSynth(argv[i + 1], (uint32_t)strtoul(argv[i + 2], nullptr, 10)) ? 0 : 1;
+        }
+        if (a == "-v")                            sim.verbose = true;
+        else if (a == "--ack-us" && i + 1 < argc) sim.ackUs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (a == "--loss" && i + 1 < argc)   sim.lossPermille = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (a == "--timeline" && i + 1 < argc) timelinePath = argv[++i];
+        else if (a[0] != '-' && !tracePath)       tracePath = argv[i];
+        else return usage();
+    }
+    if (!tracePath) return usage();
+
+    ReplayTrace tr;
+    if (!loadTrace(tracePath, tr)) return 1;
+
+    uint64_t t0 = tr.hdr.startUs;
+    if (!tr.events.empty()) t0 = std::min(t0, tr.events.front().us);
+    sim.nowUs = t0;
+    if (tr.hdr.epoch) sim.setWall(tr.hdr.epoch);
+
+    // ---------- setup() เดียวกับบอร์ด (ไม่มี audio) ----------
+    network.begin();
+    cloud.begin();
+    control.begin();
+
+    NativeTask* ctlTask   = sim.task("ControlTask");
+    NativeTask* cloudTask = cloud.task();
+    network.setWakeTask(ctlTask);
+    cloud.config().setWakeTask(ctlTask);
+    env.setWakeTask(ctlTask);
+
+    uint64_t endUs    = (tr.events.empty() ? t0 : tr.events.back().us) + REPLAY_TAIL_MS * 1000ULL;
+    uint64_t ctlDue   = sim.nowUs;
+    uint64_t cloudDue = sim.nowUs;
+    size_t   next     = 0;
+
+    uint32_t ticks = 0, cloudSteps = 0;
+    double   hostUs = 0, hostMaxUs = 0;
+    auto wall0 = std::chrono::steady_clock::now();
+
+    // ---------- event loop: เดินเวลาไป wake ที่ใกล้สุดของ event / control / cloud / timer ----------
+    while (sim.nowUs < endUs || next < tr.events.size()) {
+        uint64_t t = std::min({ ctlDue, cloudDue, sim.nextDueUs(), endUs });
+        if (next < tr.events.size()) t = std::min(t, tr.events[next].us);
+        if (t > sim.nowUs) sim.nowUs = t;
+
+        while (next < tr.events.size() && tr.events[next].us <= sim.nowUs) deliver(tr.events[next++].e);
+        sim.runDue();
+
+        if (cloudTask->notify || sim.nowUs >= cloudDue) {
+            cloudTask->notify = 0;
+            sim.current = cloudTask;
+            cloud.step();
+            cloudSteps++;
+            cloudDue = sim.nowUs + CLOUD_TASK_IDLE_MS * 1000ULL;
+        }
+
+        if (ctlTask->notify || sim.nowUs >= ctlDue) {
+            ctlTask->notify = 0;
+            sim.current = ctlTask;
+            auto h0 = std::chrono::steady_clock::now();
+            control.update(time(nullptr));
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - h0).count();
+            hostUs += us;
+            hostMaxUs = std::max(hostMaxUs, us);
+            ticks++;
+            // FreeRTOS tick 1 ms: timeout 0 ก็ยังกิน 1 รอบ scheduler
+            unsigned long waitMs = control.msUntilNextDeadline(CONTROL_MAX_SLEEP_MS);
+            ctlDue = sim.nowUs + std::max(waitMs, 1UL) * 1000ULL;
+        }
+        sim.current = nullptr;
+    }
+
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+    double simS  = (sim.nowUs - t0) / 1e6;
+
+    if (sim.verbose) {
+        control.printLatency();
+        control.reportProfile();
+        network.printLinkStats();
+    }
+
+    printf("trace     : %s (%u events, %.1f s simulated)\n", tracePath, (unsigned)tr.events.size(), simS);
+    printf("control   : %u ticks, %.2f us/tick mean, %.2f us max, %.0f ticks/s host\n",
+           ticks, ticks ? hostUs / ticks : 0.0, hostMaxUs, hostUs > 0 ? ticks / (hostUs / 1e6) : 0.0);
+    printf("cloud     : %u steps\n", cloudSteps);
+    printf("replay    : %.3f s host (%.0fx realtime)\n", wallS, wallS > 0 ? simS / wallS : 0.0);
+    printf("esp-now   : %u commands (ack %u us, loss %u/1000)\n",
+           (unsigned)sim.sends.size(), sim.ackUs, sim.lossPermille);
+    printf("rtdb      : patch=%u (%u B) push=%u get=%u set=%u stream=%u/%u\n",
+           sim.rtdbStats.patches, sim.rtdbStats.patchBytes, sim.rtdbStats.pushes, sim.rtdbStats.gets,
+           sim.rtdbStats.sets, sim.rtdbStats.streamBegin, sim.rtdbStats.streamEvents);
+    TelemetrySink& tlm = cloud.telemetry();
+    printf("sink      : %s samples=%u %.1f B/sample calls=%u fail=%u\n", tlm.name(),
+           (unsigned)tlm.sampleCount(), tlm.bytesPerSample(), (unsigned)tlm.roundTrips(),
+           (unsigned)tlm.failures());
+
+    if (timelinePath) {
+        FILE* f = fopen(timelinePath, "w");
+        if (!f) { perror(timelinePath); return 1; }
+        printTimeline(f, t0);
+        fclose(f);
+    } else {
+        printTimeline(stdout, t0);
+    }
+    return 0;
+}
+
+#endif // NATIVE_REPLAY
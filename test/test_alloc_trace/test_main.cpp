@@ -0,0 +1,202 @@
+// ---------- ControlLogic::update() ต้องไม่ allocate หลัง warm-up: pio test -e native -f test_alloc_trace ----------
+// ตัวนับเดียวกับ env:alloc_trace (gwAllocCount / gwAllocTask + AllocScope) แต่ hook malloc ของ glibc แทน --wrap
+// ไม่นับ allocation ใน stand-in ของ hardware (NativeDeviceScope เช่น esp_now_send เก็บ timeline)
+// setup + event loop แบบเดียวกับ src/replay.cpp: ControlTask / CloudTask ตื่นตาม deadline บน virtual clock
+#define ALLOC_TRACE
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include "constant.h"
+#include "gateway.h"
+#include "cloud/cloud_task.h"
+#include "control/control.h"
+
+#ifndef CONTROL_MAX_SLEEP_MS
+#define CONTROL_MAX_SLEEP_MS 1000
+#endif
+
+#define ALLOC_WARMUP_S  60             // boot + config แรก + ทุก timer ได้ fire อย่างน้อยครั้งหนึ่ง
+#define ALLOC_STEADY_S  600
+
+// ---------- ตัวนับ (แทน src/alloc_trace.cpp) ----------
+extern "C" {
+    volatile uint32_t gwAllocCount = 0;
+    volatile void*    gwAllocTask  = nullptr;
+
+#ifdef __GLIBC__
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t n, size_t size);
+    void* __libc_realloc(void* p, size_t size);
+
+    static inline void gwCountAlloc() {
+        if (gwAllocTask && gwAllocTask == xTaskGetCurrentTaskHandle() && !nativeSim().inDevice)
+            gwAllocCount = gwAllocCount + 1;
+    }
+
+    // operator new ของ libstdc++ เรียก malloc → String / std::string / vector ถูกนับด้วย
+    void* malloc(size_t size)             { gwCountAlloc(); return __libc_malloc(size); }
+    void* calloc(size_t n, size_t size)   { gwCountAlloc(); return __libc_calloc(n, size); }
+    void* realloc(void* p, size_t size)   { gwCountAlloc(); return __libc_realloc(p, size); }
+#endif
+}
+
+NodeTable nodeTable;
+
+GatewayNetwork    network;
+EnvSensorService  env;
+CloudTask         cloud(&network, &nodeTable);
+ControlLogic      control(&network, &env, &cloud, &nodeTable);
+
+void setUp() {}
+void tearDown() {}
+
+// ---------- input (เหมือน deliver() ของ replay) ----------
+static void setDht(float temp, float hum) {
+    NativeSim &s = nativeSim();
+    uint8_t* b = s.dhtBytes;
+#if DHT_TYPE == 11
+    int h10 = (int)lroundf(hum * 10.0f);
+    int t10 = (int)lroundf(fabsf(temp) * 10.0f);
+    b[0] = (uint8_t)(h10 / 10);  b[1] = (uint8_t)(h10 % 10);
+    b[2] = (uint8_t)(t10 / 10);  b[3] = (uint8_t)((t10 % 10) | (temp < 0 ? 0x80 : 0));
+#else
+    uint16_t h10 = (uint16_t)lroundf(hum * 10.0f);
+    uint16_t t10 = (uint16_t)lroundf(fabsf(temp) * 10.0f);
+    b[0] = (uint8_t)(h10 >> 8);  b[1] = (uint8_t)h10;
+    b[2] = (uint8_t)((t10 >> 8) | (temp < 0 ? 0x80 : 0));  b[3] = (uint8_t)t10;
+#endif
+    b[4] = (uint8_t)(b[0] + b[1] + b[2] + b[3]);
+    s.dhtPresent = true;
+}
+
+static void sendSensor(int water, uint8_t tilt) {
+    SensorPacket p = {};
+    p.nodeId       = 0;
+    p.waterPercent = water;
+    p.waterRaw     = water * 40;
+    p.tiltState    = tilt;
+    NativeSim &s = nativeSim();
+    if (s.recvCb) s.recvCb(SENSOR_NODE_MAC, (const uint8_t*)&p, sizeof(p));
+}
+
+static void setConfig(const char* mode, bool manual) {
+    NativeSim &s = nativeSim();
+    s.rtdbWrite(PATH_CTRL_MODE,         mode);
+    s.rtdbWrite(PATH_CTRL_MANUAL,       manual ? "true" : "false");
+    s.rtdbWrite(PATH_CTRL_TARGET_HUMID, "60");
+}
+
+// ---------- event loop ----------
+static NativeTask* ctlTask   = nullptr;
+static NativeTask* cloudTask = nullptr;
+static uint64_t    ctlDue = 0, cloudDue = 0;
+
+// เดินเวลา seconds วินาที: sensor ทุก 1 s, ความชื้นแกว่งผ่าน target (relay สลับ), tilt เตือนเป็นช่วง
+static void run(uint32_t seconds) {
+    NativeSim &sim = nativeSim();
+    uint64_t endUs  = sim.nowUs + seconds * 1000000ULL;
+    uint64_t nextIn = sim.nowUs;
+    uint32_t k = 0;
+    while (sim.nowUs < endUs) {
+        uint64_t t = std::min({ ctlDue, cloudDue, sim.nextDueUs(), nextIn, endUs });
+        if (t > sim.nowUs) sim.nowUs = t;
+
+        if (sim.nowUs >= nextIn) {
+            float sec = (float)(sim.nowUs / 1000000ULL);
+            sendSensor(90 - (int)(k % 60), (k / 30) % 7 == 3 ? TILT_WARNING : TILT_NORMAL);
+            setDht(28.0f, 60.0f + 8.0f * sinf(2.0f * (float)M_PI * sec / 120.0f));
+            nextIn += 1000000ULL;
+            k++;
+        }
+        sim.runDue();
+
+        if (cloudTask->notify || sim.nowUs >= cloudDue) {
+            cloudTask->notify = 0;
+            sim.current = cloudTask;
+            cloud.step();
+            cloudDue = sim.nowUs + CLOUD_TASK_IDLE_MS * 1000ULL;
+        }
+        if (ctlTask->notify || sim.nowUs >= ctlDue) {
+            ctlTask->notify = 0;
+            sim.current = ctlTask;
+            control.update(time(nullptr));
+            unsigned long waitMs = control.msUntilNextDeadline(CONTROL_MAX_SLEEP_MS);
+            ctlDue = sim.nowUs + std::max(waitMs, 1UL) * 1000ULL;
+        }
+        sim.current = nullptr;
+    }
+}
+
+static void printStats(const char* phase, const AllocStats &a, uint32_t dirty0, uint32_t ticks0) {
+    printf("%-8s ticks=%lu dirty=%lu last=%lu max=%lu\n", phase, (unsigned long)(a.ticks - ticks0),
+           (unsigned long)(a.dirtyTicks - dirty0), (unsigned long)a.lastTick, (unsigned long)a.maxTick);
+}
+
+// ตัวนับต้องเห็น allocation จริงใน scope ของ task ที่ตั้งไว้ ไม่งั้น test ข้างล่างผ่านได้เพราะนับไม่ได้เลย
+static void test_counter_sees_allocations() {
+#ifndef __GLIBC__
+    TEST_IGNORE_MESSAGE("malloc hook needs glibc; use env:alloc_trace on the board");
+#endif
+    AllocStats st;
+    nativeSim().current = ctlTask;
+    {
+        AllocScope s(st);
+        std::string* v = new std::string(64, 'x');
+        delete v;
+    }
+    {
+        AllocScope s(st);                             // task อื่นไม่นับ
+        nativeSim().current = cloudTask;
+        free(malloc(16));
+        nativeSim().current = ctlTask;
+    }
+    nativeSim().current = nullptr;
+    TEST_ASSERT_EQUAL_UINT32(2, st.ticks);
+    TEST_ASSERT_EQUAL_UINT32(1, st.dirtyTicks);
+    TEST_ASSERT_EQUAL_UINT32(0, st.lastTick);
+}
+
+static void test_update_steady_state_no_alloc() {
+#ifndef __GLIBC__
+    TEST_IGNORE_MESSAGE("malloc hook needs glibc; use env:alloc_trace on the board");
+#endif
+    const AllocStats &a = control.allocations();
+    printf("\n");
+
+    setConfig("auto", false);
+    run(ALLOC_WARMUP_S);
+    printStats("warm-up", a, 0, 0);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, a.ticks);
+
+    uint32_t dirty0 = a.dirtyTicks, ticks0 = a.ticks;
+    run(ALLOC_STEADY_S / 2);
+    // เปลี่ยน config กลางทาง: parse อยู่ฝั่ง CloudTask → update() แค่ copy จาก cache
+    setConfig("manual", true);
+    run(ALLOC_STEADY_S / 2);
+    printStats("steady", a, dirty0, ticks0);
+
+    TEST_ASSERT_GREATER_THAN_UINT32(ALLOC_STEADY_S, a.ticks - ticks0);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, a.dirtyTicks - dirty0, "update() allocated after warm-up");
+}
+
+int main(int, char**) {
+    NativeSim &sim = nativeSim();
+    sim.nowUs = 2000000ULL;
+    sim.setWall(1760000000LL);
+
+    network.begin();
+    cloud.begin();
+    control.begin();
+
+    ctlTask   = sim.task("ControlTask");
+    cloudTask = cloud.task();
+    network.setWakeTask(ctlTask);
+    cloud.config().setWakeTask(ctlTask);
+    env.setWakeTask(ctlTask);
+    ctlDue = cloudDue = sim.nowUs;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_counter_sees_allocations);
+    RUN_TEST(test_update_steady_state_no_alloc);
+    return UNITY_END();
+}
@@ -0,0 +1,222 @@
+// ---------- µ-law / IMA-ADPCM บน host: SNR + encode throughput: pio test -e native -f test_codec ----------
+// ไฟล์อัดจากไมค์จริง: CODEC_WAV_DIR=<dir> → SNR ต่อไฟล์ของทุก *.wav (reader เดียวกับ test_vad)
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include <dirent.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "audio/codec.h"
+#include "../wav_io.h"
+
+#define CODEC_TEST_RATE 16000
+#define CODEC_TEST_N    (CODEC_TEST_RATE * 4)
+
+// เกณฑ์ของไฟล์อัดจริง (ทั้งไฟล์) — ต่ำกว่า sine เพราะมีช่วงดัง/transient ที่ ADPCM ตามไม่ทัน
+#ifndef CODEC_WAV_ULAW_MIN_DB
+#define CODEC_WAV_ULAW_MIN_DB  30.0
+#endif
+#ifndef CODEC_WAV_ADPCM_MIN_DB
+#define CODEC_WAV_ADPCM_MIN_DB 20.0
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+// sine ความถี่ hz ที่ระดับ dbfs
+static std::vector<int16_t> sine(float hz, float dbfs) {
+    std::vector<int16_t> v(CODEC_TEST_N);
+    float a = 32767.0f * powf(10.0f, dbfs / 20.0f);
+    for (size_t i = 0; i < v.size(); i++) v[i] = (int16_t)lrintf(a * sinf(2.0f * (float)M_PI * hz * i / CODEC_TEST_RATE));
+    return v;
+}
+
+// เสียงคล้ายพูด: harmonic ของ f0 ที่เลื่อนช้า ๆ + envelope พยางค์ 4 Hz
+static std::vector<int16_t> voiceLike() {
+    std::vector<int16_t> v(CODEC_TEST_N);
+    float ph = 0;
+    for (size_t i = 0; i < v.size(); i++) {
+        float t   = (float)i / CODEC_TEST_RATE;
+        float f0  = 140.0f + 30.0f * sinf(2.0f * (float)M_PI * 0.7f * t);
+        ph += 2.0f * (float)M_PI * f0 / CODEC_TEST_RATE;
+        float env = 0.15f + 0.85f * fabsf(sinf(2.0f * (float)M_PI * 2.0f * t));
+        float x = 0;
+        for (int h = 1; h <= 12; h++) x += sinf(h * ph) / h;
+        v[i] = (int16_t)lrintf(6000.0f * env * x);
+    }
+    return v;
+}
+
+static double snrDb(const std::vector<int16_t> &ref, const std::vector<int16_t> &out) {
+    double s = 0, e = 0;
+    for (size_t i = 0; i < ref.size(); i++) {
+        double d = (double)ref[i] - out[i];
+        s += (double)ref[i] * ref[i];
+        e += d * d;
+    }
+    return e > 0 ? 10.0 * log10(s / e) : 200.0;
+}
+
+static std::vector<int16_t> ulawRoundTrip(const std::vector<int16_t> &in) {
+    std::vector<uint8_t> enc(in.size());
+    ulawEncodeBlock(in.data(), in.size(), enc.data());
+    std::vector<int16_t> out(in.size());
+    for (size_t i = 0; i < in.size(); i++) out[i] = ulawDecode(enc[i]);
+    return out;
+}
+
+static std::vector<int16_t> adpcmRoundTrip(const std::vector<int16_t> &in) {
+    AdpcmState es, ds;
+    std::vector<uint8_t> enc(audioCodecBytes(AUDIO_CODEC_ADPCM, in.size()));
+    adpcmEncodeBlock(es, in.data(), in.size(), enc.data());
+    std::vector<int16_t> out(in.size());
+    adpcmDecodeBlock(ds, enc.data(), in.size(), out.data());
+    return out;
+}
+
+// ---------- SNR ----------
+static void test_snr() {
+    // ADPCM ที่ 1 kHz ดัง ๆ ติด slope overload (step โตไม่ทัน) → เกณฑ์ต่ำกว่า
+    struct { const char* name; std::vector<int16_t> pcm; double ulawMin, adpcmMin; } sig[] = {
+        { "sine 440 Hz -20 dBFS", sine(440.0f, -20.0f), 36.0, 34.0 },
+        { "sine 1 kHz -6 dBFS",   sine(1000.0f, -6.0f), 34.0, 25.0 },
+        { "voice-like",           voiceLike(),          36.0, 33.0 },
+    };
+    printf("\n%-22s %9s %9s\n", "signal", "ulaw dB", "adpcm dB");
+    for (auto &s : sig) {
+        double u = snrDb(s.pcm, ulawRoundTrip(s.pcm));
+        double a = snrDb(s.pcm, adpcmRoundTrip(s.pcm));
+        printf("%-22s %9.1f %9.1f\n", s.name, u, a);
+        TEST_ASSERT_GREATER_THAN_FLOAT_MESSAGE(s.ulawMin, u, s.name);
+        TEST_ASSERT_GREATER_THAN_FLOAT_MESSAGE(s.adpcmMin, a, s.name);
+    }
+}
+
+// segmental SNR: เฉลี่ยต่อ frame 20 ms ที่ไม่เงียบ (ฟังออกใกล้กว่า SNR รวมที่ช่วงดังครอบงำ)
+static double segSnrDb(const std::vector<int16_t> &ref, const std::vector<int16_t> &out, uint32_t rate) {
+    size_t n = rate / 50;
+    double sum = 0;
+    int frames = 0;
+    for (size_t off = 0; n && off + n <= ref.size(); off += n) {
+        double s = 0, e = 0;
+        for (size_t i = off; i < off + n; i++) {
+            double d = (double)ref[i] - out[i];
+            s += (double)ref[i] * ref[i];
+            e += d * d;
+        }
+        if (s < n * 100.0 * 100.0) continue;       // rms < 100 (-50 dBFS) = เงียบ
+        double db = e > 0 ? 10.0 * log10(s / e) : 60.0;
+        sum += db < -10 ? -10 : (db > 60 ? 60 : db);
+        frames++;
+    }
+    return frames ? sum / frames : 0.0;
+}
+
+// ---------- ไฟล์อัดจริง (ถ้าตั้ง CODEC_WAV_DIR) ----------
+static void test_recorded_wavs() {
+    const char* dirPath = getenv("CODEC_WAV_DIR");
+    if (!dirPath || !*dirPath) TEST_IGNORE_MESSAGE("CODEC_WAV_DIR not set");
+    DIR* d = opendir(dirPath);
+    TEST_ASSERT_NOT_NULL_MESSAGE(d, dirPath);
+    printf("\n%-24s %6s %7s %9s %9s %9s %9s\n", "file", "Hz", "sec", "ulaw dB", "seg dB", "adpcm dB", "seg dB");
+    size_t files = 0;
+    while (dirent* e = readdir(d)) {
+        std::string n = e->d_name;
+        if (n.size() < 5 || n.compare(n.size() - 4, 4, ".wav") != 0) continue;
+        std::vector<int16_t> pcm;
+        uint32_t rate = CODEC_TEST_RATE;
+        TEST_ASSERT_TRUE_MESSAGE(wavRead((std::string(dirPath) + "/" + n).c_str(), pcm, rate), n.c_str());
+        std::vector<int16_t> u = ulawRoundTrip(pcm), a = adpcmRoundTrip(pcm);
+        double us = snrDb(pcm, u), as = snrDb(pcm, a);
+        printf("%-24s %6u %7.1f %9.1f %9.1f %9.1f %9.1f\n", n.c_str(), (unsigned)rate, (double)pcm.size() / rate,
+               us, segSnrDb(pcm, u, rate), as, segSnrDb(pcm, a, rate));
+        TEST_ASSERT_GREATER_THAN_FLOAT_MESSAGE(CODEC_WAV_ULAW_MIN_DB, us, n.c_str());
+        TEST_ASSERT_GREATER_THAN_FLOAT_MESSAGE(CODEC_WAV_ADPCM_MIN_DB, as, n.c_str());
+        files++;
+    }
+    closedir(d);
+    TEST_ASSERT_TRUE_MESSAGE(files > 0, "no *.wav in CODEC_WAV_DIR");
+}
+
+// µ-law: ทุกค่าของ int16 decode กลับได้ภายในครึ่ง step ของ segment ตัวเอง
+static void test_ulaw_error_bound() {
+    for (int32_t x = -32768; x <= 32767; x++) {
+        int32_t c   = x < -ULAW_CLIP ? -ULAW_CLIP : (x > ULAW_CLIP ? ULAW_CLIP : x);
+        int32_t y   = ulawDecode(ulawEncode((int16_t)x));
+        int32_t seg = (ulawEncode((int16_t)x) ^ 0xFF) >> 4 & 7;
+        int32_t tol = 4 << seg;                         // step = 8 << seg
+        if (abs(y - c) > tol) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "x=%ld y=%ld seg=%ld", (long)x, (long)y, (long)seg);
+            TEST_FAIL_MESSAGE(msg);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, ulawDecode(ulawEncode(0)));
+}
+
+// แต่ละ message decode ได้จาก state ใน header อย่างเดียว (message ก่อนหน้าหายก็ไม่ drift)
+static void test_adpcm_message_independent() {
+    std::vector<int16_t> pcm = voiceLike();
+    const size_t n = 512;
+    AdpcmState enc, cont;
+    std::vector<uint8_t> msg(AUDIO_HDR_LEN + audioCodecBytes(AUDIO_CODEC_ADPCM, n));
+    std::vector<int16_t> a(n), b(n);
+    for (size_t off = 0, seq = 0; off + n <= pcm.size(); off += n, seq++) {
+        size_t len = audioEncodeMessage(AUDIO_CODEC_ADPCM, enc, (uint32_t)seq, (uint32_t)off, CODEC_TEST_RATE,
+                                        &pcm[off], n, msg.data());
+        TEST_ASSERT_EQUAL(msg.size(), len);
+
+        AudioHeader h;
+        TEST_ASSERT_TRUE(audioHeaderRead(msg.data(), len, h));
+        TEST_ASSERT_EQUAL(AUDIO_CODEC_ADPCM, h.codec);
+        TEST_ASSERT_EQUAL(n, h.samples);
+        TEST_ASSERT_EQUAL(seq, h.seq);
+        TEST_ASSERT_EQUAL(off, h.offset);
+
+        AdpcmState fresh;
+        fresh.predictor = h.predictor;
+        fresh.index     = h.index;
+        adpcmDecodeBlock(fresh, msg.data() + AUDIO_HDR_LEN, n, a.data());
+        adpcmDecodeBlock(cont, msg.data() + AUDIO_HDR_LEN, n, b.data());
+        TEST_ASSERT_EQUAL_MEMORY(b.data(), a.data(), n * sizeof(int16_t));
+    }
+}
+
+// ---------- throughput (host; ESP32 ช้ากว่าราว 20-40 เท่า ดูจาก realtime factor) ----------
+template <typename Fn>
+static double nsPerSample(size_t n, int reps, Fn fn) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) fn();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / ((double)n * reps);
+}
+
+static void test_encode_throughput() {
+    std::vector<int16_t> pcm = voiceLike();
+    std::vector<uint8_t> out(AUDIO_HDR_LEN + audioCodecBytes(AUDIO_CODEC_PCM16, pcm.size()));
+    const int reps = 50;
+    volatile uint8_t sink = 0;
+
+    printf("\n%-6s %8s %10s %12s\n", "codec", "ns/samp", "Msamp/s", "x realtime");
+    const AudioCodec codecs[] = { AUDIO_CODEC_PCM16, AUDIO_CODEC_ULAW, AUDIO_CODEC_ADPCM };
+    for (AudioCodec c : codecs) {
+        AdpcmState st;
+        double ns = nsPerSample(pcm.size(), reps, [&]() {
+            audioEncodeMessage(c, st, 0, 0, CODEC_TEST_RATE, pcm.data(), pcm.size(), out.data());
+            sink = sink + out[AUDIO_HDR_LEN];
+        });
+        printf("%-6s %8.2f %10.1f %12.0f\n", audioCodecText(c), ns, 1e3 / ns, 1e9 / ns / CODEC_TEST_RATE);
+        // ต้องเร็วกว่า realtime มาก ๆ บน host ไม่งั้นบน ESP32 ไม่มีทางทัน
+        TEST_ASSERT_LESS_THAN_FLOAT_MESSAGE(1e9 / CODEC_TEST_RATE / 100, ns, audioCodecText(c));
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_snr);
+    RUN_TEST(test_ulaw_error_bound);
+    RUN_TEST(test_adpcm_message_independent);
+    RUN_TEST(test_encode_throughput);
+    RUN_TEST(test_recorded_wavs);
+    return UNITY_END();
+}
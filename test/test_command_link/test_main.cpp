@@ -0,0 +1,106 @@
+// ---------- CommandLink: adaptive RTO / backoff / Karn บน host: pio test -e native -f test_command_link ----------
+#include <Arduino.h>
+#include <unity.h>
+#include "command_link.h"
+
+void setUp() {}
+void tearDown() {}
+
+// ack ครบ n ครั้ง RTT คงที่ → estimator นิ่ง
+static uint32_t warm(CommandLink &l, uint32_t &now, int n, uint32_t rttUs) {
+    for (int i = 0; i < n; i++) {
+        l.beginCommand(true, now);
+        now += rttUs;
+        l.onStatus(true, now);
+        now += 100000;
+    }
+    return l.rtoUs();
+}
+
+// ยังไม่มี RTT sample: callback หาย → ส่งซ้ำที่ LINK_RTO_INIT_US แล้ว x2 (ไม่ใช่ LINK_RTO_MAX_US)
+static void test_lost_callback_uses_initial_rto() {
+    CommandLink l;
+    uint32_t now = 1000, t0 = now;
+    bool st;
+    l.beginCommand(true, now);
+    TEST_ASSERT_EQUAL_UINT32(LINK_RTO_INIT_US, l.usUntilRetransmit(now));
+    TEST_ASSERT_FALSE(l.retransmitDue(t0 + LINK_RTO_INIT_US - 1, st));
+    TEST_ASSERT_TRUE(l.retransmitDue(t0 + LINK_RTO_INIT_US, st));
+    TEST_ASSERT_TRUE(st);
+    now = t0 + LINK_RTO_INIT_US;
+    TEST_ASSERT_EQUAL_UINT32(LINK_RTO_INIT_US * 2, l.usUntilRetransmit(now));
+}
+
+// มี RTT แล้ว: timeout = rto ที่คำนวณ (clamp) และ backoff x2 ทุกครั้งที่ยังเงียบ จนครบ LINK_MAX_TRIES
+static void test_lost_callback_uses_measured_rto() {
+    CommandLink l;
+    uint32_t now = 1000;
+    uint32_t rto = warm(l, now, 16, 1500);
+    TEST_ASSERT_LESS_THAN(LINK_RTO_INIT_US, rto);
+    TEST_ASSERT_GREATER_OR_EQUAL(LINK_RTO_MIN_US, rto);
+
+    bool st;
+    l.beginCommand(false, now);
+    uint32_t wait = rto;
+    for (int tries = 1; tries < LINK_MAX_TRIES; tries++) {
+        TEST_ASSERT_EQUAL_UINT32(wait, l.usUntilRetransmit(now));
+        TEST_ASSERT_FALSE(l.retransmitDue(now + wait - 1, st));
+        now += wait;
+        TEST_ASSERT_TRUE(l.retransmitDue(now, st));
+        TEST_ASSERT_FALSE(st);
+        wait = wait * 2 > LINK_RTO_MAX_US ? LINK_RTO_MAX_US : wait * 2;
+    }
+    now += wait;
+    TEST_ASSERT_FALSE(l.retransmitDue(now, st));     // ครบแล้ว → เลิก
+    TEST_ASSERT_FALSE(l.pending());
+    TEST_ASSERT_EQUAL_UINT32(1, l.stats().gaveUp);
+    TEST_ASSERT_EQUAL_UINT32(LINK_MAX_TRIES - 1, l.stats().retransmits);
+}
+
+// Karn: callback ที่มาหลังส่งซ้ำแล้ว (ไม่รู้ว่าเป็นของ frame ไหน) ไม่ถูกใช้วัด RTT
+static void test_karn_ignores_retransmitted_sample() {
+    CommandLink l;
+    uint32_t now = 1000;
+    uint32_t rto  = warm(l, now, 16, 1500);
+    uint32_t srtt = l.srttUs();
+
+    bool st;
+    l.beginCommand(true, now);
+    now += rto;
+    TEST_ASSERT_TRUE(l.retransmitDue(now, st));
+    now += 50000;                                   // ack มาช้ามาก (ของตัวแรกหรือตัวที่สองก็ได้)
+    l.onStatus(true, now);
+    TEST_ASSERT_FALSE(l.pending());
+    TEST_ASSERT_EQUAL_UINT32(srtt, l.srttUs());
+    TEST_ASSERT_EQUAL_UINT32(rto, l.rtoUs());
+}
+
+// FAIL: backoff x2 ครั้งเดียวต่อ FAIL (onStatus) ไม่ x2 ซ้ำตอนส่งซ้ำ
+static void test_fail_backoff_doubles_once() {
+    CommandLink l;
+    uint32_t now = 1000;
+    uint32_t rto = warm(l, now, 16, 1500);
+
+    bool st;
+    l.beginCommand(true, now);
+    now += 1500;
+    l.onStatus(false, now);
+    TEST_ASSERT_EQUAL_UINT32(2 * rto - 1500, l.usUntilRetransmit(now));
+    now += 2 * rto - 1500;
+    TEST_ASSERT_TRUE(l.retransmitDue(now, st));
+    now += 1500;
+    l.onStatus(false, now);
+    TEST_ASSERT_EQUAL_UINT32(4 * rto - 1500, l.usUntilRetransmit(now));
+    now += 100;
+    l.onStatus(true, now);                          // ไม่มี frame ค้าง → ไม่กระทบ
+    TEST_ASSERT_TRUE(l.pending());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lost_callback_uses_initial_rto);
+    RUN_TEST(test_lost_callback_uses_measured_rto);
+    RUN_TEST(test_karn_ignores_retransmitted_sample);
+    RUN_TEST(test_fail_backoff_doubles_once);
+    return UNITY_END();
+}
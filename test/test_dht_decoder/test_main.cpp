@@ -0,0 +1,201 @@
+// ---------- dhtDecode บน host กับ pulse trace: pio test -e native -f test_dht_decoder ----------
+// trace สังเคราะห์ตาม timing ใน datasheet (DHT11 / DHT22) + jitter ในช่วงที่วัดได้จากตัวจริง
+// รูปแบบเดียวกับที่ DhtRmt::collect() ได้จาก RMT: [pull-up] LOW 80 HIGH 80 (LOW 50 HIGH 26|70) x40 LOW 50 [idle]
+// trace ที่อัดจากบอร์ดจริง: DHT_TRACE_DIR=<dir> → ทุก *.txt ("level us" ต่อบรรทัด, "# expect <model> <temp> <hum>")
+#include <Arduino.h>
+#include <unity.h>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include "sensor/dht_decoder.h"
+
+void setUp() {}
+void tearDown() {}
+
+typedef std::vector<DhtEdge> Trace;
+
+static uint32_t rng = 99;
+static int jitter(int lo, int hi) {    // uniform lo..hi
+    rng = rng * 1664525u + 1013904223u;
+    return lo + (int)((rng >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+struct Timing {
+    int lowLo, lowHi;                  // LOW ก่อนแต่ละ bit
+    int zeroLo, zeroHi;                // HIGH ของ bit 0
+    int oneLo, oneHi;                  // HIGH ของ bit 1
+};
+
+// DHT22/AM2302: LOW 50, '0' 26-28, '1' 70 — ตัวจริงคลาดได้ราว ±5us
+static const Timing DHT22_T = { 46, 56, 22, 32, 66, 76 };
+// DHT11: LOW 50-54, '0' 24, '1' 70-71 (clock ภายในคลาดกว่า)
+static const Timing DHT11_T = { 48, 58, 20, 30, 64, 76 };
+
+static Trace makeTrace(const uint8_t b[5], const Timing &t, bool pullUp = true, int idleUs = 0) {
+    Trace tr;
+    if (pullUp) tr.push_back({ 1, (uint16_t)jitter(20, 40) });       // host ปล่อยขา → pull-up ก่อน sensor ตอบ
+    tr.push_back({ 0, (uint16_t)jitter(78, 85) });
+    tr.push_back({ 1, (uint16_t)jitter(78, 88) });
+    for (int i = 0; i < 40; i++) {
+        bool one = (b[i / 8] >> (7 - i % 8)) & 1;
+        tr.push_back({ 0, (uint16_t)jitter(t.lowLo, t.lowHi) });
+        tr.push_back({ 1, (uint16_t)(one ? jitter(t.oneLo, t.oneHi) : jitter(t.zeroLo, t.zeroHi)) });
+    }
+    tr.push_back({ 0, (uint16_t)jitter(t.lowLo, t.lowHi) });
+    if (idleUs) tr.push_back({ 1, (uint16_t)idleUs });                // RMT บางรุ่นบันทึก idle HIGH ตัวสุดท้ายด้วย
+    return tr;
+}
+
+static void bytes22(float temp, float hum, uint8_t b[5]) {
+    int h = (int)lrintf(hum * 10), t = (int)lrintf(fabsf(temp) * 10);
+    b[0] = (uint8_t)(h >> 8); b[1] = (uint8_t)h;
+    b[2] = (uint8_t)((t >> 8) | (temp < 0 ? 0x80 : 0)); b[3] = (uint8_t)t;
+    b[4] = (uint8_t)(b[0] + b[1] + b[2] + b[3]);
+}
+
+static void bytes11(int tempInt, int tempDec, int hum, uint8_t b[5], bool negative = false) {
+    b[0] = (uint8_t)hum; b[1] = 0;
+    b[2] = (uint8_t)tempInt; b[3] = (uint8_t)(tempDec | (negative ? 0x80 : 0));
+    b[4] = (uint8_t)(b[0] + b[1] + b[2] + b[3]);
+}
+
+static DhtStatus decode(const Trace &t, int model, DhtReading &r) {
+    // copy ลง heap พอดีความยาว → อ่านเกินท้าย trace ASan จับได้
+    DhtEdge* e = (DhtEdge*)malloc(sizeof(DhtEdge) * (t.empty() ? 1 : t.size()));
+    if (!t.empty()) memcpy(e, t.data(), sizeof(DhtEdge) * t.size());
+    DhtStatus s = dhtDecode(e, t.size(), model, r);
+    free(e);
+    return s;
+}
+
+static void expectOk(const Trace &t, int model, float temp, float hum, const char* what) {
+    DhtReading r;
+    DhtStatus s = decode(t, model, r);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("OK", dhtStatusText(s), what);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0.051f, temp, r.temp, what);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0.051f, hum, r.hum, what);
+}
+
+// ---------- ค่าถูกต้อง ----------
+static void test_dht22_values() {
+    static const float v[][2] = { { 25.3f, 61.0f }, { -10.1f, 35.5f }, { 0.0f, 0.0f }, { 79.9f, 100.0f },
+                                  { -40.0f, 5.2f }, { 0.1f, 99.9f }, { 12.8f, 25.6f } };
+    uint8_t b[5];
+    for (auto &x : v) {
+        bytes22(x[0], x[1], b);
+        for (int rep = 0; rep < 200; rep++) expectOk(makeTrace(b, DHT22_T), DHT_MODEL_22, x[0], x[1], "dht22");
+    }
+}
+
+static void test_dht11_values() {
+    uint8_t b[5];
+    bytes11(24, 0, 55, b);
+    for (int rep = 0; rep < 200; rep++) expectOk(makeTrace(b, DHT11_T), DHT_MODEL_11, 24.0f, 55.0f, "dht11");
+    bytes11(24, 6, 41, b);
+    expectOk(makeTrace(b, DHT11_T), DHT_MODEL_11, 24.6f, 41.0f, "dht11 decimal");
+    bytes11(1, 3, 80, b, true);
+    expectOk(makeTrace(b, DHT11_T), DHT_MODEL_11, -1.3f, 80.0f, "dht11 negative");
+}
+
+// ---------- รูปแบบ trace ที่ RMT อาจให้ ----------
+static void test_trace_shapes() {
+    uint8_t b[5];
+    bytes22(21.7f, 48.2f, b);
+    expectOk(makeTrace(b, DHT22_T, false), DHT_MODEL_22, 21.7f, 48.2f, "no pull-up edge");
+    expectOk(makeTrace(b, DHT22_T, true, 200), DHT_MODEL_22, 21.7f, 48.2f, "idle HIGH at end");   // = DHT_IDLE_US
+    expectOk(makeTrace(b, DHT22_T, true, 65535), DHT_MODEL_22, 21.7f, 48.2f, "idle HIGH saturated");
+
+    // glitch/noise ก่อน response (เช่น ขา float ตอน release)
+    Trace t = makeTrace(b, DHT22_T);
+    t.insert(t.begin(), { { 1, 3 }, { 0, 2 }, { 1, 500 } });
+    expectOk(t, DHT_MODEL_22, 21.7f, 48.2f, "leading junk");
+}
+
+// ขอบ threshold: '0' ยาวสุด / '1' สั้นสุดที่ยังแยกได้
+static void test_bit_margins() {
+    uint8_t b[5];
+    bytes22(33.3f, 77.7f, b);
+    const Timing wide = { 40, 65, 10, DHT_BIT_THRESHOLD_US, DHT_BIT_THRESHOLD_US + 1, 100 };
+    for (int rep = 0; rep < 500; rep++) expectOk(makeTrace(b, wide), DHT_MODEL_22, 33.3f, 77.7f, "margins");
+}
+
+// ---------- error ----------
+static void expectStatus(const Trace &t, int model, DhtStatus want, const char* what) {
+    DhtReading r;
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(dhtStatusText(want), dhtStatusText(decode(t, model, r)), what);
+}
+
+static void test_errors() {
+    uint8_t b[5];
+    bytes22(25.0f, 50.0f, b);
+    Trace good = makeTrace(b, DHT22_T);
+
+    expectStatus(Trace(), DHT_MODEL_22, DHT_ERR_SHORT, "empty (no sensor)");
+    expectStatus(Trace(good.begin(), good.begin() + 3), DHT_MODEL_22, DHT_ERR_SHORT, "response only");
+    // หลุดกลาง frame: ขาด bit ท้าย → HIGH ของ response ถูกนับเป็น bit → ค่าเลื่อน → checksum ไม่ผ่าน หรือ SHORT
+    {
+        Trace t(good.begin(), good.end() - 21);
+        DhtReading r;
+        DhtStatus s = decode(t, DHT_MODEL_22, r);
+        TEST_ASSERT_TRUE_MESSAGE(s == DHT_ERR_SHORT || s == DHT_ERR_PULSE || s == DHT_ERR_CHECKSUM, "truncated");
+    }
+
+    Trace t = good;
+    t[t.size() - 4].us = (uint16_t)(t[t.size() - 4].us > DHT_BIT_THRESHOLD_US ? 26 : 70);   // bit checksum พลิก
+    expectStatus(t, DHT_MODEL_22, DHT_ERR_CHECKSUM, "flipped bit");
+
+    t = good;
+    t[20].us = 150;                                                    // HIGH ค้างกลาง frame
+    expectStatus(t, DHT_MODEL_22, DHT_ERR_PULSE, "stretched pulse");
+    t = good;
+    t[20].us = 4;
+    expectStatus(t, DHT_MODEL_22, DHT_ERR_PULSE, "runt pulse");
+
+    uint8_t bad[5] = { 0x03, 0xE9, 0x00, 0xFA, 0 };                  // hum 100.1%
+    bad[4] = (uint8_t)(bad[0] + bad[1] + bad[2] + bad[3]);
+    expectStatus(makeTrace(bad, DHT22_T), DHT_MODEL_22, DHT_ERR_RANGE, "out of range");
+}
+
+// ---------- trace จากบอร์ดจริง (ถ้ามี) ----------
+static void test_recorded_traces() {
+    const char* dirPath = getenv("DHT_TRACE_DIR");
+    if (!dirPath || !*dirPath) TEST_IGNORE_MESSAGE("DHT_TRACE_DIR not set");
+    DIR* d = opendir(dirPath);
+    TEST_ASSERT_TRUE_MESSAGE(d != nullptr, dirPath);
+    int files = 0;
+    while (dirent* ent = readdir(d)) {
+        std::string n = ent->d_name;
+        if (n.size() < 5 || n.compare(n.size() - 4, 4, ".txt") != 0) continue;
+        FILE* f = fopen((std::string(dirPath) + "/" + n).c_str(), "r");
+        TEST_ASSERT_TRUE_MESSAGE(f != nullptr, n.c_str());
+        Trace t;
+        int model = DHT_MODEL_22;
+        float temp = NAN, hum = NAN;
+        char line[96];
+        while (fgets(line, sizeof(line), f)) {
+            unsigned lv, us;
+            if (sscanf(line, "# expect %d %f %f", &model, &temp, &hum) >= 1) continue;
+            if (sscanf(line, "%u %u", &lv, &us) == 2) t.push_back({ (uint8_t)(lv != 0), (uint16_t)us });
+        }
+        fclose(f);
+        DhtReading r;
+        DhtStatus s = decode(t, model, r);
+        printf("%-24s DHT%d %3u edges %-8s %.1f C %.1f %%\n", n.c_str(), model, (unsigned)t.size(),
+               dhtStatusText(s), r.temp, r.hum);
+        if (!isnan(temp)) expectOk(t, model, temp, hum, n.c_str());
+        files++;
+    }
+    closedir(d);
+    TEST_ASSERT_TRUE_MESSAGE(files > 0, "no *.txt in DHT_TRACE_DIR");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_dht22_values);
+    RUN_TEST(test_dht11_values);
+    RUN_TEST(test_trace_shapes);
+    RUN_TEST(test_bit_margins);
+    RUN_TEST(test_errors);
+    RUN_TEST(test_recorded_traces);
+    return UNITY_END();
+}
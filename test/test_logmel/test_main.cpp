@@ -0,0 +1,157 @@
+// ---------- log-mel fixed-point เทียบ referenceFloat บน host: pio test -e native -f test_logmel ----------
+#define LOGMEL_FLOAT_REF
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "audio/logmel.h"
+
+void setUp() {}
+void tearDown() {}
+
+static LogMel mel;                     // ตารางใหญ่ → ไม่ไว้บน stack
+
+static uint32_t rng = 7;
+static float noise1() {
+    rng = rng * 1664525u + 1013904223u;
+    return (int32_t)rng / 2147483648.0f;
+}
+
+static void sine(int16_t* x, float hz, float amp, float phase = 0.3f) {
+    for (int n = 0; n < LOGMEL_WIN; n++) x[n] = (int16_t)lrintf(amp * sinf(2.0f * (float)M_PI * hz * n / LOGMEL_RATE + phase));
+}
+
+// ---------- ความต่าง (หน่วย log2 = 3.01 dB) แยกตามระยะจาก band ที่ดังสุดของ frame ----------
+// error ของ fixed-point โตขึ้นเมื่อ band เบากว่า peak มาก (quantization ของ FFT int32)
+// band ที่ต่ำกว่า peak เกิน 80 dB: fixed-point ตัดเป็น floor หรือเหลือ noise ~-100 dB → ตรวจแค่ว่าไม่ดังเกิน -80 dB
+struct Tol {
+    float nearMax;                     // band ภายใน 40 dB ของ peak
+    float midMax;                      // 40..80 dB
+};
+
+struct Err {
+    float nearMax  = 0, midMax = 0;
+    int   farBands = 0;
+    float farDown  = 999;              // band ที่ fixed-point ดังสุดในกลุ่มนั้น ต่ำกว่า peak กี่ dB
+};
+
+static Err compare(const char* name, const int16_t* x) {
+    int16_t q[LOGMEL_BANDS];
+    float   r[LOGMEL_BANDS];
+    mel.compute(x, q);
+    LogMel::referenceFloat(x, r);
+    float peak = -1e9f;
+    for (float v : r) if (v > peak) peak = v;
+    Err e;
+    for (int b = 0; b < LOGMEL_BANDS; b++) {
+        float d    = fabsf(q[b] / 256.0f - r[b]);
+        float down = (peak - r[b]) * 3.0103f;              // dB ต่ำกว่า peak
+        if (down <= 40.0f)      { if (d > e.nearMax) e.nearMax = d; }
+        else if (down <= 80.0f) { if (d > e.midMax)  e.midMax  = d; }
+        else {
+            e.farBands++;
+            float qDown = (peak - q[b] / 256.0f) * 3.0103f;
+            if (qDown < e.farDown) e.farDown = qDown;
+        }
+    }
+    printf("%-24s %9.4f %9.4f %5d %8.1f\n", name, e.nearMax, e.midMax, e.farBands, e.farBands ? e.farDown : 0.0f);
+    return e;
+}
+
+static void check(const char* name, const int16_t* x, const Tol &t) {
+    Err e = compare(name, x);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT_MESSAGE(t.nearMax, e.nearMax, name);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT_MESSAGE(t.midMax, e.midMax, name);
+    TEST_ASSERT_GREATER_OR_EQUAL_FLOAT_MESSAGE(80.0f - t.midMax * 3.0103f, e.farDown, name);   // ขอบ 80 dB + error ของช่วงกลาง
+}
+
+static void test_matches_float_reference() {
+    const Tol tol = { 0.02f, 0.35f };              // ~0.06 dB / ~1 dB
+    int16_t x[LOGMEL_WIN];
+    char name[40];
+    printf("\n%-24s %9s %9s %5s %8s\n", "frame", "<=40dB", "40-80dB", ">80", "far_dB");
+
+    static const float freqs[] = { 100.0f, 440.0f, 1000.0f, 2500.0f, 5000.0f, 7800.0f };
+    static const float amps[]  = { 32000.0f, 3000.0f, 100.0f };
+    for (float f : freqs) {
+        for (float a : amps) {
+            sine(x, f, a);
+            snprintf(name, sizeof(name), "sine %.0f Hz a=%.0f", f, a);
+            check(name, x, tol);
+        }
+    }
+
+    for (int n = 0; n < LOGMEL_WIN; n++) x[n] = (int16_t)lrintf(8000.0f * noise1());
+    check("white noise", x, tol);
+
+    for (int n = 0; n < LOGMEL_WIN; n++) x[n] = (int16_t)lrintf(30.0f * noise1());
+    check("quiet noise a=30", x, tol);
+
+    // สระ: harmonic ของ 150 Hz ลาดลง + noise พื้น
+    for (int n = 0; n < LOGMEL_WIN; n++) {
+        float v = 0;
+        for (int h = 1; h <= 40; h++) v += sinf(2.0f * (float)M_PI * 150.0f * h * n / LOGMEL_RATE) * 6000.0f / h;
+        x[n] = (int16_t)lrintf(v * 0.5f + 20.0f * noise1());
+    }
+    check("voiced 150 Hz", x, tol);
+
+    // full scale + clip (ขอบบนของ block exponent)
+    for (int n = 0; n < LOGMEL_WIN; n++) x[n] = (n / 20) & 1 ? 32767 : -32768;
+    check("square full scale", x, tol);
+}
+
+static void test_silence_and_impulse() {
+    int16_t x[LOGMEL_WIN] = {};
+    int16_t q[LOGMEL_BANDS];
+    mel.compute(x, q);
+    for (int b = 0; b < LOGMEL_BANDS; b++) TEST_ASSERT_EQUAL(LOGMEL_FLOOR_Q8, q[b]);
+
+    // sample เดียว = 1 LSB (ต่ำสุดที่ block exponent ต้องขยายขึ้นมาก)
+    x[LOGMEL_WIN / 2] = 1;
+    Err e = compare("impulse 1 LSB", x);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(0.02f, e.nearMax);
+}
+
+// push() ทีละ hop ได้ frame เดียวกับ compute() บน 400 sample ล่าสุด
+static void test_push_matches_compute() {
+    std::vector<int16_t> s(LOGMEL_HOP * 12);
+    for (size_t n = 0; n < s.size(); n++) s[n] = (int16_t)lrintf(5000.0f * sinf(0.07f * n) + 200.0f * noise1());
+    int16_t a[LOGMEL_BANDS], b[LOGMEL_BANDS];
+    mel.reset();
+    int frames = 0;
+    for (size_t off = 0; off + LOGMEL_HOP <= s.size(); off += LOGMEL_HOP) {
+        if (!mel.push(&s[off], a)) continue;
+        frames++;
+        mel.compute(&s[off + LOGMEL_HOP - LOGMEL_WIN], b);
+        TEST_ASSERT_EQUAL_MEMORY(b, a, sizeof(a));
+    }
+    TEST_ASSERT_EQUAL(12 - (LOGMEL_WIN + LOGMEL_HOP - 1) / LOGMEL_HOP + 1, frames);
+}
+
+static void test_frame_cost() {
+    int16_t x[LOGMEL_WIN], q[LOGMEL_BANDS];
+    float   r[LOGMEL_BANDS];
+    for (int n = 0; n < LOGMEL_WIN; n++) x[n] = (int16_t)lrintf(8000.0f * noise1());
+    volatile int16_t sink = 0;
+
+    const int reps = 2000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) { mel.compute(x, q); sink = sink + q[i % LOGMEL_BANDS]; }
+    double fixUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / reps;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; i++) LogMel::referenceFloat(x, r);
+    double refUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / 20;
+    printf("\nfixed-point %.2f us/frame (%.0fx realtime @10ms hop), float DFT reference %.0f us/frame\n",
+           fixUs, 10000.0 / fixUs, refUs);
+}
+
+int main(int, char**) {
+    mel.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_float_reference);
+    RUN_TEST(test_silence_and_impulse);
+    RUN_TEST(test_push_matches_compute);
+    RUN_TEST(test_frame_cost);
+    return UNITY_END();
+}
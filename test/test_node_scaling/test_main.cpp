@@ -0,0 +1,199 @@
+// ---------- ต้นทุน ControlLogic::update() ต่อ tick ตามจำนวน node: pio test -e native -f test_node_scaling ----------
+// setup + event loop แบบเดียวกับ src/replay.cpp (virtual clock) แต่ทุก node ส่ง SensorPacket ทุก 1 s
+// เพิ่ม node ทีละช่วงแบบ allow-list (NodeTable::add ก่อนรับ packet) แล้ววัดเฉพาะเวลาใน update()
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include "constant.h"
+#include "gateway.h"
+#include "cloud/cloud_task.h"
+#include "control/control.h"
+
+#ifndef CONTROL_MAX_SLEEP_MS
+#define CONTROL_MAX_SLEEP_MS 1000
+#endif
+
+#define SCALING_WINDOW_S 120           // เวลาจำลองต่อจุดวัด (heartbeat / mismatch / push ครบหลายรอบ)
+
+NodeTable nodeTable;
+
+GatewayNetwork    network;
+EnvSensorService  env;
+CloudTask         cloud(&network, &nodeTable);
+ControlLogic      control(&network, &env, &cloud, &nodeTable);
+
+void setUp() {}
+void tearDown() {}
+
+static NativeTask* ctlTask   = nullptr;
+static NativeTask* cloudTask = nullptr;
+static uint64_t    ctlDue = 0, cloudDue = 0;
+
+static void macOf(uint8_t i, uint8_t mac[6]) {
+    if (i == 0) { memcpy(mac, SENSOR_NODE_MAC, 6); return; }
+    const uint8_t m[6] = { 0x24, 0x6F, 0x28, 0xA0, 0x00, i };
+    memcpy(mac, m, 6);
+}
+
+struct Window {
+    uint32_t ticks  = 0;
+    uint32_t stats  = 0;               // statsDue() เป็น true (ControlTask พิมพ์ stats / reportProfile)
+    double   hostUs = 0;
+    double   maxUs  = 0;
+};
+
+// เดินเวลา seconds วินาที: node i ส่งเหลื่อมกัน i*37 ms, ความชื้นแกว่งผ่าน target (relay สลับ)
+static Window run(uint32_t seconds) {
+    NativeSim &sim = nativeSim();
+    Window w;
+    uint64_t endUs  = sim.nowUs + seconds * 1000000ULL;
+    uint8_t  count  = nodeTable.count();
+    std::vector<uint64_t> nextIn(count);
+    for (uint8_t i = 0; i < count; i++) nextIn[i] = sim.nowUs + i * 37000ULL;
+    uint64_t nextEnv = sim.nowUs;
+
+    while (sim.nowUs < endUs) {
+        uint64_t t = std::min({ ctlDue, cloudDue, sim.nextDueUs(), nextEnv, endUs });
+        for (uint64_t n : nextIn) t = std::min(t, n);
+        if (t > sim.nowUs) sim.nowUs = t;
+
+        for (uint8_t i = 0; i < count; i++) {
+            if (sim.nowUs < nextIn[i]) continue;
+            SensorPacket p = {};
+            p.nodeId       = i;
+            p.waterPercent = 80 - (int)((sim.nowUs / 1000000ULL + i) % 50);
+            p.waterRaw     = p.waterPercent * 40;
+            p.tiltState    = TILT_NORMAL;
+            uint8_t mac[6];
+            macOf(i, mac);
+            if (sim.recvCb) sim.recvCb(mac, (const uint8_t*)&p, sizeof(p));
+            nextIn[i] += 1000000ULL;
+        }
+        if (sim.nowUs >= nextEnv) {
+            float sec = (float)(sim.nowUs / 1000000ULL);
+            float hum = 60.0f + 8.0f * sinf(2.0f * (float)M_PI * sec / 60.0f);
+            uint8_t* b = sim.dhtBytes;
+#if DHT_TYPE == 11
+            b[0] = (uint8_t)hum; b[1] = 0; b[2] = 28; b[3] = 0;
+#else
+            uint16_t h10 = (uint16_t)lroundf(hum * 10.0f);
+            b[0] = (uint8_t)(h10 >> 8); b[1] = (uint8_t)h10; b[2] = (uint8_t)(280 >> 8); b[3] = (uint8_t)280;
+#endif
+            b[4] = (uint8_t)(b[0] + b[1] + b[2] + b[3]);
+            sim.dhtPresent = true;
+            nextEnv += 1000000ULL;
+        }
+        sim.runDue();
+
+        if (cloudTask->notify || sim.nowUs >= cloudDue) {
+            cloudTask->notify = 0;
+            sim.current = cloudTask;
+            cloud.step();
+            cloudDue = sim.nowUs + CLOUD_TASK_IDLE_MS * 1000ULL;
+        }
+        if (ctlTask->notify || sim.nowUs >= ctlDue) {
+            ctlTask->notify = 0;
+            sim.current = ctlTask;
+            auto h0 = std::chrono::steady_clock::now();
+            control.update(time(nullptr));
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - h0).count();
+            w.hostUs += us;
+            w.maxUs = std::max(w.maxUs, us);
+            w.ticks++;
+            if (control.statsDue()) w.stats++;
+            unsigned long waitMs = control.msUntilNextDeadline(CONTROL_MAX_SLEEP_MS);
+            ctlDue = sim.nowUs + std::max(waitMs, 1UL) * 1000ULL;
+        }
+        sim.current = nullptr;
+    }
+    return w;
+}
+
+static void test_tick_cost_vs_nodes() {
+    NativeSim &sim = nativeSim();
+    static const uint8_t steps[] = { 1, 2, 4, 8, 12, 16, GATEWAY_MAX_NODES };
+    double perNode1 = 0;
+
+    sim.rtdbWrite(PATH_CTRL_MODE, "auto");
+    sim.rtdbWrite(PATH_CTRL_TARGET_HUMID, "60");
+    run(10);                                       // config แรก + timer ทุกตัว arm แล้ว
+
+    printf("\n%5s %7s %9s %9s %11s %9s\n", "nodes", "ticks", "us/tick", "max_us", "us/tick/nd", "cmd/nd/s");
+    for (uint8_t n : steps) {
+        while (nodeTable.count() < n) {
+            uint8_t mac[6];
+            macOf(nodeTable.count(), mac);
+            TEST_ASSERT_NOT_EQUAL(NodeTable::NONE, nodeTable.add(mac, false));
+        }
+        run(10);                                   // node ใหม่ได้ packet แรก + คำสั่งแรก
+
+        size_t sends0 = sim.sends.size();
+        Window w = run(SCALING_WINDOW_S);
+        double perTick = w.hostUs / w.ticks;
+        double perNode = perTick / n;
+        if (n == 1) perNode1 = perNode;
+
+        // ทุก node ต้องได้คำสั่ง (heartbeat) ในช่วงวัด → update() วนครบทุก slot จริง
+        std::vector<uint32_t> cmds(n, 0);
+        for (size_t k = sends0; k < sim.sends.size(); k++) {
+            for (uint8_t i = 0; i < n; i++) {
+                uint8_t mac[6];
+                macOf(i, mac);
+                if (memcmp(sim.sends[k].mac, mac, 6) == 0) { cmds[i]++; break; }
+            }
+        }
+        uint32_t minCmds = *std::min_element(cmds.begin(), cmds.end());
+        printf("%5u %7lu %9.2f %9.2f %11.3f %9.2f\n", n, (unsigned long)w.ticks, perTick, w.maxUs, perNode,
+               (double)(sim.sends.size() - sends0) / n / SCALING_WINDOW_S);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(SCALING_WINDOW_S * 1000 / CMD_HEARTBEAT_MS / 2, minCmds);
+
+        // ต้นทุนต่อ node ต้องไม่โตตามจำนวน node (ไม่มี O(n^2) เช่น find() ใน loop) — เผื่อ noise ของ host 3 เท่า
+        TEST_ASSERT_LESS_OR_EQUAL_FLOAT(perNode1 * 3.0f, (float)perNode);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, nodeTable.rejectedCount());
+}
+
+// ครบ GATEWAY_MAX_NODES แล้ว slot ของ stats ต้องยังอยู่ → ตื่นมาพิมพ์ stats ตรงรอบ
+static void test_stats_timer_with_full_table() {
+    TEST_ASSERT_EQUAL_UINT8(0, control.timers().droppedCount());
+    Window w = run(CONTROL_STATS_MS * 5 / 1000);
+    TEST_ASSERT_EQUAL_UINT32(5, w.stats);
+}
+
+// NODE_AUTO_LEARN ปิด (default): MAC ที่ไม่อยู่ใน table ส่งมาก็ไม่ได้ slot
+static void test_unknown_mac_ignored() {
+#if NODE_AUTO_LEARN
+    TEST_IGNORE_MESSAGE("built with NODE_AUTO_LEARN=1");
+#endif
+    NativeSim &sim = nativeSim();
+    uint8_t before = nodeTable.count();
+    const uint8_t stranger[6] = { 0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0x01 };
+    SensorPacket p = {};
+    if (sim.recvCb) sim.recvCb(stranger, (const uint8_t*)&p, sizeof(p));
+    TEST_ASSERT_EQUAL(before, nodeTable.count());
+    TEST_ASSERT_EQUAL(NodeTable::NONE, nodeTable.find(stranger));
+}
+
+int main(int, char**) {
+    NativeSim &sim = nativeSim();
+    sim.nowUs = 2000000ULL;
+    sim.setWall(1760000000LL);
+
+    network.begin();
+    cloud.begin();
+    control.begin();
+
+    ctlTask   = sim.task("ControlTask");
+    cloudTask = cloud.task();
+    network.setWakeTask(ctlTask);
+    cloud.config().setWakeTask(ctlTask);
+    env.setWakeTask(ctlTask);
+    ctlDue = cloudDue = sim.nowUs;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_unknown_mac_ignored);
+    RUN_TEST(test_tick_cost_vs_nodes);
+    RUN_TEST(test_stats_timer_with_full_table);
+    return UNITY_END();
+}
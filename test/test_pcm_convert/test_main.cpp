@@ -0,0 +1,153 @@
+// ---------- pcm_convert บน host: ทุก variant ตรงกับ Ref ทุก bit + samples/s: pio test -e native -f test_pcm_convert ----------
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "audio/pcm_convert.h"
+
+void setUp() {}
+void tearDown() {}
+
+typedef void (*PcmFn)(const int32_t*, int16_t*, size_t, const PcmConvertCfg&);
+
+struct Variant {
+    const char* name;
+    PcmFn       fn;
+};
+
+static const Variant VARIANTS[] = {
+    { "portable", pcmConvertPortable },
+#if defined(PCM_HAVE_SSE2)
+    { "sse2",     pcmConvertSse2 },
+#endif
+#if defined(PCM_HAVE_NEON)
+    { "neon",     pcmConvertNeon },
+#endif
+    { "dispatch", pcmConvert },
+};
+
+static uint32_t rng = 1;
+static int32_t rand32() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (int32_t)rng;
+}
+
+// ค่าขอบปนค่าสุ่ม (ทั้งแบบ MSB-aligned 24-bit และเต็ม 32-bit)
+static void fill(int32_t* p, size_t n) {
+    static const int32_t edge[] = { 0, 1, -1, INT32_MAX, INT32_MIN, 32767 << 14, -(32768 << 14),
+                                    (32767 << 14) + (1 << 14), -(32768 << 14) - 1, 0x7FFFFF00, -0x7FFFFF00 };
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = (uint32_t)rand32();
+        if (r % 5 == 0)      p[i] = edge[(r >> 8) % (sizeof(edge) / sizeof(edge[0]))];
+        else if (r % 5 == 1) p[i] = rand32();
+        else                 p[i] = (int32_t)((uint32_t)rand32() & 0xFFFFFF00u);   // ไมค์ I2S: 24-bit ชิดซ้าย
+    }
+}
+
+// input ยาวพอดี n*stride บน heap (อ่านเกิน → ASan), output มี canary ท้าย (เขียนเกิน)
+static void checkOne(const PcmConvertCfg &c, size_t n) {
+    int32_t* in  = (int32_t*)malloc(sizeof(int32_t) * (n ? n * c.stride : 1));
+    fill(in, n * c.stride);
+    std::vector<int16_t> ref(n + 1, 0x5A5A);
+    pcmConvertRef(in, ref.data(), n, c);
+    for (const Variant &v : VARIANTS) {
+        int16_t* out = (int16_t*)malloc(sizeof(int16_t) * (n + 1));
+        out[n] = 0x5A5A;
+        v.fn(in, out, n, c);
+        if (memcmp(out, ref.data(), n * sizeof(int16_t)) != 0 || out[n] != 0x5A5A) {
+            size_t k = 0;
+            while (k < n && out[k] == ref[k]) k++;
+            char msg[160];
+            snprintf(msg, sizeof(msg), "%s n=%u ch=%u stride=%u shift=%u gain=%u: [%u] in=%ld got %d want %d",
+                     v.name, (unsigned)n, c.channel, c.stride, c.shift, c.gain, (unsigned)k,
+                     k < n ? (long)in[k * c.stride + c.channel] : 0L, k < n ? out[k] : out[n],
+                     k < n ? ref[k] : 0x5A5A);
+            free(out);
+            free(in);
+            TEST_FAIL_MESSAGE(msg);
+        }
+        free(out);
+    }
+    free(in);
+}
+
+static void test_bit_exact() {
+    static const size_t   lens[]   = { 0, 1, 2, 7, 8, 9, 15, 16, 17, 31, 160, 161, 1023 };
+    static const uint8_t  shifts[] = { 0, 1, 8, 13, 14, 15, 16, 24, 31 };
+    static const uint16_t gains[]  = { PCM_GAIN_UNITY, 1, 128, 300, 1000, PCM_GAIN_MAX };
+    static const uint8_t  strides[] = { 1, 2, 4 };
+    for (size_t n : lens)
+        for (uint8_t sh : shifts)
+            for (uint16_t g : gains)
+                for (uint8_t st : strides)
+                    for (uint8_t ch = 0; ch < st && ch < 2; ch++) {
+                        PcmConvertCfg c;
+                        c.channel = ch;
+                        c.stride  = st;
+                        c.shift   = sh;
+                        c.gain    = g;
+                        checkOne(c, n);
+                    }
+}
+
+// ทุกค่าที่ให้ผลต่างกันของ 18 bit บนสุด (shift 14 ค่า default) ผ่าน sat16 ตรงกับ ref
+static void test_bit_exact_exhaustive_default() {
+    PcmConvertCfg c;
+    const size_t n = 1u << 18;
+    std::vector<int32_t> in(n * 2);
+    for (size_t i = 0; i < n; i++) {
+        in[2 * i]     = (int32_t)((uint32_t)i << 14);
+        in[2 * i + 1] = (int32_t)(((uint32_t)i << 14) | 0x3FFF);
+    }
+    std::vector<int16_t> ref(n), out(n);
+    for (uint8_t ch = 0; ch < 2; ch++) {
+        c.channel = ch;
+        pcmConvertRef(in.data(), ref.data(), n, c);
+        for (const Variant &v : VARIANTS) {
+            v.fn(in.data(), out.data(), n, c);
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(ref.data(), out.data(), n * sizeof(int16_t), v.name);
+        }
+    }
+}
+
+// ---------- samples/s ต่อ variant (block ละ AUDIO_BLOCK_SAMPLES = 160 แบบ loop จริง) ----------
+static void test_throughput() {
+    const size_t n = 160, blocks = 4096;
+    std::vector<int32_t> in(n * 2 * blocks);
+    fill(in.data(), in.size());
+    std::vector<int16_t> out(n);
+    volatile int16_t sink = 0;
+    PcmConvertCfg c;
+
+    struct Row { const char* name; PcmFn fn; } rows[sizeof(VARIANTS) / sizeof(VARIANTS[0]) + 1];
+    rows[0] = { "ref", pcmConvertRef };
+    for (size_t i = 0; i < sizeof(VARIANTS) / sizeof(VARIANTS[0]); i++) rows[i + 1] = { VARIANTS[i].name, VARIANTS[i].fn };
+
+    printf("\n%-9s %9s %9s %8s   (dispatch = %s)\n", "variant", "ns/samp", "Msamp/s", "vs ref", pcmConvertVariant());
+    double refNs = 0;
+    for (const Row &r : rows) {
+        double best = 1e30;
+        for (int rep = 0; rep < 5; rep++) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (size_t b = 0; b < blocks; b++) {
+                r.fn(&in[b * n * 2], out.data(), n, c);
+                sink = sink + out[b % n];
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count()
+                        / (double)(n * blocks);
+            if (ns < best) best = ns;
+        }
+        if (!refNs) refNs = best;
+        printf("%-9s %9.3f %9.1f %7.2fx\n", r.name, best, 1e3 / best, refNs / best);
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bit_exact);
+    RUN_TEST(test_bit_exact_exhaustive_default);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
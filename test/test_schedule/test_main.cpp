@@ -0,0 +1,172 @@
+// ---------- schedule parser / ScheduleEngine บน host: pio test -e native -f test_schedule ----------
+#include <Arduino.h>
+#include <unity.h>
+#include "control/schedule.h"
+
+void setUp() {}
+void tearDown() {}
+
+// copy ลง heap พอดีความยาว → อ่านเกิน '\0' แล้ว ASan / valgrind จับได้
+static uint8_t parseExact(const char* text, SchedWindow* out, uint8_t max) {
+    size_t n = strlen(text) + 1;
+    char* s = (char*)malloc(n);
+    memcpy(s, text, n);
+    uint8_t r = schedParseWindows(s, out, max);
+    free(s);
+    return r;
+}
+
+// ---------- parser ----------
+static void test_parse_windows() {
+    SchedWindow w[SCHED_MAX_WINDOWS];
+    TEST_ASSERT_EQUAL(2, parseExact("07:00-09:00/12345, 18:30-01:00", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(0x3E, w[0].days);
+    TEST_ASSERT_EQUAL(7 * 60, w[0].startMin);
+    TEST_ASSERT_EQUAL(9 * 60, w[0].stopMin);
+    TEST_ASSERT_EQUAL(SCHED_ALL_DAYS, w[1].days);
+    TEST_ASSERT_EQUAL(18 * 60 + 30, w[1].startMin);
+    TEST_ASSERT_EQUAL(60, w[1].stopMin);
+
+    TEST_ASSERT_EQUAL(2, parseExact("6:5 - 7:05;08:00-09:00/06", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(6 * 60 + 5, w[0].startMin);
+    TEST_ASSERT_EQUAL(0x41, w[1].days);
+}
+
+static void test_parse_truncated() {
+    static const char* cut[] = {
+        "0", "07", "07:", "07:0", "07:00", "07:00 ", "07:00-", "07:00-0", "07:00-09",
+        "07:00-09:", "07:00 -", ":", "-", "/", ",", "", "  ;  ",
+    };
+    SchedWindow w[SCHED_MAX_WINDOWS];
+    for (const char* s : cut) {
+        TEST_ASSERT_EQUAL_MESSAGE(0, parseExact(s, w, SCHED_MAX_WINDOWS), s);
+    }
+    // window ที่ถูกตัดอยู่ท้าย ไม่กระทบ window ก่อนหน้า
+    TEST_ASSERT_EQUAL(1, parseExact("07:00-09:00, 10", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(1, parseExact("07:00-09:00,10:00-1", w, SCHED_MAX_WINDOWS));
+}
+
+static void test_parse_rejects() {
+    SchedWindow w[SCHED_MAX_WINDOWS];
+    TEST_ASSERT_EQUAL(0, parseExact("24:00-09:00", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(0, parseExact("07:60-09:00", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(0, parseExact("007:00-09:00", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(0, parseExact("99999999999999999999:00-09:00", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(0, parseExact("07:00-09:00/", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(0, parseExact("07.00-09.00", w, SCHED_MAX_WINDOWS));
+    TEST_ASSERT_EQUAL(1, parseExact("xx, 07:00-09:00", w, SCHED_MAX_WINDOWS));
+}
+
+static void test_parse_max() {
+    SchedWindow w[3];
+    TEST_ASSERT_EQUAL(3, parseExact("01:00-02:00,03:00-04:00,05:00-06:00,07:00-08:00", w, 3));
+    TEST_ASSERT_EQUAL(5 * 60, w[2].startMin);
+}
+
+// ---------- ScheduleEngine เทียบกับ predicate เดิม (start/stop เดียว ทุกวัน) ----------
+// ก่อน multi-window: inSchedule() ดูแค่นาทีของวัน, start > stop = ข้ามเที่ยงคืน
+static bool legacyInWindow(int startMin, int stopMin, int nowMin) {
+    if (startMin < 0 || stopMin < 0) return false;
+    if (startMin <= stopMin) return nowMin >= startMin && nowMin < stopMin;
+    return nowMin >= startMin || nowMin < stopMin;
+}
+
+static void compileSingle(ScheduleEngine &e, int startMin, int stopMin) {
+    SchedWindow w;
+    w.startMin = startMin;
+    w.stopMin  = stopMin;
+    e.compile(&w, 1);
+}
+
+static bool engineAt(const ScheduleEngine &e, int weekMin) {
+    int32_t until;
+    return e.lookup((uint16_t)weekMin, until);
+}
+
+// ทุกคู่ start/stop: ผลต้องตรงกันที่ขอบทุกด้าน (predicate เดิมเปลี่ยนค่าได้แค่ที่ start / stop)
+static void test_engine_matches_legacy_all_pairs() {
+    ScheduleEngine e;
+    for (int s = 0; s < SCHED_DAY_MIN; s++) {
+        for (int t = 0; t < SCHED_DAY_MIN; t++) {
+            compileSingle(e, s, t);
+            const int probe[] = { 0, s - 1, s, s + 1, t - 1, t, t + 1, SCHED_DAY_MIN - 1 };
+            for (int d = 0; d < 7; d++) {
+                for (int m : probe) {
+                    if (m < 0 || m >= SCHED_DAY_MIN) continue;
+                    if (engineAt(e, d * SCHED_DAY_MIN + m) != legacyInWindow(s, t, m)) {
+                        char msg[96];
+                        snprintf(msg, sizeof(msg), "start=%d stop=%d day=%d min=%d", s, t, d, m);
+                        TEST_FAIL_MESSAGE(msg);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// grid หยาบกว่าแต่ไล่ทุกนาทีของสัปดาห์
+static void test_engine_matches_legacy_every_minute() {
+    ScheduleEngine e;
+    for (int s = 0; s < SCHED_DAY_MIN; s += 30) {
+        for (int t = 0; t < SCHED_DAY_MIN; t += 30) {
+            compileSingle(e, s, t);
+            for (int m = 0; m < SCHED_WEEK_MIN; m++) {
+                if (engineAt(e, m) != legacyInWindow(s, t, m % SCHED_DAY_MIN)) {
+                    char msg[96];
+                    snprintf(msg, sizeof(msg), "start=%d stop=%d weekMin=%d", s, t, m);
+                    TEST_FAIL_MESSAGE(msg);
+                }
+            }
+        }
+    }
+}
+
+// evaluate() (localtime_r + cache) เทียบ predicate เดิมที่อ่าน localtime_r เอง
+// + เวลาถึง transition ต้องตรงกับจุดที่ predicate เดิมเปลี่ยนค่าจริง
+static void checkEvaluate(const char* tz) {
+    setenv("TZ", tz, 1);
+    tzset();
+    static const int pairs[][2] = {
+        { 7 * 60, 9 * 60 }, { 22 * 60, 6 * 60 }, { 0, 23 * 60 + 59 }, { 23 * 60 + 59, 0 },
+        { 12 * 60, 12 * 60 }, { 0, 1 },
+    };
+    const time_t t0 = 1760000000;               // ตั้งต้นกลางสัปดาห์ (ไม่ตรงต้นนาที)
+    for (const auto &p : pairs) {
+        ScheduleEngine e;
+        compileSingle(e, p[0], p[1]);
+        auto legacyAt = [&](time_t t) {
+            struct tm lt;
+            localtime_r(&t, &lt);
+            return legacyInWindow(p[0], p[1], lt.tm_hour * 60 + lt.tm_min);
+        };
+        for (time_t now = t0; now < t0 + 8 * 86400L; now += 37) {
+            bool in = e.evaluate(now);
+            if (in != legacyAt(now)) {
+                char msg[96];
+                snprintf(msg, sizeof(msg), "%s start=%d stop=%d t=%ld", tz, p[0], p[1], (long)now);
+                TEST_FAIL_MESSAGE(msg);
+            }
+            long d = e.secondsToNextTransition(now);
+            if (d < 0) continue;
+            TEST_ASSERT_TRUE_MESSAGE(d == 0 || legacyAt(now + d - 1) == in, "flips before next edge");
+            TEST_ASSERT_TRUE_MESSAGE(legacyAt(now + d) != in, "no flip at next edge");
+        }
+    }
+}
+
+static void test_evaluate_matches_legacy() {
+    checkEvaluate("UTC0");
+    checkEvaluate("ICT-7");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_windows);
+    RUN_TEST(test_parse_truncated);
+    RUN_TEST(test_parse_rejects);
+    RUN_TEST(test_parse_max);
+    RUN_TEST(test_engine_matches_legacy_all_pairs);
+    RUN_TEST(test_engine_matches_legacy_every_minute);
+    RUN_TEST(test_evaluate_matches_legacy);
+    return UNITY_END();
+}
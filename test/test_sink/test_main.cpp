@@ -0,0 +1,247 @@
+// ---------- RtdbBatch vs MqttSink บน sample ชุดเดียวกัน: pio test -e native -f test_sink ----------
+// MQTT ต่อ broker จิ๋วใน process (thread) — หรือ Mosquitto จริง: MQTT_BROKER=127.0.0.1:1883
+// RTDB ใช้ Firebase stand-in ของ native/ → นับได้แค่ JSON ของ PATCH (ไม่มี HTTP/TLS)
+#include <Arduino.h>
+#include <unity.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "cloud/batch.h"
+#include "cloud/mqtt_sink.h"
+#include "sensor/telemetry.h"
+
+#ifndef SINK_TEST_NODES
+#define SINK_TEST_NODES 4
+#endif
+
+#ifndef SINK_TEST_SECONDS
+#define SINK_TEST_SECONDS 600          // เวลาจำลอง
+#endif
+
+#ifndef SINK_TEST_PERIOD_MS
+#define SINK_TEST_PERIOD_MS 500        // แต่ละ node ส่ง sample ทุกเท่านี้
+#endif
+
+// ---------- broker จิ๋ว: CONNACK / PUBACK / PINGRESP + นับสิ่งที่ได้รับ ----------
+class LoopbackBroker {
+private:
+    int               lfd = -1;
+    std::thread       th;
+    std::atomic<bool> stop{false};
+
+    static bool readFull(int fd, uint8_t* p, size_t n) {
+        while (n) {
+            ssize_t r = ::recv(fd, p, n, 0);
+            if (r <= 0) return false;
+            p += r;
+            n -= (size_t)r;
+        }
+        return true;
+    }
+
+    void serve(int fd) {
+        std::string body;
+        while (!stop) {
+            pollfd pf = { fd, POLLIN, 0 };
+            if (::poll(&pf, 1, 20) <= 0) continue;
+            uint8_t hdr;
+            if (!readFull(fd, &hdr, 1)) return;
+            uint32_t rem = 0, mul = 1;
+            uint8_t  b;
+            do {
+                if (!readFull(fd, &b, 1)) return;
+                rem += (b & 0x7F) * mul;
+                mul <<= 7;
+            } while (b & 0x80);
+            body.resize(rem);
+            if (rem && !readFull(fd, (uint8_t*)&body[0], rem)) return;
+
+            uint8_t type = hdr >> 4;
+            if (type == 1) {                                   // CONNECT
+                static const uint8_t ack[4] = { 0x20, 0x02, 0x00, 0x00 };
+                ::send(fd, ack, sizeof(ack), MSG_NOSIGNAL);
+            } else if (type == 3) {                            // PUBLISH
+                size_t tl  = ((uint8_t)body[0] << 8) | (uint8_t)body[1];
+                size_t off = 2 + tl;
+                uint8_t qos = (hdr >> 1) & 3;
+                if (qos) {
+                    uint8_t ack[4] = { 0x40, 0x02, (uint8_t)body[off], (uint8_t)body[off + 1] };
+                    ::send(fd, ack, sizeof(ack), MSG_NOSIGNAL);
+                    off += 2;
+                }
+                std::string payload = body.substr(off);
+                publishes++;
+                for (size_t i = 0; (i = payload.find("{\"p\":", i)) != std::string::npos; i++) records++;
+                if (payload.front() != '{' || payload.back() != '}') badPayloads++;
+            } else if (type == 12) {                           // PINGREQ
+                static const uint8_t pong[2] = { 0xD0, 0x00 };
+                ::send(fd, pong, sizeof(pong), MSG_NOSIGNAL);
+            }
+        }
+    }
+
+public:
+    std::atomic<uint32_t> publishes{0}, records{0}, badPayloads{0};
+    uint16_t port = 0;
+
+    bool start() {
+        lfd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in a = {};
+        a.sin_family      = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t n = sizeof(a);
+        if (lfd < 0 || ::bind(lfd, (sockaddr*)&a, n) != 0 || ::listen(lfd, 2) != 0) return false;
+        ::getsockname(lfd, (sockaddr*)&a, &n);
+        port = ntohs(a.sin_port);
+        th = std::thread([this]() {
+            while (!stop) {
+                pollfd pf = { lfd, POLLIN, 0 };
+                if (::poll(&pf, 1, 20) <= 0) continue;
+                int fd = ::accept(lfd, nullptr, nullptr);
+                if (fd < 0) continue;
+                serve(fd);
+                ::close(fd);
+            }
+        });
+        return true;
+    }
+
+    ~LoopbackBroker() {
+        stop = true;
+        if (th.joinable()) th.join();
+        if (lfd >= 0) ::close(lfd);
+    }
+};
+
+// ---------- sample ชุดเดียวกันสำหรับทั้งสอง sink ----------
+struct SinkRun {
+    uint32_t samples = 0;
+    double   encUs   = 0;                // emit ลง buffer ของ sink
+    double   ioUs    = 0;                // service + flush (PATCH / PUBLISH / รอ PUBACK)
+};
+
+static void nodePrefix(char* out, size_t n, int node) {
+    snprintf(out, n, "/nodes/02000000%04x", node);
+}
+
+// sample ของ node: field ที่เปลี่ยนตามรอบ (mask แบบเดียวกับ dirty ของ SENSOR_SCHEMA) + env ทุก 4 รอบ
+static SinkRun drive(TelemetrySink& sink) {
+    SinkRun r;
+    const uint32_t all = (1u << TLM_COUNT(SENSOR_TLM_FIELDS)) - 1;
+    const int rounds = SINK_TEST_SECONDS * 1000 / SINK_TEST_PERIOD_MS;
+    char pre[32];
+    for (int i = 0; i < rounds; i++) {
+        delay(SINK_TEST_PERIOD_MS);
+        auto h0 = std::chrono::steady_clock::now();
+        sink.service();
+        auto h1 = std::chrono::steady_clock::now();
+        for (int node = 0; node < SINK_TEST_NODES; node++) {
+            SensorPacket p = {};
+            p.waterPercent = (i * 7 + node * 13) % 101;
+            p.waterRaw     = 1200 + (i * 31 + node) % 2800;
+            p.tiltState    = (uint8_t)((i / 50 + node) % 3);
+            p.controlState = (i / 20 + node) & 1;
+            p.keyPress     = (i % 97 == 0) ? 'A' : 0;
+            uint32_t mask = (i % 30 == 0) ? all : (1u | 2u);     // refresh เต็มเป็นระยะ ที่เหลือแค่น้ำ
+            if (i % 50 == 0) mask |= 4u | 8u;
+            nodePrefix(pre, sizeof(pre), node);
+            sink.sampleBegin();
+            sensorTlmEmit(sink, (const char*)&p, mask, pre);
+            sink.sampleEnd();
+            r.samples++;
+        }
+        if (i % 4 == 0) {
+            EnvSample e = { 28.0f + (i % 40) * 0.1f, 60.0f + (i % 25) };
+            sink.sampleBegin();
+            envTlmEmit(sink, (const char*)&e, 3u, nullptr);
+            sink.sampleEnd();
+            r.samples++;
+        }
+        auto h2 = std::chrono::steady_clock::now();
+        sink.flush();
+        auto h3 = std::chrono::steady_clock::now();
+        r.encUs += std::chrono::duration<double, std::micro>(h2 - h1).count();
+        r.ioUs  += std::chrono::duration<double, std::micro>((h1 - h0) + (h3 - h2)).count();
+    }
+    return r;
+}
+
+static void report(const char* name, const SinkRun& r, TelemetrySink& s, float wire, const char* note) {
+    double simS = SINK_TEST_SECONDS;
+    printf("%-5s %7u %7.1f %9.0f %8.1f %10.1f %8.1f %6u %9.1f  %s\n", name, (unsigned)r.samples,
+           r.samples / simS, r.samples / (r.encUs / 1e6) / 1e3, r.ioUs / 1e3, s.bytesPerSample(), wire,
+           (unsigned)s.roundTrips(), s.roundTrips() ? (float)r.samples / s.roundTrips() : 0.0f, note);
+}
+
+static void test_sinks_side_by_side() {
+    // ---------- RTDB ----------
+    NativeSim& sim = nativeSim();
+    sim.rtdbStats = NativeRtdbStats();
+    RtdbClient rtdb;
+    rtdb.begin();
+    RtdbBatch batch;
+    batch.attach(&rtdb);
+    SinkRun rr = drive(batch);
+    TEST_ASSERT_EQUAL_UINT32(0, batch.failures());
+    TEST_ASSERT_EQUAL_UINT32(rr.samples, batch.sampleCount());
+    TEST_ASSERT_EQUAL_UINT32(sim.rtdbStats.patches, batch.roundTrips());
+    float rtdbWire = (float)sim.rtdbStats.patchBytes / rr.samples;
+
+    // ---------- MQTT ----------
+    LoopbackBroker broker;
+    const char* ext = getenv("MQTT_BROKER");
+    std::string host = "127.0.0.1";
+    uint16_t port;
+    if (ext && *ext) {
+        std::string e(ext);
+        size_t c = e.rfind(':');
+        host = e.substr(0, c);
+        port = c == std::string::npos ? 1883 : (uint16_t)atoi(e.c_str() + c + 1);
+    } else {
+        TEST_ASSERT_TRUE_MESSAGE(broker.start(), "loopback broker");
+        port = broker.port;
+    }
+
+    MqttSink mqtt;
+    mqtt.setServer(host.c_str(), port);
+    for (int i = 0; i < 300 && !mqtt.ready(); i++) {
+        mqtt.service();
+        delay(10);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(mqtt.ready(), "no CONNACK");
+
+    SinkRun mr = drive(mqtt);
+    delay(MQTT_BATCH_MS);
+    for (int i = 0; i < 500 && (mqtt.acked() < mqtt.roundTrips() || mqtt.bytesPerSample() == 0); i++) {
+        mqtt.service();
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL_UINT32(rr.samples, mr.samples);
+    TEST_ASSERT_EQUAL_UINT32(0, mqtt.failures());
+    TEST_ASSERT_EQUAL_UINT32(mqtt.roundTrips(), mqtt.acked());
+
+    printf("\nsink  samples  samp/s  encode    io_ms  payload_B   wire_B  calls  samp/call\n");
+    printf("                 (sim)  kSamp/s   (host)    /sample  /sample\n");
+    report("rtdb", rr, batch, rtdbWire, "(wire = PATCH JSON, no HTTP/TLS)");
+    report("mqtt", mr, mqtt, mqtt.wireBytesPerSample(), ext && *ext ? ext : "(loopback broker)");
+
+    if (ext && *ext) return;
+    // ทุก PUBLISH ถึง broker ครบ, ทุก sample มี record ของตัวเอง (batch ที่แยกก้อนเพิ่มได้แค่ record)
+    TEST_ASSERT_EQUAL_UINT32(mqtt.roundTrips(), broker.publishes.load());
+    TEST_ASSERT_EQUAL_UINT32(0, broker.badPayloads.load());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(mr.samples, broker.records.load());
+    // batch ของ MQTT ต้องคุ้มกว่า PATCH ต่อ sample (ไม่มี path เต็มซ้ำทุก field)
+    TEST_ASSERT_LESS_THAN_FLOAT(rtdbWire, mqtt.wireBytesPerSample());
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sinks_side_by_side);
+    return UNITY_END();
+}
@@ -0,0 +1,126 @@
+// ---------- env:profile: reportProfile() ตามรอบ stats → /diagnostics/control/<stage>: pio test -e native -f test_stage_profile ----------
+// loop เดียวกับ ControlTask ใน main.cpp (update → statsDue → reportProfile) บน virtual clock แบบ src/replay.cpp
+// host: micros() เป็นเวลาจำลอง (ไม่เดินใน update()) → ตรวจจำนวน n / path / รอบ ไม่ใช่ค่า ns
+#define STAGE_PROFILE
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include "constant.h"
+#include "gateway.h"
+#include "cloud/cloud_task.h"
+#include "control/control.h"
+
+#ifndef CONTROL_MAX_SLEEP_MS
+#define CONTROL_MAX_SLEEP_MS 1000
+#endif
+
+NodeTable nodeTable;
+
+GatewayNetwork    network;
+EnvSensorService  env;
+CloudTask         cloud(&network, &nodeTable);
+ControlLogic      control(&network, &env, &cloud, &nodeTable);
+
+void setUp() {}
+void tearDown() {}
+
+static NativeTask* ctlTask   = nullptr;
+static NativeTask* cloudTask = nullptr;
+static uint64_t    ctlDue = 0, cloudDue = 0;
+
+struct Run {
+    uint32_t reports    = 0;
+    uint32_t ticks      = 0;           // update() ในหน้าต่างที่กำลังสะสม
+    uint32_t lastWindow = 0;           // update() ในหน้าต่างที่ report ล่าสุดสรุป
+};
+
+static void run(uint32_t seconds, Run &r) {
+    NativeSim &sim = nativeSim();
+    uint64_t endUs  = sim.nowUs + seconds * 1000000ULL;
+    uint64_t nextIn = sim.nowUs;
+    while (sim.nowUs < endUs) {
+        uint64_t t = std::min({ ctlDue, cloudDue, sim.nextDueUs(), nextIn, endUs });
+        if (t > sim.nowUs) sim.nowUs = t;
+
+        if (sim.nowUs >= nextIn) {
+            SensorPacket p = {};
+            p.waterPercent = 70;
+            p.tiltState    = TILT_NORMAL;
+            if (sim.recvCb) sim.recvCb(SENSOR_NODE_MAC, (const uint8_t*)&p, sizeof(p));
+            nextIn += 1000000ULL;
+        }
+        sim.runDue();
+
+        if (cloudTask->notify || sim.nowUs >= cloudDue) {
+            cloudTask->notify = 0;
+            sim.current = cloudTask;
+            cloud.step();
+            cloudDue = sim.nowUs + CLOUD_TASK_IDLE_MS * 1000ULL;
+        }
+        if (ctlTask->notify || sim.nowUs >= ctlDue) {
+            ctlTask->notify = 0;
+            sim.current = ctlTask;
+            control.update(time(nullptr));
+            r.ticks++;
+            if (control.statsDue()) {
+                control.reportProfile();
+                r.reports++;
+                r.lastWindow = r.ticks;
+                r.ticks = 0;
+            }
+            unsigned long waitMs = control.msUntilNextDeadline(CONTROL_MAX_SLEEP_MS);
+            ctlDue = sim.nowUs + std::max(waitMs, 1UL) * 1000ULL;
+        }
+        sim.current = nullptr;
+    }
+}
+
+static long rtdbInt(const char* path) {
+    auto it = nativeSim().rtdb.find(path);
+    return it == nativeSim().rtdb.end() ? -1 : strtol(it->second.c_str(), nullptr, 10);
+}
+
+static void test_report_on_stats_interval() {
+    NativeSim &sim = nativeSim();
+    sim.rtdbWrite(PATH_CTRL_MODE, "auto");
+    sim.rtdbWrite(PATH_CTRL_TARGET_HUMID, "60");
+
+    Run r;
+    control.statsDue();                            // arm รอบแรก (เหมือน ControlTask)
+    run(CONTROL_STATS_MS * 3 / 1000 + CONTROL_STATS_MS / 2000, r);
+    TEST_ASSERT_EQUAL_UINT32(3, r.reports);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, r.lastWindow);
+
+    // ทุก update() ผ่าน CS_TOTAL → n ของรอบล่าสุด = จำนวน update() ในรอบนั้น (outbox drain แล้ว)
+    char path[64];
+    snprintf(path, sizeof(path), "%s%s/n", PATH_DIAG_CONTROL, controlStageText(CS_TOTAL));
+    printf("\n%s = %ld (window %lu ticks)\n", path, rtdbInt(path), (unsigned long)r.lastWindow);
+    TEST_ASSERT_EQUAL_INT32((int32_t)r.lastWindow, (int32_t)rtdbInt(path));
+
+    static const uint8_t always[] = { CS_CONFIG, CS_ENV, CS_RETX, CS_COMMIT };
+    for (uint8_t st : always) {
+        snprintf(path, sizeof(path), "%s%s/n", PATH_DIAG_CONTROL, controlStageText(st));
+        TEST_ASSERT_GREATER_THAN_INT32_MESSAGE(0, (int32_t)rtdbInt(path), path);
+    }
+}
+
+int main(int, char**) {
+    NativeSim &sim = nativeSim();
+    sim.nowUs = 2000000ULL;
+    sim.setWall(1760000000LL);
+
+    network.begin();
+    cloud.begin();
+    control.begin();
+
+    ctlTask   = sim.task("ControlTask");
+    cloudTask = cloud.task();
+    network.setWakeTask(ctlTask);
+    cloud.config().setWakeTask(ctlTask);
+    env.setWakeTask(ctlTask);
+    ctlDue = cloudDue = sim.nowUs;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_report_on_stats_interval);
+    return UNITY_END();
+}
@@ -0,0 +1,101 @@
+// ---------- user override ยกเลิก schedule ตอน RTDB offline: pio test -e native -f test_user_override ----------
+// event loop แบบเดียวกับ src/replay.cpp; sim.fbReady = false แทน RTDB หลุด (CloudTask::step ไม่ drain outbox)
+// override กี่ครั้งระหว่างหลุดต้องไม่กิน outbox และต้องเขียน PATH_SCHED_ENABLE=false ครั้งเดียวเมื่อกลับมา
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include "constant.h"
+#include "gateway.h"
+#include "cloud/cloud_task.h"
+#include "control/control.h"
+
+#ifndef CONTROL_MAX_SLEEP_MS
+#define CONTROL_MAX_SLEEP_MS 1000
+#endif
+
+NodeTable nodeTable;
+
+GatewayNetwork    network;
+EnvSensorService  env;
+CloudTask         cloud(&network, &nodeTable);
+ControlLogic      control(&network, &env, &cloud, &nodeTable);
+
+void setUp() {}
+void tearDown() {}
+
+static NativeTask* ctlTask   = nullptr;
+static NativeTask* cloudTask = nullptr;
+static uint64_t    ctlDue = 0, cloudDue = 0;
+
+static void run(uint32_t seconds) {
+    NativeSim &sim = nativeSim();
+    uint64_t endUs = sim.nowUs + seconds * 1000000ULL;
+    while (sim.nowUs < endUs) {
+        uint64_t t = std::min({ ctlDue, cloudDue, sim.nextDueUs(), endUs });
+        if (t > sim.nowUs) sim.nowUs = t;
+        sim.runDue();
+
+        if (cloudTask->notify || sim.nowUs >= cloudDue) {
+            cloudTask->notify = 0;
+            sim.current = cloudTask;
+            cloud.step();
+            cloudDue = sim.nowUs + CLOUD_TASK_IDLE_MS * 1000ULL;
+        }
+        if (ctlTask->notify || sim.nowUs >= ctlDue) {
+            ctlTask->notify = 0;
+            sim.current = ctlTask;
+            control.update(time(nullptr));
+            unsigned long waitMs = control.msUntilNextDeadline(CONTROL_MAX_SLEEP_MS);
+            ctlDue = sim.nowUs + std::max(waitMs, 1UL) * 1000ULL;
+        }
+        sim.current = nullptr;
+    }
+}
+
+static void test_offline_override_coalesced() {
+    NativeSim &sim = nativeSim();
+    sim.rtdbWrite(PATH_CTRL_MODE, "manual");           // = prevMode เริ่มต้น → config แรกไม่นับเป็น override
+    sim.rtdbWrite(PATH_CTRL_TARGET_HUMID, "60");
+    sim.rtdbWrite(PATH_SCHED_START, "07:00");
+    sim.rtdbWrite(PATH_SCHED_STOP, "09:00");
+    sim.rtdbWrite(PATH_SCHED_ENABLE, "true");
+    run(10);
+    TEST_ASSERT_EQUAL_STRING("true", sim.rtdb[PATH_SCHED_ENABLE].c_str());
+
+    // หลุด: สลับ mode ไปมา (คำสั่งจาก LAN / stream ที่ค้าง) → override ซ้ำหลายรอบ
+    sim.fbReady = false;
+    run(5);
+    for (int i = 0; i < 2 * CLOUD_OUTBOX_DEPTH; i++) {
+        sim.rtdbWrite(PATH_CTRL_MODE, (i & 1) ? "manual" : "auto");
+        run(1);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, cloud.outbox().depth());
+    TEST_ASSERT_EQUAL_UINT32(0, cloud.outbox().dropCount());
+    TEST_ASSERT_EQUAL_STRING("true", sim.rtdb[PATH_SCHED_ENABLE].c_str());
+
+    sim.fbReady = true;
+    run(5);
+    TEST_ASSERT_EQUAL_STRING("false", sim.rtdb[PATH_SCHED_ENABLE].c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, cloud.outbox().dropCount());
+}
+
+int main(int, char**) {
+    NativeSim &sim = nativeSim();
+    sim.nowUs = 2000000ULL;
+    sim.setWall(1760000000LL);
+
+    network.begin();
+    cloud.begin();
+    control.begin();
+
+    ctlTask   = sim.task("ControlTask");
+    cloudTask = cloud.task();
+    network.setWakeTask(ctlTask);
+    cloud.config().setWakeTask(ctlTask);
+    env.setWakeTask(ctlTask);
+    ctlDue = cloudDue = sim.nowUs;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_offline_override_coalesced);
+    return UNITY_END();
+}
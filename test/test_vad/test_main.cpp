@@ -0,0 +1,213 @@
+// ---------- VAD บน host กับไฟล์ WAV: pio test -e native -f test_vad ----------
+// fixture สังเคราะห์ (seed คงที่) เขียนเป็น WAV 16 kHz mono ลง temp dir แล้วอ่านกลับผ่าน reader ตัวเดียวกับไฟล์จริง
+// ไฟล์อัดจริง: VAD_WAV_DIR=<dir> → รันทุก *.wav, ถ้ามี <name>.txt ("start_s end_s" ต่อบรรทัด) จะวัด recall / false active ด้วย
+#include <Arduino.h>
+#include <unity.h>
+#include <dirent.h>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "audio/vad.h"
+#include "../wav_io.h"
+
+#define VAD_TEST_RATE  16000
+#define VAD_TEST_BLOCK 160             // = AUDIO_BLOCK_SAMPLES (16 kHz, 10 ms)
+
+void setUp() {}
+void tearDown() {}
+
+struct Segment {
+    float start, stop;                 // วินาที
+};
+
+struct Clip {
+    std::vector<int16_t> pcm;
+    uint32_t             rate = VAD_TEST_RATE;
+    std::vector<Segment> speech;
+};
+
+static void readLabels(const std::string &path, Clip &c) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return;
+    Segment s;
+    while (fscanf(f, "%f %f", &s.start, &s.stop) == 2) c.speech.push_back(s);
+    fclose(f);
+}
+
+// ---------- สังเคราะห์ ----------
+static uint32_t rng = 12345;
+static float noise1() {                // uniform -1..1
+    rng = rng * 1664525u + 1013904223u;
+    return (int32_t)rng / 2147483648.0f;
+}
+
+// เสียงสระ: harmonic ของ f0 ที่แกว่ง + formant ~700 / 1200 Hz, envelope เป็นพยางค์ 5 Hz
+struct VoiceGen {
+    float ph = 0;
+    float next(float t, float level) {
+        float f0 = 150.0f + 40.0f * sinf(2.0f * (float)M_PI * 0.9f * t);
+        ph += 2.0f * (float)M_PI * f0 / VAD_TEST_RATE;
+        float x = 0;
+        for (int h = 1; h <= 20; h++) {
+            float fh = h * f0;
+            float g  = 1.0f / (1.0f + powf((fh - 700.0f) / 250.0f, 2)) +
+                       0.6f / (1.0f + powf((fh - 1200.0f) / 300.0f, 2)) + 0.05f;
+            x += g * sinf(h * ph);
+        }
+        float env = 0.25f + 0.75f * fabsf(sinf(2.0f * (float)M_PI * 2.5f * t));
+        return level * env * x;
+    }
+};
+
+typedef float (*Bed)(float t, size_t i);          // เสียงพื้นของ fixture
+
+static Clip synth(float seconds, Bed bed, std::vector<Segment> speech, float voiceLevel) {
+    Clip c;
+    c.speech = speech;
+    c.pcm.resize((size_t)(seconds * VAD_TEST_RATE));
+    VoiceGen v;
+    for (size_t i = 0; i < c.pcm.size(); i++) {
+        float t = (float)i / VAD_TEST_RATE;
+        float x = bed(t, i);
+        for (const Segment &s : speech) {
+            if (t >= s.start && t < s.stop) x += v.next(t, voiceLevel);
+        }
+        if (x > 32767) x = 32767;
+        if (x < -32768) x = -32768;
+        c.pcm[i] = (int16_t)lrintf(x);
+    }
+    return c;
+}
+
+static float bedQuiet(float, size_t)  { return 20.0f * noise1(); }
+static float bedHum(float t, size_t)  { return 300.0f * sinf(2.0f * (float)M_PI * 50.0f * t) + 20.0f * noise1(); }
+static float bedFan(float t, size_t)  { return (20.0f + 400.0f * t / 8.0f) * noise1(); }    // ดังขึ้นช้า ๆ
+
+// hiss ความถี่สูง (second difference ของ noise → ZCR ~115 เกิน zcrMax) โผล่มาทันที 2-4 s
+// ดังกว่าพื้น ~10 เท่า: ผ่าน snrShift แต่ไม่ถึง loudShift (เกิน x16 = ถือเป็นเสียงพูดโดยไม่ดู ZCR ตามที่ออกแบบ)
+static float bedHiss(float t, size_t) {
+    static float p1 = 0, p2 = 0;
+    float n = noise1();
+    float h = (t >= 2.0f && t < 4.0f) ? 25.0f * (n - 2.0f * p1 + p2) : 0.0f;
+    p2 = p1;
+    p1 = n;
+    return 20.0f * noise1() + h;
+}
+
+// ---------- วัดผล ----------
+struct VadScore {
+    size_t speechBlocks = 0, hit = 0;            // block ในช่วงพูด (หลัง onset) ที่ active
+    size_t otherBlocks  = 0, falseActive = 0;    // block นอกช่วงพูด + hangover ที่ active
+    size_t active       = 0, blocks = 0;
+    int    worstOnset   = 0;                     // block ช้าสุดก่อน active หลังเริ่มพูด
+};
+
+static VadScore runVad(const Clip &c) {
+    Vad vad;
+    VadScore s;
+    const float blockS = (float)VAD_TEST_BLOCK / c.rate;
+    const float graceS = (VadConfig().hangover + 3) * blockS;   // หลังพูดจบยังค้างได้
+    std::vector<bool> act;
+    for (size_t off = 0; off + VAD_TEST_BLOCK <= c.pcm.size(); off += VAD_TEST_BLOCK) {
+        act.push_back(vad.process(&c.pcm[off], VAD_TEST_BLOCK));
+    }
+    for (size_t b = 0; b < act.size(); b++) {
+        float t = b * blockS;
+        bool inSpeech = false, nearSpeech = false;
+        for (const Segment &g : c.speech) {
+            inSpeech   |= t >= g.start + 5 * blockS && t + blockS <= g.stop;
+            nearSpeech |= t + blockS > g.start && t < g.stop + graceS;
+        }
+        s.blocks++;
+        s.active += act[b];
+        if (inSpeech)        { s.speechBlocks++; s.hit += act[b]; }
+        else if (!nearSpeech){ s.otherBlocks++;  s.falseActive += act[b]; }
+    }
+    for (const Segment &g : c.speech) {
+        size_t b0 = (size_t)(g.start / blockS), b = b0;
+        while (b < act.size() && !act[b] && b * blockS < g.stop) b++;
+        if ((int)(b - b0) > s.worstOnset) s.worstOnset = (int)(b - b0);
+    }
+    return s;
+}
+
+static void printScore(const char* name, const VadScore &s) {
+    printf("%-14s %6u %7.1f%% %8.1f%% %9.2f%% %7d\n", name, (unsigned)s.blocks, 100.0 * s.active / s.blocks,
+           s.speechBlocks ? 100.0 * s.hit / s.speechBlocks : 0.0,
+           s.otherBlocks ? 100.0 * s.falseActive / s.otherBlocks : 0.0, s.worstOnset);
+}
+
+static void printHeader() {
+    printf("\n%-14s %6s %8s %9s %10s %7s\n", "fixture", "blocks", "duty", "recall", "false_act", "onset");
+}
+
+// ---------- fixture ----------
+static void test_synthetic_fixtures() {
+    struct Fixture {
+        const char* name;
+        Clip        clip;
+    } fx[] = {
+        { "quiet_room",  synth(6.0f, bedQuiet, { { 1.0f, 2.5f }, { 3.5f, 4.3f } }, 900.0f) },
+        { "soft_voice",  synth(5.0f, bedQuiet, { { 1.5f, 3.5f } }, 120.0f) },
+        { "mains_hum",   synth(6.0f, bedHum,   { { 2.0f, 3.5f } }, 900.0f) },
+        { "rising_fan",  synth(8.0f, bedFan,   {}, 0.0f) },
+        { "hiss_burst",  synth(6.0f, bedHiss,  {}, 0.0f) },
+    };
+
+    char dir[] = "/tmp/vad_fixtures_XXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    printHeader();
+    for (Fixture &f : fx) {
+        std::string path = std::string(dir) + "/" + f.name + ".wav";
+        TEST_ASSERT_TRUE_MESSAGE(wavWrite(path.c_str(), f.clip.pcm, f.clip.rate), f.name);
+        Clip c;
+        TEST_ASSERT_TRUE_MESSAGE(wavRead(path.c_str(), c.pcm, c.rate), f.name);
+        remove(path.c_str());
+        TEST_ASSERT_EQUAL(VAD_TEST_RATE, c.rate);
+        TEST_ASSERT_EQUAL_MEMORY(f.clip.pcm.data(), c.pcm.data(), c.pcm.size() * 2);
+        c.speech = f.clip.speech;
+
+        VadScore s = runVad(c);
+        printScore(f.name, s);
+        if (s.speechBlocks) {
+            TEST_ASSERT_TRUE_MESSAGE(s.hit * 100 >= s.speechBlocks * 95, f.name);       // recall >= 95%
+            TEST_ASSERT_TRUE_MESSAGE(s.worstOnset <= 4, f.name);                        // <= 40 ms
+        }
+        TEST_ASSERT_TRUE_MESSAGE(s.falseActive * 100 <= s.otherBlocks * 2, f.name);    // false active <= 2%
+    }
+    rmdir(dir);
+}
+
+// ---------- ไฟล์อัดจริง (ถ้าตั้ง VAD_WAV_DIR) ----------
+static void test_recorded_wavs() {
+    const char* dirPath = getenv("VAD_WAV_DIR");
+    if (!dirPath || !*dirPath) TEST_IGNORE_MESSAGE("VAD_WAV_DIR not set");
+    DIR* d = opendir(dirPath);
+    TEST_ASSERT_NOT_NULL_MESSAGE(d, dirPath);
+    printHeader();
+    size_t files = 0;
+    while (dirent* e = readdir(d)) {
+        std::string n = e->d_name;
+        if (n.size() < 5 || n.compare(n.size() - 4, 4, ".wav") != 0) continue;
+        std::string base = std::string(dirPath) + "/" + n.substr(0, n.size() - 4);
+        Clip c;
+        TEST_ASSERT_TRUE_MESSAGE(wavRead((base + ".wav").c_str(), c.pcm, c.rate), n.c_str());
+        if (c.rate != VAD_TEST_RATE) printf("%s: %u Hz (VAD tuned for %u)\n", n.c_str(), (unsigned)c.rate, VAD_TEST_RATE);
+        readLabels(base + ".txt", c);
+        VadScore s = runVad(c);
+        printScore(n.c_str(), s);
+        if (s.speechBlocks) TEST_ASSERT_TRUE_MESSAGE(s.hit * 100 >= s.speechBlocks * 90, n.c_str());
+        files++;
+    }
+    closedir(d);
+    TEST_ASSERT_TRUE_MESSAGE(files > 0, "no *.wav in VAD_WAV_DIR");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_synthetic_fixtures);
+    RUN_TEST(test_recorded_wavs);
+    return UNITY_END();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// ---------- WAV ของ host test (test_vad fixture / ไฟล์อัดจริงของ test_vad, test_codec) ----------
+// RIFF PCM 16-bit เท่านั้น, หลาย channel → ใช้ channel แรก
+static bool wavWrite(const char* path, const std::vector<int16_t> &pcm, uint32_t rate) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    uint32_t data = (uint32_t)pcm.size() * 2;
+    uint8_t h[44] = { 'R','I','F','F', 0,0,0,0, 'W','A','V','E', 'f','m','t',' ', 16,0,0,0, 1,0, 1,0,
+                      0,0,0,0, 0,0,0,0, 2,0, 16,0, 'd','a','t','a', 0,0,0,0 };
+    auto put32 = [&](int o, uint32_t v) { for (int i = 0; i < 4; i++) h[o + i] = (uint8_t)(v >> (8 * i)); };
+    put32(4, 36 + data);
+    put32(24, rate);
+    put32(28, rate * 2);
+    put32(40, data);
+    bool ok = fwrite(h, 1, sizeof(h), f) == sizeof(h) &&
+              fwrite(pcm.data(), 2, pcm.size(), f) == pcm.size();
+    fclose(f);
+    return ok;
+}
+
+static bool wavRead(const char* path, std::vector<int16_t> &pcm, uint32_t &rate) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t  riff[12];
+    uint16_t ch = 0, bits = 0;
+    bool ok = fread(riff, 1, 12, f) == 12 && !memcmp(riff, "RIFF", 4) && !memcmp(riff + 8, "WAVE", 4);
+    while (ok) {
+        uint8_t hd[8];
+        if (fread(hd, 1, 8, f) != 8) { ok = false; break; }
+        uint32_t n = hd[4] | (hd[5] << 8) | (hd[6] << 16) | ((uint32_t)hd[7] << 24);
+        if (!memcmp(hd, "fmt ", 4)) {
+            std::vector<uint8_t> fmt(n);
+            if (n < 16 || fread(fmt.data(), 1, n, f) != n) { ok = false; break; }
+            ch   = (uint16_t)(fmt[2] | (fmt[3] << 8));
+            rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            bits = (uint16_t)(fmt[14] | (fmt[15] << 8));
+            ok   = (fmt[0] | (fmt[1] << 8)) == 1 && bits == 16 && ch > 0;
+        } else if (!memcmp(hd, "data", 4)) {
+            if (!ch) { ok = false; break; }
+            std::vector<int16_t> raw(n / 2);
+            raw.resize(fread(raw.data(), 2, raw.size(), f));
+            pcm.resize(raw.size() / ch);
+            for (size_t i = 0; i < pcm.size(); i++) pcm[i] = raw[i * ch];
+            break;
+        } else {
+            fseek(f, n + (n & 1), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    return ok && !pcm.empty();
+}